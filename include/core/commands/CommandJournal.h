@@ -0,0 +1,167 @@
+#ifndef COMMANDJOURNAL_H
+#define COMMANDJOURNAL_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QString>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QStringList>
+#include <QScopedPointer>
+#include "core/Global.h"
+
+class QLockFile;
+
+class QThread;
+class QDataStream;
+
+namespace QtWordEditor {
+
+class Document;
+class EditCommand;
+
+/**
+ * @brief 命令日志，把每条编辑命令追加写入本地日志文件，用于崩溃恢复
+ *
+ * 日志以上次保存的文件为基准：文件头记录基准文件路径，之后依次是
+ * 压入撤销栈的命令（构造参数）和撤销栈序号的变化（撤销、重做）。
+ * 保存时撤销栈保留，序号按 reset() 时的栈序号为起点相对记录；
+ * 撤销到起点之前的修改已包含在基准文件中，无法在其上重放，写入屏障记录。
+ * 保存成功或新建文档时 reset() 清空日志，正常退出时 discard() 删除日志文件；
+ * 启动时日志仍有记录说明上次异常退出，可以在基准文件上 replay()。
+ *
+ * 记录在界面线程序列化到内存缓冲区，由后台写入线程每隔
+ * Constants::COMMAND_JOURNAL_FLUSH_INTERVAL_MS 批量写入文件，输入路径上没有文件操作。
+ * 不能由记录重建的命令（如插入图片块）写入一条屏障记录，重放到此为止。
+ *
+ * 每个实例使用自己的日志文件（sessionFilePath()），并在存续期间持有
+ * 同名 .lock 锁文件；只有锁已失效（持有的进程已退出）的日志才是崩溃留下的，
+ * 由 staleJournals() 找出，不会恢复另一个正在运行的实例的日志。
+ */
+class CommandJournal : public QObject
+{
+    Q_OBJECT
+public:
+    /**
+     * @brief 构造函数，锁定日志文件并启动后台写入线程（在 reset() 之前不修改日志文件）
+     * @param document 被记录的文档
+     * @param filePath 日志文件路径
+     * @param parent 父对象指针
+     */
+    CommandJournal(Document *document, const QString &filePath, QObject *parent = nullptr);
+
+    /**
+     * @brief 析构函数，写出缓冲的记录后停止写入线程并释放锁文件
+     */
+    ~CommandJournal() override;
+
+    /** @brief 日志文件路径 */
+    QString filePath() const;
+
+    /**
+     * @brief 开始新的日志：丢弃已有记录，写入以指定文件为基准的文件头
+     * @param baseFile 基准文件路径（未保存过的文档为空）
+     */
+    void reset(const QString &baseFile);
+
+    /**
+     * @brief 记录命令并压入文档的撤销栈（由 Document::pushCommand() 调用）
+     * @param command 要执行的命令
+     */
+    void push(EditCommand *command);
+
+    /**
+     * @brief 阻塞直到缓冲的记录都已写入文件
+     */
+    void flush();
+
+    /**
+     * @brief 正常退出时删除日志文件，之后不再记录
+     */
+    void discard();
+
+    /**
+     * @brief 在文档上重放日志记录，重放的命令同时写入当前日志
+     * @param records readJournal() 读出的记录
+     * @return 重放的记录数；遇到屏障或无效记录时停止
+     */
+    int replay(const QByteArray &records);
+
+    /**
+     * @brief 读取日志文件
+     * @param filePath 日志文件路径
+     * @param baseFile 输出参数，日志的基准文件路径
+     * @param records 输出参数，文件头之后的全部记录
+     * @return 文件存在且文件头有效时返回 true
+     */
+    static bool readJournal(const QString &filePath, QString *baseFile, QByteArray *records);
+
+    /**
+     * @brief 为本进程生成一个不与其他实例冲突的日志文件路径
+     * @param directory 日志目录
+     * @return 日志文件路径
+     */
+    static QString sessionFilePath(const QString &directory);
+
+    /**
+     * @brief 查找目录中锁已失效的日志（锁文件不存在或持有它的进程已退出）
+     * @param directory 日志目录
+     * @return 日志文件路径，按修改时间从新到旧排列
+     */
+    static QStringList staleJournals(const QString &directory);
+
+    /**
+     * @brief 删除已处理的失效日志及其锁文件
+     * @param filePath 日志文件路径
+     */
+    static void removeJournal(const QString &filePath);
+
+private slots:
+    void onIndexChanged(int index);
+
+private:
+    /**
+     * @brief 把一条记录追加到写入缓冲区
+     * @param type 记录类型
+     * @param payload 记录内容
+     */
+    void append(quint8 type, const QByteArray &payload);
+
+    /**
+     * @brief 后台写入线程的主循环
+     */
+    void writerLoop();
+
+    /** @brief 日志文件对应的锁文件路径 */
+    static QString lockFilePath(const QString &filePath);
+
+    /**
+     * @brief 按记录类型重建命令
+     * @return 新命令，类型未知或记录无效时返回 nullptr
+     */
+    static EditCommand *createCommand(Document *document, int type, QDataStream &in);
+
+    Document *m_document;           ///< 被记录的文档
+    QString m_filePath;             ///< 日志文件路径
+    QScopedPointer<QLockFile> m_lock;   ///< 标记日志属于正在运行的实例
+    bool m_pushing = false;         ///< 正在压入命令（忽略由此引起的序号变化）
+    bool m_broken = false;          ///< 已写入屏障记录，直到下次 reset() 不再记录
+    int m_baseIndex = 0;            ///< reset() 时的撤销栈序号，序号记录相对于它
+
+    // 以下成员与写入线程共享，由 m_mutex 保护
+    QMutex m_mutex;
+    QWaitCondition m_wakeUp;        ///< 唤醒写入线程
+    QWaitCondition m_written;       ///< 写入线程完成一批写入
+    QByteArray m_pending;           ///< 待写入的记录
+    bool m_truncate = false;        ///< 写入前先清空文件
+    bool m_remove = false;          ///< 删除日志文件
+    bool m_flushRequested = false;  ///< 不等写入间隔，立即写入
+    bool m_stop = false;            ///< 停止写入线程
+    quint64 m_appendedSerial = 0;   ///< 已提交的修改序号
+    quint64 m_writtenSerial = 0;    ///< 已写入文件的修改序号
+    QThread *m_writer = nullptr;    ///< 后台写入线程
+};
+
+} // namespace QtWordEditor
+
+#endif // COMMANDJOURNAL_H
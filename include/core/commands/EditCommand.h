@@ -5,16 +5,50 @@
 #include <QString>
 #include "core/Global.h"
 
+class QDataStream;
+
 namespace QtWordEditor {
 
 class Document;
+class UndoMemoryManager;
+class ParagraphBlock;
 
 /**
  * @brief The EditCommand class is the base class for all undoable editing commands.
+ *
+ * Commands report the memory they hold through memoryCost(). Commands whose
+ * payload (saved text and style runs) can be serialized may have it moved to
+ * the undo spill file by UndoMemoryManager; it is reloaded by ensureLoaded()
+ * before the command next runs.
+ *
+ * Commands that report a journalType() can also be written to the command
+ * journal and re-created from it by CommandJournal during crash recovery.
+ *
+ * Text and style commands take global block indices but resolve them to
+ * stable block IDs when constructed, so undo/redo look blocks up through
+ * the document's ID hash and stay valid when blocks are inserted before them.
  */
 class EditCommand : public QUndoCommand
 {
 public:
+    // Record types of the command journal (values are stored on disk, only append)
+    enum JournalType {
+        NotJournaled = 0,
+        InsertTextJournal = 1,
+        RemoveTextJournal = 2,
+        SetCharacterStyleJournal = 3,
+        SetCharacterStyleRangeJournal = 4,
+        SetParagraphStyleJournal = 5,
+        InsertBlockJournal = 6,
+        RemoveBlockJournal = 7
+    };
+
+    // QUndoCommand::id() of commands that merge with their successors
+    enum MergeId {
+        InsertTextMergeId = 1,
+        RemoveTextMergeId = 2
+    };
+
     explicit EditCommand(Document *document, const QString &text = QString());
     ~EditCommand() override;
 
@@ -24,13 +58,58 @@ public:
     void undo() override;
     void redo() override;
 
+    // Approximate number of bytes held by the command (small once spilled)
+    virtual qint64 memoryCost() const;
+
+    // Whether the payload can be written to the spill file
+    virtual bool canSpill() const;
+
+    // Whether the payload currently lives in the spill file
+    bool isSpilled() const;
+
+    // Move the payload to the manager's spill file and free it; returns true if it was released
+    bool spill(UndoMemoryManager *manager);
+
+    // Report the change of memoryCost() since the last report to the manager's running total
+    void updateMemoryCost(UndoMemoryManager *manager);
+
+    // Journal record type; NotJournaled if the command cannot be re-created from a record
+    virtual JournalType journalType() const;
+
+    // Write the arguments needed to re-create the command (called before it is first run)
+    virtual void writeJournal(QDataStream &out) const;
+
 protected:
+    // Stable ID of the block at a global index, -1 if there is none
+    int blockIdAt(int blockIndex) const;
+
+    // Resolve a block ID through the document's ID hash; nullptr if the block is gone or not a paragraph
+    ParagraphBlock *paragraphById(int blockId) const;
+
+    // Reload a spilled payload; call first in undo(), redo() and mergeWith() and
+    // return without changing anything if it fails (the command then stays spilled)
+    bool ensureLoaded();
+
+    // Forget the spill record after the payload was modified (e.g. by a merge)
+    void payloadChanged();
+
+    // Payload serialization used by spill()/ensureLoaded()
+    virtual void savePayload(QDataStream &out) const;
+    virtual void loadPayload(QDataStream &in);
+    virtual void releasePayload();
+
     Document *m_document;
 
 private:
     QString m_text;
+    UndoMemoryManager *m_spillManager = nullptr;  ///< Manager holding the spill record
+    qint64 m_spillOffset = -1;                    ///< Record offset in the spill file, -1 if none
+    int m_spillSize = 0;                          ///< Record size in the spill file
+    bool m_spilled = false;                       ///< Payload released from memory
+    UndoMemoryManager *m_costManager = nullptr;   ///< Manager whose running total includes the command
+    qint64 m_countedCost = 0;                     ///< Cost last reported to m_costManager
 };
 
 } // namespace QtWordEditor
 
-#endif // EDITCOMMAND_H
\ No newline at end of file
+#endif // EDITCOMMAND_H
@@ -12,6 +12,7 @@ namespace QtWordEditor {
  *
  * 该命令负责在文档的特定块中插入文本内容，并支持撤销重做操作。
  * 支持与相邻的插入命令合并，提高撤销操作的用户体验。
+ * 构造时把块索引解析为块ID，撤销重做通过文档的ID哈希表查找块。
  */
 class InsertTextCommand : public EditCommand
 {
@@ -50,10 +51,30 @@ public:
      * @param other 要合并的另一个命令
      * @return 如果成功合并返回true，否则返回false
      */
+    /**
+     * @brief 合并标识，连续插入的命令具有相同的标识
+     */
+    int id() const override;
+
     bool mergeWith(const QUndoCommand *other) override;
 
+    qint64 memoryCost() const override;
+    bool canSpill() const override;
+
+    JournalType journalType() const override;
+    void writeJournal(QDataStream &out) const override;
+
+    // Re-create the command from a record written by writeJournal(); nullptr if the record is invalid
+    static InsertTextCommand *fromJournal(Document *document, QDataStream &in);
+
+protected:
+    void savePayload(QDataStream &out) const override;
+    void loadPayload(QDataStream &in) override;
+    void releasePayload() override;
+
 private:
     int m_blockIndex;           ///< 目标块索引
+    int m_blockId;              ///< 目标块的稳定ID（撤销重做时按ID查找）
     int m_position;             ///< 插入位置
     QString m_text;             ///< 插入的文本内容
     CharacterStyle m_style;     ///< 文本字符样式
@@ -19,6 +19,14 @@ public:
     void redo() override;
     void undo() override;
 
+    qint64 memoryCost() const override;
+
+    JournalType journalType() const override;
+    void writeJournal(QDataStream &out) const override;
+
+    // Re-create the command from a record written by writeJournal(); nullptr if the record is invalid
+    static RemoveBlockCommand *fromJournal(Document *document, QDataStream &in);
+
 private:
     int m_index;
     QPointer<Block> m_removedBlock;
@@ -3,9 +3,9 @@
 
 #include "EditCommand.h"
 #include "core/document/CharacterStyle.h"
-#include "core/document/Span.h"
+#include "core/document/ParagraphBlock.h"
 #include <QString>
-#include <QList>
+#include <QVector>
 
 namespace QtWordEditor {
 
@@ -14,6 +14,7 @@ namespace QtWordEditor {
  *
  * 该命令负责从文档的特定块中删除指定范围的文本内容，
  * 并保存被删除的文本和样式信息以便撤销操作。
+ * 连续删除相邻文本的命令合并为一条，长按退格或删除键只产生一个撤销步骤。
  */
 class RemoveTextCommand : public EditCommand
 {
@@ -44,12 +45,40 @@ public:
      */
     void undo() override;
 
+    /**
+     * @brief 合并标识，连续删除的命令具有相同的标识
+     */
+    int id() const override;
+
+    /**
+     * @brief 尝试与后续的删除命令合并
+     * 向前删除（Delete）和向后删除（Backspace）的相邻范围都可以合并
+     * @param other 要合并的另一个命令
+     * @return 如果成功合并返回true，否则返回false
+     */
+    bool mergeWith(const QUndoCommand *other) override;
+
+    qint64 memoryCost() const override;
+    bool canSpill() const override;
+
+    JournalType journalType() const override;
+    void writeJournal(QDataStream &out) const override;
+
+    // Re-create the command from a record written by writeJournal(); nullptr if the record is invalid
+    static RemoveTextCommand *fromJournal(Document *document, QDataStream &in);
+
+protected:
+    void savePayload(QDataStream &out) const override;
+    void loadPayload(QDataStream &in) override;
+    void releasePayload() override;
+
 private:
     int m_blockIndex;           ///< 目标块索引
+    int m_blockId;              ///< 目标块的稳定ID（撤销重做时按ID查找）
     int m_position;             ///< 删除起始位置
     int m_length;               ///< 删除的文本长度
     QString m_removedText;      ///< 被删除的文本内容
-    QList<Span> m_removedSpans; ///< 被删除文本的样式跨度信息
+    QVector<StyleRun> m_removedRuns; ///< 被删除文本的样式游程
 };
 
 } // namespace QtWordEditor
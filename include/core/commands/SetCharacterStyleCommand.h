@@ -3,30 +3,56 @@
 
 #include "EditCommand.h"
 #include "core/document/CharacterStyle.h"
-#include <QList>
-#include "core/document/Span.h"
+#include <QVector>
+#include <QString>
+#include "core/document/ParagraphBlock.h"
 
 namespace QtWordEditor {
 
 /**
  * @brief The SetCharacterStyleCommand applies a character style to a selection.
+ *
+ * Either a direct style is merged into the range, or a named style is
+ * referenced by the range's runs and resolved when rendering.
+ * Undo only keeps the style runs of the formatted range, so its cost is
+ * proportional to the range rather than the whole paragraph.
  */
 class SetCharacterStyleCommand : public EditCommand
 {
 public:
     SetCharacterStyleCommand(Document *document, int blockIndex, int start, int end,
                              const CharacterStyle &style);
+    SetCharacterStyleCommand(Document *document, int blockIndex, int start, int end,
+                             const QString &styleName);
     ~SetCharacterStyleCommand() override;
 
     void redo() override;
     void undo() override;
 
+    qint64 memoryCost() const override;
+    bool canSpill() const override;
+
+    JournalType journalType() const override;
+    void writeJournal(QDataStream &out) const override;
+
+    // Re-create the command from a record written by writeJournal(); nullptr if the record is invalid
+    static SetCharacterStyleCommand *fromJournal(Document *document, QDataStream &in);
+
+protected:
+    void savePayload(QDataStream &out) const override;
+    void loadPayload(QDataStream &in) override;
+    void releasePayload() override;
+
 private:
     int m_blockIndex;
+    int m_blockId;                  // stable ID of the block, used by undo/redo
     int m_start;
     int m_end;
     CharacterStyle m_newStyle;
-    QList<Span> m_oldSpans; // original spans for undo
+    QString m_newStyleName;
+    bool m_isNamedStyle = false;
+    int m_oldStart = 0;             // clamped range whose runs were saved
+    QVector<StyleRun> m_oldRuns;    // original runs of the range for undo
 };
 
 } // namespace QtWordEditor
@@ -0,0 +1,67 @@
+#ifndef SETCHARACTERSTYLERANGECOMMAND_H
+#define SETCHARACTERSTYLERANGECOMMAND_H
+
+#include "EditCommand.h"
+#include "core/document/CharacterStyle.h"
+#include "core/document/ParagraphBlock.h"
+#include <QVector>
+#include <QString>
+
+namespace QtWordEditor {
+
+/**
+ * @brief The SetCharacterStyleRangeCommand applies a character style across several blocks.
+ *
+ * The whole range is formatted in one pass inside a document batch, so it is a
+ * single undo step and the scene and layout get one blocksChanged()
+ * notification instead of one textChanged() per paragraph. Undo keeps only
+ * the style runs of the formatted ranges.
+ */
+class SetCharacterStyleRangeCommand : public EditCommand
+{
+public:
+    SetCharacterStyleRangeCommand(Document *document, int startBlock, int startOffset,
+                                  int endBlock, int endOffset, const CharacterStyle &style);
+    SetCharacterStyleRangeCommand(Document *document, int startBlock, int startOffset,
+                                  int endBlock, int endOffset, const QString &styleName);
+    ~SetCharacterStyleRangeCommand() override;
+
+    void redo() override;
+    void undo() override;
+
+    qint64 memoryCost() const override;
+    bool canSpill() const override;
+
+    JournalType journalType() const override;
+    void writeJournal(QDataStream &out) const override;
+
+    // Re-create the command from a record written by writeJournal(); nullptr if the record is invalid
+    static SetCharacterStyleRangeCommand *fromJournal(Document *document, QDataStream &in);
+
+protected:
+    void savePayload(QDataStream &out) const override;
+    void loadPayload(QDataStream &in) override;
+    void releasePayload() override;
+
+private:
+    // Original runs of one block's formatted range
+    struct SavedRuns {
+        int blockId;            // stable ID of the block, used by undo
+        int start;
+        int length;
+        QVector<StyleRun> runs;
+    };
+
+    int m_startBlock;
+    int m_startOffset;
+    int m_endBlock;
+    int m_endOffset;
+    CharacterStyle m_newStyle;
+    QString m_newStyleName;
+    bool m_isNamedStyle = false;
+    QVector<SavedRuns> m_oldRuns;
+};
+
+} // namespace QtWordEditor
+
+#endif // SETCHARACTERSTYLERANGECOMMAND_H
@@ -4,26 +4,46 @@
 #include "EditCommand.h"
 #include "core/document/ParagraphStyle.h"
 #include <QList>
+#include <QString>
 
 namespace QtWordEditor {
 
 /**
  * @brief The SetParagraphStyleCommand class applies paragraph styles to blocks.
+ *
+ * Applying a named style records the name on the paragraphs and clears
+ * their direct paragraph formatting.
  */
 class SetParagraphStyleCommand : public EditCommand
 {
 public:
     SetParagraphStyleCommand(Document *document, const QList<int> &blockIndices,
                             const ParagraphStyle &newStyle);
+    SetParagraphStyleCommand(Document *document, const QList<int> &blockIndices,
+                            const QString &styleName);
     ~SetParagraphStyleCommand() override;
 
     void redo() override;
     void undo() override;
 
+    qint64 memoryCost() const override;
+
+    JournalType journalType() const override;
+    void writeJournal(QDataStream &out) const override;
+
+    // Re-create the command from a record written by writeJournal(); nullptr if the record is invalid
+    static SetParagraphStyleCommand *fromJournal(Document *document, QDataStream &in);
+
 private:
+    void saveOldStyles();
+
     QList<int> m_blockIndices;
+    QList<int> m_blockIds;          // stable IDs of the blocks, used by undo/redo
     ParagraphStyle m_newStyle;
+    QString m_newStyleName;
+    bool m_isNamedStyle = false;
     QList<ParagraphStyle> m_oldStyles;
+    QList<QString> m_oldStyleNames;
 };
 
 } // namespace QtWordEditor
@@ -0,0 +1,116 @@
+#ifndef UNDOMEMORYMANAGER_H
+#define UNDOMEMORYMANAGER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QTemporaryFile>
+#include <QMap>
+#include "core/Global.h"
+
+class QUndoStack;
+
+namespace QtWordEditor {
+
+class EditCommand;
+
+/**
+ * @brief 撤销栈内存管理器，限制撤销命令在内存中占用的字节数
+ *
+ * 维护命令驻留内存的累计值：撤销栈变化后只重新统计本次执行过的命令，
+ * 命令溢出、读回和销毁时自行更新累计值。超出预算时从最早未溢出的命令开始，
+ * 把可溢出命令的数据（保存的文本和样式游程）压缩后写入临时溢出文件并释放内存。
+ * 撤销到这些命令时由命令自己按记录的偏移读回。
+ * 合并或丢弃重做分支后不再使用的记录所占空间会被登记，供之后的记录复用；
+ * 栈顶命令可能还会与新命令合并，不会被溢出；撤销栈清空时溢出文件随之清空。
+ */
+class UndoMemoryManager : public QObject
+{
+    Q_OBJECT
+public:
+    /**
+     * @brief 构造函数
+     * @param stack 要管理的撤销栈
+     * @param budget 内存预算（字节）
+     * @param parent 父对象指针
+     */
+    UndoMemoryManager(QUndoStack *stack, qint64 budget, QObject *parent = nullptr);
+    ~UndoMemoryManager() override;
+
+    /**
+     * @brief 设置内存预算，立即按新预算溢出
+     * @param bytes 字节数
+     */
+    void setBudget(qint64 bytes);
+
+    /** @brief 获取内存预算（字节） */
+    qint64 budget() const;
+
+    /** @brief 撤销栈中的命令当前在内存中占用的字节数 */
+    qint64 residentBytes() const;
+
+    /** @brief 溢出文件的大小（字节） */
+    qint64 spillFileSize() const;
+
+    /**
+     * @brief 更新驻留内存的累计值（由命令在占用变化时调用）
+     * @param delta 变化的字节数
+     */
+    void adjustResidentBytes(qint64 delta);
+
+    /**
+     * @brief 压缩并写入一条记录，优先复用已释放的空间
+     * @param data 命令序列化后的数据
+     * @param size 输出参数，记录在文件中的字节数
+     * @return 记录的偏移，写入失败返回 -1
+     */
+    qint64 writeRecord(const QByteArray &data, int *size);
+
+    /**
+     * @brief 读取并解压一条记录
+     * @param offset 记录的偏移
+     * @param size 记录的字节数
+     * @return 命令序列化后的数据，读取失败返回空
+     */
+    QByteArray readRecord(qint64 offset, int size);
+
+    /**
+     * @brief 释放不再使用的记录，空间留给之后的记录
+     * @param offset 记录的偏移
+     * @param size 记录的字节数
+     */
+    void releaseRecord(qint64 offset, int size);
+
+    /**
+     * @brief 检查预算，超出时从最早的命令开始溢出
+     */
+    void enforceBudget();
+
+private slots:
+    /**
+     * @brief 撤销栈序号变化：重新统计执行过的命令，然后检查预算
+     * @param index 新的序号
+     */
+    void onIndexChanged(int index);
+
+private:
+    /**
+     * @brief 按栈中顺序遍历一段编辑命令（包括宏命令的子命令）
+     * @param first 起始顶层序号
+     * @param end 结束顶层序号（不含）
+     * @param visit 回调，参数为命令和它在栈中的顶层序号；返回 false 停止遍历
+     */
+    template <typename Visitor>
+    void forEachCommand(int first, int end, Visitor visit) const;
+
+    QUndoStack *m_stack;            ///< 管理的撤销栈
+    qint64 m_budget;                ///< 内存预算（字节）
+    qint64 m_residentBytes = 0;     ///< 已统计命令的驻留内存累计值
+    int m_lastIndex = 0;            ///< 上次统计时的撤销栈序号
+    int m_spillFrom = 0;            ///< 之前的命令都已溢出或不能溢出，溢出从此顶层序号开始
+    QTemporaryFile m_spillFile;     ///< 溢出文件（首次溢出时创建）
+    QMap<qint64, qint64> m_freeRecords; ///< 溢出文件中已释放的空间：偏移 -> 字节数（相邻的已合并）
+};
+
+} // namespace QtWordEditor
+
+#endif // UNDOMEMORYMANAGER_H
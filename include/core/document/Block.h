@@ -7,6 +7,8 @@
 
 namespace QtWordEditor {
 
+class Document;
+
 /**
  * @brief 块基类，是所有内容块的抽象基类
  *
@@ -72,16 +74,29 @@ public:
     // ========== 文档中位置相关方法（由Document管理的全局索引）==========
     
     /**
-     * @brief 获取块在文档中的全局位置
-     * @return 全局块索引
+     * @brief 获取块在文档中的全局位置（由 Document::indexOfBlock() 计算，不缓存）
+     * @return 全局块索引，块不在文档中时返回 -1
      */
     int positionInDocument() const;
-    
+
+    /**
+     * @brief 获取块在所属节中的索引（由Section在插入、移除块时维护，始终准确）
+     * @return 节内块索引，不在节中时返回 -1
+     */
+    int indexInSection() const;
+
+    /**
+     * @brief 设置块在所属节中的索引
+     * @param index 新的节内块索引
+     */
+    void setIndexInSection(int index);
+
     /**
-     * @brief 设置块在文档中的全局位置
-     * @param pos 新的全局块索引
+     * @brief 获取块所属的文档
+     * 沿QObject父对象链向上查找（块 → 节 → 文档）
+     * @return 文档指针，块尚未加入文档时返回nullptr
      */
-    void setPositionInDocument(int pos);
+    Document *document() const;
 
     // ========== 纯虚函数（子类必须实现）==========
     
@@ -111,7 +126,7 @@ private:
     int m_blockId = -1;              ///< 块唯一标识符
     QRectF m_boundingRect;           ///< 块的边界矩形
     qreal m_height = 0.0;            ///< 块的高度
-    int m_positionInDocument = -1;   ///< 块在文档中的全局位置索引
+    int m_indexInSection = -1;       ///< 块在所属节中的索引
 };
 
 } // namespace QtWordEditor
@@ -8,6 +8,8 @@
 #include <QFlags>
 #include "core/Global.h"
 
+class QDataStream;
+
 namespace QtWordEditor {
 
 class CharacterStyleData;
@@ -210,6 +212,12 @@ public:
      * @return 如果属性已设置返回true，否则返回false
      */
     bool isPropertySet(CharacterStyleProperty property) const;
+
+    /**
+     * @brief 获取所有已显式设置属性的标记
+     * @return 属性设置标记
+     */
+    CharacterStylePropertyFlags propertyFlags() const;
     
     /**
      * @brief 清除某个属性的设置标记，将其恢复为默认值
@@ -230,10 +238,36 @@ public:
      */
     CharacterStyle mergeWith(const CharacterStyle &other) const;
 
+    /**
+     * @brief 计算样式的哈希值（包含属性设置标记）
+     * 与operator==和propertyFlags()的组合保持一致，供样式池去重使用
+     * @param seed 哈希种子
+     * @return 哈希值
+     */
+    size_t hash(size_t seed = 0) const;
+
 private:
+    friend QDataStream &operator<<(QDataStream &out, const CharacterStyle &style);
+    friend QDataStream &operator>>(QDataStream &in, CharacterStyle &style);
+
     QSharedDataPointer<CharacterStyleData> d;  ///< 隐式共享数据指针
 };
 
+inline size_t qHash(const CharacterStyle &style, size_t seed = 0)
+{
+    return style.hash(seed);
+}
+
+/**
+ * @brief 序列化字符样式（属性值和属性设置标记，用于命令日志）
+ */
+QDataStream &operator<<(QDataStream &out, const CharacterStyle &style);
+
+/**
+ * @brief 反序列化字符样式
+ */
+QDataStream &operator>>(QDataStream &in, CharacterStyle &style);
+
 } // namespace QtWordEditor
 
 #endif // CHARACTERSTYLE_H
\ No newline at end of file
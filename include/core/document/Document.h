@@ -3,7 +3,12 @@
 
 #include <QObject>
 #include <QList>
+#include <QVector>
+#include <QPair>
+#include <QHash>
+#include <QSet>
 #include <QString>
+#include <QStringList>
 #include <QDateTime>
 #include <QUndoStack>
 #include "core/Global.h"
@@ -12,6 +17,11 @@ namespace QtWordEditor {
 
 class Section;
 class Block;
+class ParagraphBlock;
+class StyleManager;
+class UndoMemoryManager;
+class CommandJournal;
+class EditCommand;
 
 /**
  * @brief 文档类是整个文档的根容器
@@ -131,7 +141,7 @@ public:
     
     /**
      * @brief 获取文档中所有块的总数
-     * @return 所有节中块的总数量
+     * @return 所有节中块的总数量（O(1)，由块索引维护）
      */
     int blockCount() const;
     
@@ -139,9 +149,32 @@ public:
      * @brief 根据全局索引获取块
      * @param globalIndex 全局块索引（跨所有节）
      * @return 指向块的指针，如果索引无效则返回nullptr
+     *
+     * 通过节块数的树状数组（Fenwick 树）定位所在节，复杂度 O(log 节数)
      */
     Block *block(int globalIndex) const;
 
+    /**
+     * @brief 根据块ID获取块
+     * @param blockId 块唯一标识符
+     * @return 指向块的指针，如果不存在则返回nullptr
+     */
+    Block *blockById(int blockId) const;
+
+    /**
+     * @brief 获取块在文档中的全局索引
+     * @param block 要查找的块
+     * @return 全局块索引，如果块不属于本文档则返回-1
+     */
+    int indexOfBlock(const Block *block) const;
+
+    /**
+     * @brief 把一组块按文档顺序合并为连续的全局索引区间
+     * @param blocks 块（可以重复或无序，不属于本文档的块被忽略）
+     * @return 区间列表，每项为（第一个块索引，最后一个块索引），按文档顺序排列
+     */
+    QVector<QPair<int, int>> blockIndexRanges(const QList<Block*> &blocks) const;
+
     // ========== 撤销重做栈相关方法 ==========
     
     /**
@@ -150,6 +183,84 @@ public:
      */
     QUndoStack *undoStack() const;
 
+    /**
+     * @brief 获取撤销栈的内存管理器（内存预算和溢出文件）
+     * @return 内存管理器指针
+     */
+    UndoMemoryManager *undoMemoryManager() const;
+
+    /**
+     * @brief 执行编辑命令：压入撤销栈，设置了命令日志时同时写入日志
+     * @param command 要执行的命令（撤销栈接管所有权）
+     */
+    void pushCommand(EditCommand *command);
+
+    /**
+     * @brief 设置记录编辑命令的命令日志
+     * @param journal 命令日志，nullptr 表示不记录
+     */
+    void setCommandJournal(CommandJournal *journal);
+
+    /**
+     * @brief 获取命令日志
+     * @return 命令日志指针，未设置时返回nullptr
+     */
+    CommandJournal *commandJournal() const;
+
+    // ========== 命名样式相关方法 ==========
+
+    /**
+     * @brief 获取文档使用的样式管理器
+     * @return 样式管理器指针，未设置时返回nullptr
+     */
+    StyleManager *styleManager() const;
+
+    /**
+     * @brief 设置文档使用的样式管理器（由StyleManager::setDocument调用）
+     * @param styleManager 样式管理器指针
+     */
+    void setStyleManager(StyleManager *styleManager);
+
+    /**
+     * @brief 获取引用了任一指定字符样式的块（样式→块反向索引）
+     * @param styleNames 字符样式名称列表
+     * @return 去重后的块列表
+     */
+    QList<Block*> blocksUsingCharacterStyles(const QStringList &styleNames) const;
+
+    /**
+     * @brief 获取引用了任一指定段落样式的块（样式→块反向索引）
+     * @param styleNames 段落样式名称列表
+     * @return 去重后的块列表
+     */
+    QList<Block*> blocksUsingParagraphStyles(const QStringList &styleNames) const;
+
+    // ========== 批量修改相关方法 ==========
+
+    /**
+     * @brief 开始批量修改段落内容（可嵌套）
+     *
+     * 批量修改期间段落不再逐个发出 textChanged()，只记录下来；
+     * 最外层的 endBlockChanges() 统一发出一次 blocksChanged()。
+     */
+    void beginBlockChanges();
+
+    /**
+     * @brief 结束批量修改，最外层结束时更新样式反向索引并发出 blocksChanged()
+     */
+    void endBlockChanges();
+
+    /**
+     * @brief 是否处于批量修改中
+     */
+    bool isBatchingBlockChanges() const;
+
+    /**
+     * @brief 记录批量修改期间内容变化的段落（由 ParagraphBlock 调用）
+     * @param block 内容变化的段落
+     */
+    void noteBlockChanged(ParagraphBlock *block);
+
     // ========== 导出方法（主要用于测试）==========
     
     /**
@@ -177,12 +288,69 @@ signals:
     /** @brief 布局发生变化时发出的信号 */
     void layoutChanged();
 
+    /**
+     * @brief 批量修改结束时发出的信号，代替其间各段落的 textChanged()
+     * @param firstIndex 内容变化的第一个块的全局索引
+     * @param lastIndex 内容变化的最后一个块的全局索引
+     */
+    void blocksChanged(int firstIndex, int lastIndex);
+
 private:
     /**
-     * @brief 更新文档中所有块的全局位置
-     * 当节结构发生变化时调用此方法重新计算块的位置
+     * @brief 重建节索引和节块数树状数组
+     * 仅在节的插入/删除时调用（O(节数)），块的增删走增量更新
+     */
+    void rebuildSectionIndex();
+
+    /**
+     * @brief 连接节的块增删信号，使块索引随之增量更新
+     * @param section 要连接的节
      */
-    void updateBlockPositions();
+    void connectSection(Section *section);
+
+    /**
+     * @brief 将节中所有块登记到块ID哈希表
+     * @param section 要登记的节
+     */
+    void registerSectionBlocks(Section *section);
+
+    /**
+     * @brief 从块ID哈希表中注销节中所有块
+     * @param section 要注销的节
+     */
+    void unregisterSectionBlocks(Section *section);
+
+    /** @brief 节中插入块后的增量更新 */
+    void handleBlockInserted(Section *section, int localIndex);
+
+    /** @brief 节中即将删除块时的增量更新 */
+    void handleBlockAboutToBeRemoved(Section *section, int localIndex);
+
+    /** @brief 为块分配ID并登记到哈希表 */
+    void registerBlock(Block *block);
+
+    /** @brief 从哈希表中注销块 */
+    void unregisterBlock(Block *block);
+    /** @brief 段落的游程样式名称变化后，更新字符样式反向索引 */
+    void updateCharacterStyleUsage(ParagraphBlock *block);
+    /** @brief 段落的段落样式名称变化后，更新段落样式反向索引 */
+    void updateParagraphStyleUsage(ParagraphBlock *block);
+    /** @brief 从样式反向索引中移除块 */
+    void removeStyleUsage(Block *block);
+
+    /** @brief 树状数组：第 sectionIndex 个节的块数增加 delta */
+    void fenwickAdd(int sectionIndex, int delta);
+
+    /** @brief 树状数组：前 count 个节的块数之和 */
+    int fenwickPrefix(int count) const;
+
+    /**
+     * @brief 树状数组：查找全局索引所在的节
+     * @param globalIndex 全局块索引（必须小于 blockCount()）
+     * @param localIndex 输出参数，返回节内索引
+     * @return 节索引
+     */
+    int fenwickFind(int globalIndex, int *localIndex) const;
 
 private:
     int m_documentId = -1;          ///< 文档唯一标识符
@@ -191,7 +359,22 @@ private:
     QDateTime m_created;            ///< 文档创建时间
     QDateTime m_modified;           ///< 文档最后修改时间
     QList<Section*> m_sections;     ///< 文档包含的所有节列表
+    QVector<int> m_sectionBlockTree;            ///< 节块数的树状数组（下标从1开始）
+    QHash<const Section*, int> m_sectionIndices; ///< 节指针到节索引的映射
+    QHash<int, Block*> m_blocksById;            ///< 块ID到块的映射
+    int m_totalBlockCount = 0;                  ///< 文档块总数
+    int m_nextBlockId = 1;                      ///< 下一个可分配的块ID
+    int m_blockChangeDepth = 0;                 ///< 批量修改的嵌套深度
+    QSet<ParagraphBlock*> m_changedBlocks;      ///< 批量修改期间内容变化的段落
+
+    StyleManager *m_styleManager = nullptr;                  ///< 样式管理器（不拥有）
+    QHash<QString, QSet<Block*>> m_characterStyleUsers;      ///< 字符样式名称 → 引用它的块
+    QHash<QString, QSet<Block*>> m_paragraphStyleUsers;      ///< 段落样式名称 → 引用它的块
+    QHash<Block*, QSet<QString>> m_blockCharacterStyles;     ///< 块 → 其游程引用的字符样式名称
+    QHash<Block*, QString> m_blockParagraphStyles;           ///< 块 → 其段落样式名称
     QScopedPointer<QUndoStack> m_undoStack; ///< 撤销重做栈
+    UndoMemoryManager *m_undoMemory = nullptr;  ///< 撤销栈内存预算与溢出（子对象）
+    CommandJournal *m_commandJournal = nullptr; ///< 崩溃恢复用的命令日志（可选）
 };
 
 } // namespace QtWordEditor
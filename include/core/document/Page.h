@@ -9,10 +9,32 @@ namespace QtWordEditor {
 
 class Block;
 
+/**
+ * @brief A block fragment: the part of a block that lies on one page.
+ *
+ * Paragraphs are split between pages at line granularity; other blocks are
+ * always placed whole (a single fragment covering the block).
+ */
+struct BlockFragment
+{
+    Block *block = nullptr;
+    int startLine = 0;          // first line on this page
+    int endLine = -1;           // one past the last line on this page; -1 = to the end of the block
+    qreal offset = 0.0;         // top of the first line, relative to the block's first line
+    qreal textHeight = 0.0;     // height of the lines on this page
+    qreal height = 0.0;         // space used on the page, including paragraph spacing
+
+    bool isFirst() const { return startLine == 0; }
+    bool isLast() const { return endLine < 0; }
+    bool isWhole() const { return isFirst() && isLast(); }
+};
+
 /**
  * @brief The Page class represents a physical page generated by the layout engine.
  *
- * It contains references to blocks that appear on this page (non-owning).
+ * It contains references to the block fragments that appear on this page
+ * (non-owning). A paragraph that breaks across pages has one fragment on each
+ * page; block(i) returns the block of fragment i.
  */
 class Page
 {
@@ -31,12 +53,17 @@ public:
     void addBlock(Block *block);
     void clearBlocks();
     bool isEmpty() const;
+    bool containsBlock(const Block *block) const;
+
+    // Fragment access (one fragment per block entry)
+    BlockFragment fragment(int index) const;
+    void addFragment(const BlockFragment &fragment);
 
 private:
     int m_pageNumber;
     QRectF m_pageRect;
     QRectF m_contentRect;
-    QList<Block*> m_blocks; // non-owning references
+    QList<BlockFragment> m_fragments; // non-owning references
 };
 
 } // namespace QtWordEditor
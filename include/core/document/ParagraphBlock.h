@@ -5,14 +5,44 @@
 #include "ParagraphStyle.h"
 #include "Span.h"
 #include <QList>
+#include <QVector>
+#include <QSet>
+#include <QDataStream>
 #include "core/Global.h"
 
 namespace QtWordEditor {
 
+class StyleManager;
+
+/**
+ * @brief The StyleRun struct describes a range of uniformly styled characters.
+ *
+ * Runs do not own text; they index into the paragraph's text buffer.
+ */
+struct StyleRun
+{
+    int length = 0;          ///< Number of characters covered by the run
+    QString styleName;       ///< Named character style (optional)
+    int styleId = 0;         ///< Direct character style, interned in StylePool
+};
+
+// Serialization of style runs (used by the undo spill file; style IDs are only valid within the process)
+QDataStream &operator<<(QDataStream &out, const StyleRun &run);
+QDataStream &operator>>(QDataStream &in, StyleRun &run);
+
 /**
  * @brief The ParagraphBlock class represents a text paragraph.
  *
- * It contains a list of spans and paragraph-level formatting.
+ * The text is stored in a single contiguous buffer and formatting in a
+ * separate array of style runs with cached cumulative offsets, so offset
+ * lookups are binary searches and style changes never touch the text.
+ * Spans are still available as a read-only view via span()/spanCount().
+ * Character and paragraph styles are held as StylePool IDs, so comparing
+ * the formatting of two runs is an integer compare.
+ *
+ * Runs and the paragraph may also reference named styles from the
+ * StyleManager; the effective style is the resolved named style with the
+ * direct style merged on top.
  */
 class ParagraphBlock : public Block
 {
@@ -28,15 +58,32 @@ public:
     void insert(int position, const QString &text, const CharacterStyle &style);
     void remove(int position, int length);
 
-    // Span access
+    // Span access (view over the style runs)
     int spanCount() const;
     Span span(int index) const;
+    int spanStart(int index) const;
     void addSpan(const Span &span);
     void setSpan(int index, const Span &span);
 
     // Paragraph style
     ParagraphStyle paragraphStyle() const;
     void setParagraphStyle(const ParagraphStyle &style);
+    int paragraphStyleId() const;
+    QString paragraphStyleName() const;
+    void setParagraphStyleName(const QString &styleName);
+    ParagraphStyle effectiveParagraphStyle() const;
+
+    // Named character styles
+    void setStyleName(int start, int length, const QString &styleName);
+    QSet<QString> characterStyleNames() const;
+    CharacterStyle effectiveStyleAt(int position) const;
+    bool hasNamedStyles() const;
+
+    // Change counters used to key layout caches. contentVersion() changes
+    // whenever text or runs change, styleVersion() when the paragraph style
+    // or its name changes.
+    quint64 contentVersion() const;
+    quint64 styleVersion() const;
 
     // Overrides from Block
     int length() const override;
@@ -48,10 +95,21 @@ public:
     
     // Helper: get character style at a specific position
     CharacterStyle styleAt(int position) const;
+    int styleIdAt(int position) const;
     
     // Helper: set character style for a range
     void setStyle(int start, int length, const CharacterStyle &style);
     
+    // All style runs in order, without copying
+    const QVector<StyleRun> &styleRuns() const;
+
+    // Style runs clipped to [start, start + length); only the runs overlapping the range are copied
+    QVector<StyleRun> runs(int start, int length) const;
+
+    // Replace the formatting of [start, start + length) with runs whose lengths add up to length,
+    // leaving the text untouched; emits a single textChanged()
+    void replaceRuns(int start, int length, const QVector<StyleRun> &runs);
+
     // Helper: check if a range spans multiple spans
     // @return true=范围跨多个Span（样式不一致），false=范围在单个Span内（样式一致）
     bool isRangeSpansMultipleSpans(int start, int end) const;
@@ -61,17 +119,45 @@ public:
 
 signals:
     void textChanged();
+    void paragraphStyleNameChanged();
+    // Emitted (also during document batches) when runs carrying a character
+    // style name were added, removed or renamed; plain typing does not emit it
+    void characterStyleNamesChanged();
 
 private:
-    // Helper to maintain span consistency after modification
-    void mergeAdjacentSpans();
+    // Helper to merge equal neighbouring runs in [first, last]
+    void mergeAdjacentSpans(int first = 0, int last = -1);
     
     // Helper to validate position and length parameters
     bool validatePositionAndLength(int& position, int& length) const;
 
+    // Split the run containing offset so that a run starts at offset; returns that run index
+    int splitRunAt(int offset);
+
+    // Recompute cached run start offsets from the first dirty run
+    void ensureRunStarts() const;
+    void invalidateRunStarts(int fromRun);
+
+    static bool sameRunStyle(const StyleRun &a, const StyleRun &b);
+
+    // Whether any run in [first, end) references a named character style
+    bool hasStyleNames(int first, int end) const;
+
+    // Style manager of the owning document, if any
+    const StyleManager *styleManager() const;
+
+    // Bump the content version and emit textChanged()
+    void notifyContentChanged();
+
 private:
-    QList<Span> m_spans;
-    ParagraphStyle m_paragraphStyle;
+    QString m_text;                       ///< Contiguous paragraph text
+    QVector<StyleRun> m_runs;             ///< Style runs covering m_text
+    mutable QVector<int> m_runStarts;     ///< Cached start offset of each run
+    mutable int m_runStartsDirtyFrom = 0; ///< First run whose cached start is stale
+    int m_paragraphStyleId = 0;           ///< Paragraph style, interned in StylePool
+    QString m_paragraphStyleName;         ///< Named paragraph style (optional)
+    quint64 m_contentVersion = 0;         ///< Bumped on every text/run change
+    quint64 m_styleVersion = 0;           ///< Bumped on paragraph style changes
 };
 
 } // namespace QtWordEditor
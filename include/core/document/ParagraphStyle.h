@@ -6,6 +6,8 @@
 #include <QFlags>
 #include "core/Global.h"
 
+class QDataStream;
+
 namespace QtWordEditor {
 
 /**
@@ -184,6 +186,12 @@ public:
      * @return 如果属性已设置返回true，否则返回false
      */
     bool isPropertySet(ParagraphStyleProperty property) const;
+
+    /**
+     * @brief 获取所有已显式设置属性的标记
+     * @return 属性设置标记
+     */
+    ParagraphStylePropertyFlags propertyFlags() const;
     
     /**
      * @brief 清除某个属性的设置标记，将其恢复为默认值
@@ -204,10 +212,35 @@ public:
      */
     ParagraphStyle mergeWith(const ParagraphStyle &other) const;
 
+    /**
+     * @brief 计算样式的哈希值（包含属性设置标记）
+     * @param seed 哈希种子
+     * @return 哈希值
+     */
+    size_t hash(size_t seed = 0) const;
+
 private:
+    friend QDataStream &operator<<(QDataStream &out, const ParagraphStyle &style);
+    friend QDataStream &operator>>(QDataStream &in, ParagraphStyle &style);
+
     QSharedDataPointer<ParagraphStyleData> d;  ///< 隐式共享数据指针
 };
 
+inline size_t qHash(const ParagraphStyle &style, size_t seed = 0)
+{
+    return style.hash(seed);
+}
+
+/**
+ * @brief 序列化段落样式（属性值和属性设置标记，用于命令日志）
+ */
+QDataStream &operator<<(QDataStream &out, const ParagraphStyle &style);
+
+/**
+ * @brief 反序列化段落样式
+ */
+QDataStream &operator>>(QDataStream &in, ParagraphStyle &style);
+
 } // namespace QtWordEditor
 
 #endif // PARAGRAPHSTYLE_H
\ No newline at end of file
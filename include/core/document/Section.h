@@ -35,6 +35,7 @@ public:
     // Blocks
     int blockCount() const;
     Block *block(int index) const;
+    int indexOfBlock(const Block *block) const;
     void addBlock(Block *block);
     void insertBlock(int index, Block *block);
     void removeBlock(int index);
@@ -43,14 +44,18 @@ public:
     int pageCount() const;
     Page *page(int index) const;
     void addPage(Page *page);
+    void replacePages(int index, int count, const QList<Page*> &pages);
     void clearPages();
 
 signals:
     void blockAdded(int index);
+    void blockAboutToBeRemoved(int index);
     void blockRemoved(int index);
     void pagesChanged();
 
 private:
+    void renumberBlocks(int from);
+
     int m_sectionNumber = 0;
     QString m_header;
     QString m_footer;
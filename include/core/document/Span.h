@@ -44,6 +44,7 @@ public:
     // 直接样式（覆盖命名样式）
     CharacterStyle directStyle() const;
     void setDirectStyle(const CharacterStyle &style);
+    int directStyleId() const;  // StylePool中的ID
 
     // 获取最终生效的样式（命名样式 + 直接样式）
     CharacterStyle effectiveStyle(const StyleManager *styleManager) const;
@@ -3,12 +3,18 @@
 
 #include <QObject>
 #include <QHash>
+#include <QVector>
+#include <QSharedPointer>
+#include <QThreadPool>
+#include "core/layout/ParagraphLayout.h"
 #include "core/Global.h"
 
 namespace QtWordEditor {
 
 class Document;
 class Block;
+class ParagraphBlock;
+class Page;
 
 /**
  * @brief 布局引擎类，负责文档内容的分页和块的位置大小计算
@@ -17,7 +23,18 @@ class Block;
  * 1. 根据页面设置对文档内容进行分页
  * 2. 计算每个块在页面上的精确位置和尺寸
  * 3. 处理增量布局以提高性能
- * 4. 缓存块高度信息以避免重复计算
+ * 4. 缓存段落排版结果以避免重复计算
+ *
+ * 段落由 ParagraphLayout 用 QTextLayout 整形为行框。结果按块ID缓存，
+ * 以段落的内容版本、样式版本、命名样式代数和可用宽度为键，
+ * 未变化的段落不会被重新整形。
+ *
+ * 大文档可以用 startBackgroundLayout() 在工作线程上分页：界面线程只为文档拍一份
+ * 不可变快照（文本、已解析的格式和缓存命中的排版结果），整形和分页都在工作线程进行，
+ * 完成的页面分批发布到 Section 并通过 pagesAppended() 通知。
+ * 两种完整分页都先把缓存未命中的段落分发到全局线程池并行整形，
+ * 再顺序运行 PageBuilder。
+ * 文档在分页期间被修改时，任务被取消并从修改处重新开始。
  */
 class LayoutEngine : public QObject
 {
@@ -64,6 +81,12 @@ public:
      */
     void getPageSize(qreal *width, qreal *height, qreal *margin) const;
 
+    /**
+     * @brief 获取页面内容区宽度
+     * @return 页面宽度减去左右边距
+     */
+    qreal contentWidth() const;
+
     // ========== 布局执行方法 ==========
     
     /**
@@ -74,10 +97,59 @@ public:
 
     /**
      * @brief 从指定块索引开始执行增量布局
-     * @param blockIndex 开始布局的块索引
-     * 用于优化性能，只重新布局受影响的部分
+     *
+     * 从包含该块的页面（的前一页）开始重新分页，一旦新的分页点与上一次布局中
+     * 某个分页点落在同一块的同一行、且已越过修改范围，即停止：之后的页面保持不变。
+     * 只有实际变化的页面会被替换并通过 pagesChanged() 通知。
+     * 尚未执行过完整布局时退化为 layout()。
+     *
+     * @param blockIndex 第一个被修改的块的全局索引
+     * @param lastChangedBlock 最后一个被修改的块的全局索引，默认与 blockIndex 相同
+     */
+    void layoutFrom(int blockIndex, int lastChangedBlock = -1);
+
+    // ========== 后台分页 ==========
+
+    /**
+     * @brief 在工作线程上分页，完成的页面分批发布
+     *
+     * 从包含 fromBlock 的已发布页面的前一页开始，按文档顺序重新生成该页及之后的页面。
+     * 旧页面在新页面到达前保留显示，每批新页面原位替换同样数量的旧页面
+     * （通过 pagesChanged() 通知），节的最后一批替换掉该节剩余的旧页面。
+     * 第一批只包含 priorityPageCount() 页，使视口内的页面尽快可见，
+     * 其余页面在后面按批补齐。正在进行的后台分页会被取消。
+     *
+     * @param fromBlock 起始块的全局索引，默认从头开始
+     */
+    void startBackgroundLayout(int fromBlock = 0);
+
+    /**
+     * @brief 取消正在进行的后台分页，已发布的页面保留
      */
-    void layoutFrom(int blockIndex);
+    void cancelBackgroundLayout();
+
+    /**
+     * @brief 后台分页是否正在进行
+     */
+    bool isBackgroundLayoutRunning() const;
+
+    /**
+     * @brief 设置后台分页第一批发布的页数（通常为视口能显示的页数）
+     * @param count 页数，至少为1
+     */
+    void setPriorityPageCount(int count);
+
+    /**
+     * @brief 获取后台分页第一批发布的页数
+     */
+    int priorityPageCount() const;
+
+    /**
+     * @brief 设置拆分段落时的孤行控制
+     * @param minOrphanLines 段落在页底至少保留的行数
+     * @param minWidowLines 段落转到下一页顶部的至少行数
+     */
+    void setWidowOrphanControl(int minOrphanLines, int minWidowLines);
 
     /**
      * @brief 计算指定块的高度
@@ -87,16 +159,135 @@ public:
      */
     qreal calculateBlockHeight(Block *block, qreal maxWidth);
 
+    /**
+     * @brief 获取段落的排版结果（按内容区宽度），命中缓存时不重新整形
+     * @param block 段落块
+     * @return 排版结果
+     */
+    ParagraphLayoutPtr paragraphLayout(ParagraphBlock *block);
+
+    /**
+     * @brief 获取段落在指定可用宽度下的排版结果
+     * @param block 段落块
+     * @param width 可用宽度
+     * @return 排版结果
+     */
+    ParagraphLayoutPtr paragraphLayout(ParagraphBlock *block, qreal width);
+
 signals:
     /** @brief 布局发生变化时发出的信号 */
     void layoutChanged();
 
+    /**
+     * @brief 增量布局替换了一段页面时发出的信号
+     * @param firstPage 第一个被替换页面在文档中的页序号（从0开始）
+     * @param removedCount 被移除的旧页面数
+     * @param addedCount 插入的新页面数
+     */
+    void pagesChanged(int firstPage, int removedCount, int addedCount);
+
+    /**
+     * @brief 后台分页发布了一批新页面、且没有可替换的旧页面时发出的信号
+     * （页面已追加到所属节的末尾）
+     * @param firstPage 第一个新页面在文档中的页序号（从0开始）
+     * @param count 新页面数
+     */
+    void pagesAppended(int firstPage, int count);
+
+    /** @brief 后台分页完成时发出的信号 */
+    void backgroundLayoutFinished();
+
 private:
+    /**
+     * @brief 段落排版缓存条目
+     */
+    struct CachedParagraphLayout {
+        quint64 contentVersion = 0;     ///< 排版时的段落内容版本
+        quint64 styleVersion = 0;       ///< 排版时的段落样式版本
+        quint64 styleGeneration = 0;    ///< 排版时段落引用的命名样式的有效代数（未引用命名样式时为0）
+        qreal width = 0.0;              ///< 排版时的可用宽度
+        ParagraphLayoutPtr layout;      ///< 排版结果
+    };
+
+    /** @brief 并行整形文档中所有缓存未命中的段落并写入缓存 */
+    void shapeParagraphs(qreal width);
+
+    /** @brief 查找段落在指定宽度下仍然有效的缓存条目，没有时返回nullptr */
+    const CachedParagraphLayout *findParagraphLayout(const ParagraphBlock *block, qreal width) const;
+
+    /** @brief 段落引用的命名样式（含继承链）有效代数的最大值 */
+    quint64 styleGenerationFor(const ParagraphBlock *block) const;
+
+    /** @brief 丢弃已不在文档中的块的缓存 */
+    void pruneParagraphLayouts();
+
+    /**
+     * @brief 分页点：一页的起始块（全局索引）和起始行（段落跨页时不为0）
+     */
+    struct PageBreak {
+        int blockIndex = 0;
+        int line = 0;
+    };
+
+    /** @brief 文档中插入块后，平移其后的分页点 */
+    void handleBlockAdded(int globalIndex);
+
+    /** @brief 文档中删除块前，平移其后的分页点 */
+    void handleBlockRemoved(int globalIndex);
+
+    /** @brief 节结构变化后，分页点表失效，下次增量布局退化为完整布局 */
+    void invalidatePageBreaks();
+
+    /** @brief 节被添加或删除：分页点表失效，正在进行的后台分页从头重来 */
+    void handleSectionsChanged();
+
+    /** @brief 在 [first, last) 范围的旧分页点中查找与给定分页点相同的页 */
+    int findPageBreak(const PageBreak &pageBreak, int first, int last) const;
+
+    /** @brief 节内包含指定块开头的页（相对于节的页序号），firstPage 为节的第一页在文档中的页序号 */
+    int pageContainingBlock(int firstPage, int sectionPages, int blockIndex) const;
+
+    /** @brief 分页用的行框：段落返回其排版结果，其他块返回空指针（整体放置） */
+    ParagraphLayoutPtr linesForPaging(Block *block, qreal width);
+
+    /** @brief 两页是否包含相同的块片段 */
+    static bool samePageContent(const Page *a, const Page *b);
+
+    struct BlockSnapshot;
+    struct PaginationJob;
+    struct PaginationBatch;
+
+    /** @brief 在界面线程为一个块拍快照，缓存未命中的段落提取整形输入 */
+    BlockSnapshot snapshotBlock(Block *block, int globalIndex, qreal width) const;
+
+    /** @brief 并行整形快照 [first, last) 中需要整形的段落 */
+    static void shapeSnapshots(QVector<BlockSnapshot> &snapshots, int first, int last, qreal width);
+
+    /** @brief 工作线程入口：整形并分页，分批把结果投递回界面线程 */
+    static void paginate(LayoutEngine *engine, QSharedPointer<PaginationJob> job);
+
+    /** @brief 在界面线程应用一批结果；已取消任务的结果被丢弃 */
+    void applyBatch(const QSharedPointer<PaginationJob> &job, const QSharedPointer<PaginationBatch> &batch);
+
+    /** @brief 结构修改打断了后台分页：取消当前任务，在事件循环中从 blockIndex 处重新开始 */
+    void scheduleBackgroundRestart(int blockIndex);
+
     Document *m_document = nullptr;     ///< 当前布局的文档
     qreal m_pageWidth = 595.0;          ///< 页面宽度（A4纸宽，单位：点）
     qreal m_pageHeight = 842.0;         ///< 页面高度（A4纸高，单位：点）
     qreal m_margin = 72.0;              ///< 页面边距（1英寸，单位：点）
-    QHash<Block*, qreal> m_cachedHeights; ///< 块高度缓存，避免重复计算
+    QHash<int, CachedParagraphLayout> m_paragraphLayouts; ///< 块ID → 段落排版缓存
+    QVector<PageBreak> m_pageBreaks;    ///< 文档顺序中每一页的起点
+    bool m_pageBreaksValid = false;     ///< 分页点表是否与当前页面一致
+    int m_minOrphanLines = 2;           ///< 段落在页底至少保留的行数
+    int m_minWidowLines = 2;            ///< 段落在页顶至少保留的行数
+
+    QThreadPool m_threadPool;                   ///< 后台分页线程（同一时刻只运行一个任务）
+    QSharedPointer<PaginationJob> m_job;        ///< 当前的后台分页任务
+    int m_priorityPageCount = 2;                ///< 第一批发布的页数
+    bool m_restartPending = false;              ///< 是否已安排重新开始后台分页
+    int m_restartFrom = 0;                      ///< 重新开始的块索引
+    int m_laidOutPages = 0;                     ///< 后台分页已替换到的页序号，之后的页面仍是旧的分页结果
 };
 
 } // namespace QtWordEditor
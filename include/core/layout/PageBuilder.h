@@ -2,15 +2,20 @@
 #define PAGEBUILDER_H
 
 #include <QList>
+#include "core/document/Page.h"
 #include "core/Global.h"
 
 namespace QtWordEditor {
 
 class Block;
-class Page;
+class ParagraphLayout;
 
 /**
  * @brief The PageBuilder class assists the layout engine in distributing blocks across pages.
+ *
+ * Pages are filled exactly to the content height. Paragraphs that do not fit
+ * are split at line granularity using their cached line boxes, honouring the
+ * widow/orphan limits; other blocks move to the next page whole.
  */
 class PageBuilder
 {
@@ -21,6 +26,21 @@ public:
     // Try to add a block to the current page; returns true if successful.
     bool tryAddBlock(Block *block);
 
+    // Same as above with a precomputed height; the block is not dereferenced,
+    // so this is safe to call from a worker thread.
+    bool tryAddBlock(Block *block, qreal height);
+
+    // Place a block starting at *line, splitting a paragraph (layout != nullptr)
+    // between lines when it does not fit. Updates *line to the first line not
+    // yet placed and returns true once the whole block is on a page; on false
+    // the caller finishes the page and calls again with the same line.
+    // The block is not dereferenced, so this is safe on a worker thread.
+    bool addBlock(Block *block, qreal height, const ParagraphLayout *layout, int *line);
+
+    // Minimum lines of a split paragraph left at the bottom of a page (orphans)
+    // and carried to the top of the next page (widows). 1 disables the control.
+    void setWidowOrphanControl(int minOrphanLines, int minWidowLines);
+
     // Finish the current page and return a Page object.
     Page *finishPage();
 
@@ -34,7 +54,9 @@ private:
     qreal m_contentWidth;
     qreal m_contentHeight;
     qreal m_currentY;
-    QList<Block*> m_currentPageBlocks;
+    int m_minOrphanLines;
+    int m_minWidowLines;
+    QList<BlockFragment> m_currentPageFragments;
 };
 
 } // namespace QtWordEditor
@@ -0,0 +1,217 @@
+#ifndef PARAGRAPHLAYOUT_H
+#define PARAGRAPHLAYOUT_H
+
+#include <QVector>
+#include <QSharedPointer>
+#include <QString>
+#include <QFont>
+#include <QTextLayout>
+#include <QTextCharFormat>
+#include <QGlyphRun>
+#include <QRawFont>
+#include <QHash>
+#include <QColor>
+#include <QRectF>
+#include "core/document/ParagraphStyle.h"
+#include "core/Global.h"
+
+class QPainter;
+
+namespace QtWordEditor {
+
+class ParagraphBlock;
+class CharacterStyle;
+
+/**
+ * @brief 行内一段同格式的字形，坐标与行框相同（相对于段落左上角）
+ *
+ * 只保存与线程无关的数据：QGlyphRun 持有的 QRawFont 只能在创建它的线程中使用，
+ * 而排版结果在后台线程整形、在界面线程和图块线程绘制，绘制时由 GlyphFontCache
+ * 在绘制线程重新取得字体。
+ */
+struct GlyphSpan
+{
+    QFont font;                         ///< 字形实际使用的字体（字体回退后的字族）
+    QString fontKey;                    ///< font.key()，用作 GlyphFontCache 的键
+    QVector<quint32> glyphIndexes;      ///< 字形索引
+    QVector<QPointF> positions;         ///< 每个字形的位置
+    QGlyphRun::GlyphRunFlags flags;     ///< 下划线、删除线等标记
+    QColor color;               ///< 文字颜色
+    QColor background;          ///< 背景色，无背景时为无效颜色
+    qreal x = 0.0;              ///< 字形范围的左边界
+    qreal width = 0.0;          ///< 字形范围的宽度
+};
+
+/**
+ * @brief 行框，描述段落排版后的一行
+ *
+ * 坐标均相对于段落左上角（y 已包含段前间距）。
+ */
+struct LineBox
+{
+    int start = 0;              ///< 行首字符在段落中的偏移
+    int length = 0;             ///< 行内字符数
+    qreal x = 0.0;              ///< 行左边界（含缩进）
+    qreal y = 0.0;              ///< 行顶
+    qreal width = 0.0;          ///< 行可用宽度
+    qreal naturalWidth = 0.0;   ///< 行内文本的自然宽度
+    qreal ascent = 0.0;         ///< 上升高度
+    qreal descent = 0.0;        ///< 下降高度
+    qreal height = 0.0;         ///< 行高（已按行距百分比缩放）
+    QVector<qreal> caretX;      ///< 行内每个光标位置的 x 坐标（length + 1 个，含对齐偏移）
+    QVector<GlyphSpan> glyphs;  ///< 行内的字形，按格式区间分段，可直接绘制
+
+    /** @brief 基线的 y 坐标 */
+    qreal baseline() const { return y + ascent; }
+};
+
+/**
+ * @brief 绘制线程的字体缓存，把 GlyphSpan 的字体转换为 QRawFont
+ *
+ * QRawFont 不能跨线程使用，每个绘制线程各自持有一个缓存。
+ */
+class GlyphFontCache
+{
+public:
+    /**
+     * @brief 获取字形段在当前线程可用的字体
+     * @param span 字形段
+     * @return 字体，字族无法解析时无效
+     */
+    QRawFont rawFont(const GlyphSpan &span);
+
+    /** @brief 清空缓存 */
+    void clear();
+
+private:
+    QHash<QString, QRawFont> m_fonts;
+};
+
+/**
+ * @brief 段落整形的输入：文本、已解析的格式区间和生效的段落样式
+ *
+ * 由 ParagraphLayout::prepare() 在界面线程从段落中提取（需要解析命名样式），
+ * 之后与文档无关，可以交给工作线程整形。
+ */
+struct ParagraphLayoutInput
+{
+    QString text;                                   ///< 段落文本
+    QVector<QTextLayout::FormatRange> formats;      ///< 每个样式游程的字符格式
+    QFont defaultFont;                              ///< 段落默认字体（空段落的行高由它决定）
+    ParagraphStyle style;                           ///< 生效的段落样式
+};
+
+/**
+ * @brief 段落排版结果，由 QTextLayout 对 ParagraphBlock 整形得到
+ *
+ * 结果是不可变的值对象，由 LayoutEngine 按段落缓存。
+ * 排版遵循段落样式中的左右缩进、首行缩进、对齐方式、段前段后间距和行距。
+ */
+class ParagraphLayout
+{
+public:
+    ParagraphLayout();
+
+    /**
+     * @brief 对段落进行整形和断行
+     * @param block 要排版的段落
+     * @param availableWidth 可用宽度（页面内容区宽度）
+     * @return 排版结果
+     */
+    static ParagraphLayout shape(const ParagraphBlock *block, qreal availableWidth);
+
+    /**
+     * @brief 提取段落的整形输入（解析命名样式，只能在界面线程调用）
+     * @param block 段落
+     * @return 整形输入
+     */
+    static ParagraphLayoutInput prepare(const ParagraphBlock *block);
+
+    /**
+     * @brief 按整形输入进行整形和断行，不访问文档，可在任意线程调用
+     * @param input 整形输入
+     * @param availableWidth 可用宽度
+     * @return 排版结果
+     */
+    static ParagraphLayout shape(const ParagraphLayoutInput &input, qreal availableWidth);
+
+    /**
+     * @brief 并行整形一组段落
+     *
+     * 段落在固定宽度下的断行互不依赖：各线程从共享计数器领取段落，
+     * 结果写入各自的槽位，调用线程也参与整形，最后按输入顺序返回。
+     * 段落较少或线程池已满时退化为在调用线程上逐个整形。
+     *
+     * @param inputs 整形输入（调用期间必须保持有效）
+     * @param availableWidth 可用宽度
+     * @return 与 inputs 一一对应的排版结果
+     */
+    static QVector<QSharedPointer<const ParagraphLayout>> shapeParallel(const QVector<const ParagraphLayoutInput*> &inputs,
+                                                                        qreal availableWidth);
+
+    /**
+     * @brief 把字符样式转换为字符格式（排版和渲染共用，保证两者一致）
+     * @param style 生效的字符样式
+     * @return 字符格式
+     */
+    static QTextCharFormat charFormat(const CharacterStyle &style);
+
+    /**
+     * @brief 把段落对齐方式转换为 Qt 对齐标志
+     * @param alignment 段落对齐方式
+     * @return Qt 对齐标志
+     */
+    static Qt::Alignment qtAlignment(ParagraphAlignment alignment);
+
+    /**
+     * @brief 绘制一段行的背景和字形（段落坐标），只读访问，可在任意线程调用
+     * @param painter 绘制器
+     * @param firstLine 第一行
+     * @param lastLine 最后一行之后的行
+     * @param exposed 需要绘制的区域（段落坐标），与之不相交的行跳过
+     * @param fonts 绘制线程的字体缓存，为空时本次绘制临时创建
+     */
+    void draw(QPainter *painter, int firstLine, int lastLine, const QRectF &exposed,
+              GlyphFontCache *fonts = nullptr) const;
+
+    /** @brief 获取所有行框 */
+    const QVector<LineBox> &lines() const;
+
+    /** @brief 获取行数 */
+    int lineCount() const;
+
+    /**
+     * @brief 查找包含指定字符偏移的行
+     * @param offset 段落内字符偏移
+     * @return 行索引；段落末尾的偏移属于最后一行
+     */
+    int lineForOffset(int offset) const;
+
+    /** @brief 排版时使用的可用宽度 */
+    qreal availableWidth() const;
+
+    /** @brief 段前间距 */
+    qreal spaceBefore() const;
+
+    /** @brief 段后间距 */
+    qreal spaceAfter() const;
+
+    /** @brief 所有行的总高度（不含段前段后间距） */
+    qreal textHeight() const;
+
+    /** @brief 段落总高度（段前间距 + 行高之和 + 段后间距） */
+    qreal height() const;
+
+private:
+    QVector<LineBox> m_lines;
+    qreal m_availableWidth = 0.0;
+    qreal m_spaceBefore = 0.0;
+    qreal m_spaceAfter = 0.0;
+    qreal m_textHeight = 0.0;
+};
+
+using ParagraphLayoutPtr = QSharedPointer<const ParagraphLayout>;
+
+} // namespace QtWordEditor
+
+#endif // PARAGRAPHLAYOUT_H
@@ -4,6 +4,9 @@
 #include <QObject>
 #include <QHash>
 #include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QPair>
 #include "core/document/CharacterStyle.h"
 #include "core/document/ParagraphStyle.h"
 #include "core/Global.h"
@@ -30,6 +33,14 @@ struct ParagraphStyleInfo {
     QString parentStyleName;        ///< 父样式名称（可选）
 };
 
+/**
+ * @brief 解析样式缓存的统计信息（用于性能分析）
+ */
+struct StyleCacheStats {
+    quint64 hits = 0;               ///< 命中次数
+    quint64 misses = 0;             ///< 未命中次数（重新解析继承链）
+};
+
 /**
  * @brief 样式管理器类，管理命名的字符样式和段落样式
  *
@@ -39,6 +50,10 @@ struct ParagraphStyleInfo {
  * 3. 样式到文档内容的应用
  * 4. 样式模板的维护和复用
  * 5. 样式继承机制
+ *
+ * 解析继承后的样式按名称缓存。每次添加、修改父样式或删除样式时，
+ * 该名称的代数（generation）递增；缓存条目记录解析时继承链上每个名称的代数，
+ * 只要链上任一样式发生变化，条目即失效。
  */
 class StyleManager : public QObject
 {
@@ -124,6 +139,14 @@ public:
      */
     void removeCharacterStyle(const QString &name);
 
+    /**
+     * @brief 获取指定字符样式及其所有后代样式的名称
+     * 修改某个样式后，只有引用这些样式的块需要重新渲染
+     * @param name 样式名称
+     * @return 包含name本身在内的样式名称列表
+     */
+    QStringList dependentCharacterStyles(const QString &name) const;
+
     // ========== 段落样式管理方法 ==========
     
     /**
@@ -181,6 +204,13 @@ public:
      */
     void removeParagraphStyle(const QString &name);
 
+    /**
+     * @brief 获取指定段落样式及其所有后代样式的名称
+     * @param name 样式名称
+     * @return 包含name本身在内的样式名称列表
+     */
+    QStringList dependentParagraphStyles(const QString &name) const;
+
     // ========== 样式应用方法 ==========
     
     /**
@@ -199,6 +229,42 @@ public:
      */
     void applyParagraphStyle(const QString &styleName, const QList<int> &blockIndices);
 
+    // ========== 解析缓存统计 ==========
+
+    /**
+     * @brief 获取解析样式缓存的命中/未命中计数
+     * @return 字符样式和段落样式缓存的累计统计
+     */
+    StyleCacheStats resolvedStyleCacheStats() const;
+
+    /**
+     * @brief 清零解析样式缓存的统计计数
+     */
+    void resetResolvedStyleCacheStats();
+
+    /**
+     * @brief 获取样式表的全局代数
+     * 任一命名样式被添加、修改父样式或删除时递增，供排版缓存判断命名样式是否可能已变化
+     * @return 当前代数
+     */
+    quint64 generation() const;
+
+    /**
+     * @brief 获取字符样式名称的有效代数
+     * 取继承链上每个名称（包括链末端不存在的父样式名称）代数的最大值，
+     * 链上任一样式被添加、修改父样式或删除时变大，其他样式的修改不影响它
+     * @param name 样式名称
+     * @return 有效代数，名称从未出现过时为0
+     */
+    quint64 characterStyleGeneration(const QString &name) const;
+
+    /**
+     * @brief 获取段落样式名称的有效代数，规则同 characterStyleGeneration()
+     * @param name 样式名称
+     * @return 有效代数，名称从未出现过时为0
+     */
+    quint64 paragraphStyleGeneration(const QString &name) const;
+
 signals:
     /** @brief 样式发生改变时发出的信号 */
     void stylesChanged();
@@ -217,10 +283,58 @@ private:
      * @brief 初始化默认段落样式
      */
     void initializeDefaultParagraphStyles();
+
+    /**
+     * @brief 解析缓存条目
+     * chain记录解析时继承链上的样式名称及其代数（包括链末端不存在的父样式名称）
+     */
+    template <typename Style>
+    struct ResolvedStyleEntry {
+        Style style;
+        QVector<QPair<QString, quint64>> chain;
+    };
+
+    template <typename Style>
+    using ResolvedStyleCache = QHash<QString, ResolvedStyleEntry<Style>>;
+
+    /**
+     * @brief 按名称解析继承链，优先使用缓存
+     */
+    template <typename Style, typename Info>
+    Style resolveStyle(const QString &name,
+                       const QHash<QString, Info> &styles,
+                       const QHash<QString, quint64> &generations,
+                       ResolvedStyleCache<Style> &cache) const;
+
+    /**
+     * @brief 沿继承链取各名称代数的最大值
+     */
+    template <typename Info>
+    static quint64 chainGeneration(const QString &name,
+                                   const QHash<QString, Info> &styles,
+                                   const QHash<QString, quint64> &generations);
+
+    /**
+     * @brief 递增样式名称的代数，使依赖它的缓存条目失效
+     */
+    void touchStyle(QHash<QString, quint64> &generations, const QString &name);
+
+    /**
+     * @brief 沿父样式关系反向收集样式及其后代
+     */
+    template <typename Info>
+    static QStringList collectDependents(const QString &name, const QHash<QString, Info> &styles);
     
     Document *m_document = nullptr;                             ///< 关联的文档
     QHash<QString, CharacterStyleInfo> m_characterStyles;      ///< 字符样式哈希表
     QHash<QString, ParagraphStyleInfo> m_paragraphStyles;      ///< 段落样式哈希表
+
+    QHash<QString, quint64> m_characterStyleGenerations;        ///< 字符样式代数，未出现的名称为0
+    QHash<QString, quint64> m_paragraphStyleGenerations;        ///< 段落样式代数，未出现的名称为0
+    quint64 m_generationCounter = 0;                            ///< 代数分配计数器
+    mutable ResolvedStyleCache<CharacterStyle> m_resolvedCharacterStyles;  ///< 字符样式解析缓存
+    mutable ResolvedStyleCache<ParagraphStyle> m_resolvedParagraphStyles;  ///< 段落样式解析缓存
+    mutable StyleCacheStats m_cacheStats;                       ///< 缓存统计
 };
 
 } // namespace QtWordEditor
@@ -0,0 +1,126 @@
+#ifndef STYLEPOOL_H
+#define STYLEPOOL_H
+
+#include <QMultiHash>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QAtomicPointer>
+#include "core/document/CharacterStyle.h"
+#include "core/document/ParagraphStyle.h"
+#include "core/Global.h"
+
+namespace QtWordEditor {
+
+/**
+ * @brief 样式驻留池，为相同的字符样式和段落样式分配共享的整数ID
+ *
+ * 完全相同的样式（属性值和属性设置标记都相同）只保存一份不可变的条目，
+ * 条目带有预先计算的哈希值。文本游程和段落只保存ID：
+ * 1. 样式比较退化为整数比较
+ * 2. 重复的格式在内存中只占一个条目
+ *
+ * 池在进程内共享，块在文档之间复制或移动时ID无需重新映射。
+ * ID 0 始终对应默认构造的样式。条目只增不减，ID在进程生命周期内稳定。
+ * 查询和驻留都是线程安全的：条目存放在按需翻倍增长的分块数组中，已发布的分块和条目不再移动或修改，
+ * 按ID取样式不加锁，后台排版线程可以直接读取；只有驻留新样式时加锁。
+ */
+class StylePool
+{
+public:
+    static constexpr int DefaultStyleId = 0;  ///< 默认样式的ID
+
+    /**
+     * @brief 获取共享的样式池实例
+     * @return 样式池指针
+     */
+    static StylePool *instance();
+
+    // ========== 字符样式 ==========
+
+    /**
+     * @brief 驻留字符样式
+     * @param style 字符样式
+     * @return 样式ID，相同样式返回相同ID
+     */
+    int internCharacterStyle(const CharacterStyle &style);
+
+    /**
+     * @brief 根据ID获取字符样式
+     * @param id 样式ID，无效ID返回默认样式
+     * @return 字符样式（隐式共享，不复制数据）
+     */
+    CharacterStyle characterStyle(int id) const;
+
+    /**
+     * @brief 获取已驻留的字符样式数量
+     */
+    int characterStyleCount() const;
+
+    // ========== 段落样式 ==========
+
+    /**
+     * @brief 驻留段落样式
+     * @param style 段落样式
+     * @return 样式ID，相同样式返回相同ID
+     */
+    int internParagraphStyle(const ParagraphStyle &style);
+
+    /**
+     * @brief 根据ID获取段落样式
+     * @param id 样式ID，无效ID返回默认样式
+     * @return 段落样式（隐式共享，不复制数据）
+     */
+    ParagraphStyle paragraphStyle(int id) const;
+
+    /**
+     * @brief 获取已驻留的段落样式数量
+     */
+    int paragraphStyleCount() const;
+
+private:
+    StylePool();
+    ~StylePool();
+    Q_DISABLE_COPY(StylePool)
+
+    template <typename Style>
+    struct Table
+    {
+        // 第k个分块有 FirstChunkSize << k 个条目，分块按需分配，容量随条目数翻倍增长，
+        // 已分配的分块不移动；24个分块覆盖全部非负int ID
+        static constexpr int FirstChunkBits = 8;
+        static constexpr int FirstChunkSize = 1 << FirstChunkBits;
+        static constexpr int ChunkCount = 32 - FirstChunkBits;
+
+        QAtomicPointer<Style> chunks[ChunkCount];   ///< 分块目录
+        QAtomicInt count;                           ///< 已发布的条目数（release写入，acquire读取）
+        QMultiHash<size_t, int> index;              ///< 预计算哈希到ID的索引（驻留锁保护）
+    };
+
+    /**
+     * @brief 计算ID所在的分块和分块内的位置
+     * @param id 样式ID（非负）
+     * @param offset 输出参数，分块内的位置
+     * @return 分块序号
+     */
+    static int chunkOf(int id, qsizetype *offset);
+
+    template <typename Style>
+    int intern(Table<Style> &table, const Style &style);
+
+    template <typename Style>
+    static const Style &entry(const Table<Style> &table, int id);
+
+    template <typename Style>
+    static void release(Table<Style> &table);
+
+    template <typename Style>
+    static bool identical(const Style &a, const Style &b);
+
+    QMutex m_internMutex;   ///< 串行化驻留；按ID读取不需要
+    Table<CharacterStyle> m_characterStyles;
+    Table<ParagraphStyle> m_paragraphStyles;
+};
+
+} // namespace QtWordEditor
+
+#endif // STYLEPOOL_H
@@ -0,0 +1,23 @@
+#ifndef STYLEROUNDING_H
+#define STYLEROUNDING_H
+
+#include <QtGlobal>
+
+namespace QtWordEditor {
+
+/**
+ * @brief 样式中长度类属性（缩进、间距、字间距）的比较键
+ *
+ * 按千分之一取整。CharacterStyle 和 ParagraphStyle 的 operator== 与 hash()
+ * 都使用它，保证相等的样式哈希值相同，StylePool 才能正确去重。
+ * @param value 属性值
+ * @return 取整后的整数键
+ */
+inline qint64 styleLengthKey(qreal value)
+{
+    return qRound64(value * 1000.0);
+}
+
+} // namespace QtWordEditor
+
+#endif // STYLEROUNDING_H
@@ -68,6 +68,33 @@ constexpr int RIBBON_BAR_HEIGHT = 140;
 // 页面与 RibbonBar 之间的间距
 constexpr int PAGE_TOP_SPACING = 20;
 
+// 场景中相邻页面的纵向间距
+constexpr qreal PAGE_SPACING = 30.0;
+// 虚拟化场景在视口上下额外创建图形项的范围（场景坐标）
+constexpr qreal SCENE_VIRTUALIZATION_MARGIN = PAGE_HEIGHT;
+// 虚拟化场景回收后留作复用的段落图形项上限
+constexpr int SCENE_ITEM_POOL_SIZE = 256;
+// 页面图块缓存的内存上限（字节）
+constexpr qint64 TILE_CACHE_BUDGET_BYTES = 64 * 1024 * 1024;
+// 场景更新调度器合并编辑更新的帧间隔（毫秒）
+constexpr int SCENE_UPDATE_FRAME_INTERVAL = 16;
+
+// ==========================================
+// 排版相关常量
+// ==========================================
+// 块数超过该值的文档在后台线程分页，界面不等待分页完成
+constexpr int BACKGROUND_LAYOUT_BLOCK_THRESHOLD = 500;
+// 后台分页第一批发布的页数（覆盖打开文档时的视口）
+constexpr int BACKGROUND_LAYOUT_PRIORITY_PAGES = 2;
+
+// ==========================================
+// 撤销相关常量
+// ==========================================
+// 撤销栈命令在内存中的预算（字节），超出部分写入临时溢出文件
+constexpr qint64 UNDO_MEMORY_BUDGET_BYTES = 32 * 1024 * 1024;
+// 命令日志的后台写入间隔（毫秒），期间的记录合并为一次写入
+constexpr int COMMAND_JOURNAL_FLUSH_INTERVAL_MS = 200;
+
 // ==========================================
 // 段落对齐方式常量
 // ==========================================
@@ -45,6 +45,9 @@ signals:
     void selectionFinished();
 
 private:
+    // 命中测试前处理尚未刷新的编辑，使图形项几何与文档一致
+    void flushPendingSceneUpdates();
+
     Document *m_document;
     Cursor *m_cursor;
     Selection *m_selection;
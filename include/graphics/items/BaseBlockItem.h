@@ -2,6 +2,8 @@
 #define BASEBLOCKITEM_H
 
 #include <QGraphicsRectItem>
+#include <QList>
+#include <QRectF>
 #include "core/Global.h"
 
 namespace QtWordEditor {
@@ -42,6 +44,50 @@ public:
      */
     virtual void updateBlock() = 0;
 
+    /**
+     * @brief 块的段前间距（场景排列块时使用）
+     * @return 默认返回0
+     */
+    virtual qreal spaceBefore() const;
+
+    /**
+     * @brief 块的段后间距（场景排列块时使用）
+     * @return 默认返回0
+     */
+    virtual qreal spaceAfter() const;
+
+    // ========== 光标和选择几何（图形项局部坐标） ==========
+
+    /**
+     * @brief 该图形项是否显示指定的字符偏移
+     * 跨页段落每页一个图形项，各自只显示本页的行
+     * @param offset 块内字符偏移
+     * @return 默认返回true
+     */
+    virtual bool containsOffset(int offset) const;
+
+    /**
+     * @brief 根据局部坐标查找最近的字符偏移
+     * @param pos 图形项局部坐标
+     * @return 块内字符偏移，默认返回0
+     */
+    virtual int hitTest(const QPointF &pos) const;
+
+    /**
+     * @brief 获取光标在指定偏移处的矩形（宽度为0，高度为行高）
+     * @param offset 块内字符偏移
+     * @return 局部坐标中的光标矩形，默认返回空矩形
+     */
+    virtual QRectF cursorRect(int offset) const;
+
+    /**
+     * @brief 获取字符范围 [start, end) 的选择矩形，每行一个
+     * @param start 起始偏移
+     * @param end 结束偏移
+     * @return 局部坐标中的矩形列表，默认为空
+     */
+    virtual QList<QRectF> selectionRects(int start, int end) const;
+
 protected:
     Block *m_block;  ///< 关联的数据块对象
 };
@@ -7,6 +7,7 @@
 namespace QtWordEditor {
 
 class Page;
+class PageTileCache;
 
 /**
  * @brief The PageItem class renders a page background and serves as a container
@@ -21,8 +22,18 @@ public:
     Page *page() const;
     void updatePage();
 
+    // Draw the page from cached raster tiles instead of the drop-shadow effect
+    // and the block items; pass nullptr to go back to normal painting.
+    void setTileCache(PageTileCache *cache, int pageIndex);
+
+    QRectF boundingRect() const override;
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
+               QWidget *widget = nullptr) override;
+
 private:
     Page *m_page;
+    PageTileCache *m_tileCache;
+    int m_pageIndex;
 };
 
 } // namespace QtWordEditor
@@ -0,0 +1,89 @@
+#ifndef PAINTEDTEXTBLOCKITEM_H
+#define PAINTEDTEXTBLOCKITEM_H
+
+#include "BaseBlockItem.h"
+#include "core/layout/ParagraphLayout.h"
+#include "core/Global.h"
+
+namespace QtWordEditor {
+
+class ParagraphBlock;
+class LayoutEngine;
+
+/**
+ * @brief 轻量的段落图形项，直接绘制排版引擎缓存的行框和字形
+ *
+ * 与 TextBlockItem 不同，该项不持有 QGraphicsTextItem 和 QTextDocument：
+ * 1. paint() 中按行绘制 ParagraphLayout 里预先整形好的字形，字体在界面线程取得
+ * 2. 光标位置、点击测试和选择矩形都取自同一份行表
+ * 3. 排版结果由 LayoutEngine 按段落缓存并共享，图形项本身只保存一个指针
+ *
+ * 跨页段落每页一个图形项，各自只显示 [startLine, endLine) 范围内的行。
+ */
+class PaintedTextBlockItem : public BaseBlockItem
+{
+public:
+    /**
+     * @brief 构造函数
+     * @param block 关联的段落块对象
+     * @param layoutEngine 提供段落排版结果的排版引擎
+     * @param startLine 显示的第一行
+     * @param endLine 显示的最后一行之后的行，-1 表示到段落末尾
+     * @param parent 父图形项指针，默认为nullptr
+     */
+    PaintedTextBlockItem(ParagraphBlock *block, LayoutEngine *layoutEngine,
+                         int startLine = 0, int endLine = -1, QGraphicsItem *parent = nullptr);
+
+    /**
+     * @brief 析构函数
+     */
+    ~PaintedTextBlockItem() override;
+
+    /**
+     * @brief 重新绑定到另一个段落片段（场景回收复用图形项时使用）
+     * @param block 段落块对象
+     * @param startLine 显示的第一行
+     * @param endLine 显示的最后一行之后的行，-1 表示到段落末尾
+     */
+    void setFragment(ParagraphBlock *block, int startLine, int endLine);
+
+    /**
+     * @brief 从排版引擎重新获取段落的排版结果
+     */
+    void updateBlock() override;
+
+    /**
+     * @brief 绘制显示范围内的行
+     */
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget = nullptr) override;
+
+    qreal spaceBefore() const override;
+    qreal spaceAfter() const override;
+    bool containsOffset(int offset) const override;
+    int hitTest(const QPointF &pos) const override;
+    QRectF cursorRect(int offset) const override;
+    QList<QRectF> selectionRects(int start, int end) const override;
+
+private:
+    /** @brief 显示范围的第一行 */
+    int firstLine() const;
+
+    /** @brief 显示范围最后一行之后的行 */
+    int lastLine() const;
+
+    /** @brief 第一行顶部在段落排版坐标中的 y，图形项的原点与它对齐 */
+    qreal originY() const;
+
+    /** @brief 根据显示的行更新矩形 */
+    void updateGeometry();
+
+    LayoutEngine *m_layoutEngine;   ///< 排版引擎
+    ParagraphLayoutPtr m_layout;    ///< 段落排版结果（与排版缓存共享）
+    int m_startLine;                ///< 显示的第一行
+    int m_endLine;                  ///< 显示的最后一行之后的行，-1 表示到段落末尾
+    GlyphFontCache m_fonts;         ///< 界面线程的字体缓存
+};
+
+} // namespace QtWordEditor
+
+#endif // PAINTEDTEXTBLOCKITEM_H
@@ -2,14 +2,18 @@
 #define SELECTIONITEM_H
 
 #include <QGraphicsItem>
-#include <QList>
+#include <QHash>
+#include <QPainterPath>
 #include <QRectF>
 #include "core/Global.h"
 
 namespace QtWordEditor {
 
 /**
- * @brief The SelectionItem class draws multiple rectangles representing text selections.
+ * @brief The SelectionItem class draws the text selection, one merged path per page.
+ *
+ * Pages are updated independently so that extending a selection only repaints
+ * the pages whose path actually changed.
  */
 class SelectionItem : public QGraphicsItem
 {
@@ -17,7 +21,8 @@ public:
     explicit SelectionItem(QGraphicsItem *parent = nullptr);
     ~SelectionItem() override;
 
-    void setRects(const QList<QRectF> &rects);
+    void setPagePath(int pageIndex, const QPainterPath &path);
+    void removePage(int pageIndex);
     void clear();
 
     QRectF boundingRect() const override;
@@ -25,9 +30,12 @@ public:
                QWidget *widget) override;
 
 private:
-    QList<QRectF> m_rects;
+    void updateBounds();
+
+    QHash<int, QPainterPath> m_paths;
+    QRectF m_bounds;
 };
 
 } // namespace QtWordEditor
 
-#endif // SELECTIONITEM_H
\ No newline at end of file
+#endif // SELECTIONITEM_H
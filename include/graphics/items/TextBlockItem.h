@@ -5,6 +5,10 @@
 #include <QGraphicsTextItem>
 #include <QFont>
 #include <QList>
+#include <QVector>
+#include <QString>
+#include <QTextCharFormat>
+#include <QTextLayout>
 #include "core/Global.h"
 #include "core/document/Span.h"
 
@@ -90,27 +94,83 @@ public:
      */
     QRectF boundingRect() const override;
     
+    /**
+     * @brief 只显示段落的一段行（段落跨页时，每页的图形项只显示本页的行）
+     * @param top 第一行的顶部，相对于段落第一行的顶部
+     * @param height 显示的行的总高度
+     */
+    void setTextClip(qreal top, qreal height);
+
     /**
      * @brief 更新几何形状
      * 重新计算和设置图形项的几何属性
      */
     void updateGeometry();
 
+    qreal spaceBefore() const override;
+    qreal spaceAfter() const override;
+    bool containsOffset(int offset) const override;
+    int hitTest(const QPointF &pos) const override;
+    QRectF cursorRect(int offset) const override;
+    QList<QRectF> selectionRects(int start, int end) const override;
+
 private:
+    /** @brief 段落唯一的文本块的布局 */
+    QTextLayout *textLayout() const;
+
+    /**
+     * @brief 缓存的行表项，坐标为图形项坐标（已含缩进和裁剪偏移）
+     */
+    struct CachedLine {
+        int start;      ///< 行首字符偏移
+        qreal y;        ///< 行顶
+        qreal height;   ///< 行高
+    };
+
+    /** @brief 获取行表，段落重新排版后第一次访问时重建 */
+    const QVector<CachedLine> &lineTable() const;
+
+    /** @brief 二分查找包含指定偏移的行，段落末尾的偏移属于最后一行；无行时返回 -1 */
+    int lineIndexForOffset(int offset) const;
+
+    /** @brief 行表失效（文本、格式、宽度或裁剪变化后调用） */
+    void invalidateLineTable();
+
     /** @brief 初始化内部文本图形项 */
     void initializeTextItem();
     
     /** @brief 更新边界矩形 */
     void updateBoundingRect();
     
-    /** @brief 从块数据应用富文本格式 */
+    /**
+     * @brief 上次渲染到文本文档中的一个样式游程
+     */
+    struct RenderedRun {
+        int length;
+        QTextCharFormat format;
+    };
+
+    /**
+     * @brief 从块数据应用富文本格式
+     * 直接用 QTextCursor 和 QTextCharFormat 填充文本文档，只重写与上次渲染相比变化的字符范围
+     */
     void applyRichTextFromBlock();
+
+    /** @brief 展开为每个字符所属游程的下标 */
+    static QVector<int> runIndexes(const QVector<RenderedRun> &runs);
     
     /** @brief 应用段落缩进（左缩进、右缩进） */
     void applyParagraphIndent();
     
     QGraphicsTextItem *m_textItem;  ///< 内部文本图形项
     qreal m_textWidth;              ///< 文本显示宽度
+    bool m_clipped;                 ///< 是否只显示部分行
+    qreal m_clipTop;                ///< 显示的第一行的顶部
+    qreal m_clipHeight;             ///< 显示的行的总高度
+    QString m_renderedText;                 ///< 文本文档中当前的文本
+    QVector<RenderedRun> m_renderedRuns;    ///< 文本文档中当前的样式游程
+    mutable QVector<CachedLine> m_lineTable;    ///< 行首偏移、行顶和行高，供光标和选区二分查找
+    mutable bool m_lineTableValid;              ///< 行表是否与当前排版一致
 };
 
 } // namespace QtWordEditor
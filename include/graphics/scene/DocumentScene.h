@@ -3,20 +3,30 @@
 
 #include <QGraphicsScene>
 #include <QHash>
+#include <QMultiHash>
 #include <QList>
+#include <QVector>
+#include <QSet>
+#include <QRectF>
 #include "core/Global.h"
+#include "graphics/scene/PageTileCache.h"
+#include "editcontrol/selection/Selection.h"
 
 namespace QtWordEditor {
 
 class Document;
 class Block;
 class Page;
+class ParagraphBlock;
+struct BlockFragment;
 class BaseBlockItem;
 class CursorItem;
 class SelectionItem;
 class PageItem;
-struct CursorPosition;
-struct SelectionRange;
+class TextBlockItem;
+class PaintedTextBlockItem;
+class LayoutEngine;
+class SceneUpdateScheduler;
 
 /**
  * @brief 文档场景类，管理文档的图形表示
@@ -54,6 +64,88 @@ public:
      */
     Document *document() const;
 
+    /**
+     * @brief 设置提供段落排版结果的排版引擎
+     * 设置后段落用 PaintedTextBlockItem 直接绘制排版引擎缓存的字形，
+     * 不再为每个段落创建 QTextDocument；未设置时使用 TextBlockItem
+     * @param engine 排版引擎指针
+     */
+    void setLayoutEngine(LayoutEngine *engine);
+
+    /**
+     * @brief 获取场景更新调度器
+     * 编辑产生的块、光标和选区更新通过它合并，每帧最多刷新一次
+     * @return 调度器指针（归场景所有）
+     */
+    SceneUpdateScheduler *updateScheduler() const;
+
+    // ========== 视口虚拟化 ==========
+
+    /**
+     * @brief 启用或关闭视口虚拟化
+     * 启用后只为与视口（加上下边距）相交的页面创建页面项和块图形项，
+     * 其余页面只保留几何信息；滚出范围的段落图形项回收到对象池中复用
+     * @param enabled true=只创建可见页面的图形项，false=为所有页面创建图形项
+     */
+    void setVirtualized(bool enabled);
+
+    /**
+     * @brief 是否启用了视口虚拟化
+     */
+    bool isVirtualized() const;
+
+    /**
+     * @brief 设置视口上下额外创建图形项的范围
+     * @param margin 边距（场景坐标）
+     */
+    void setVirtualizationMargin(qreal margin);
+
+    /**
+     * @brief 获取视口上下额外创建图形项的范围
+     */
+    qreal virtualizationMargin() const;
+
+    /**
+     * @brief 设置视图当前显示的场景区域，由视图在滚动、缩放和调整大小时调用
+     * @param rect 视口对应的场景矩形
+     */
+    void setViewportRect(const QRectF &rect);
+
+    /**
+     * @brief 获取当前已创建图形项的页面数
+     */
+    int realizedPageCount() const;
+
+    // ========== 页面图块缓存 ==========
+
+    /**
+     * @brief 启用或关闭页面图块缓存
+     * 启用后页面内容按缩放级别栅格化为图块缓存，滚动时直接贴图；
+     * 编辑只使块的脏矩形覆盖的图块失效。光标和选择区域不进入缓存。
+     * 只对 PaintedTextBlockItem 生效（需要先设置排版引擎）
+     * @param enabled true=启用
+     */
+    void setTileCacheEnabled(bool enabled);
+
+    /**
+     * @brief 是否启用了页面图块缓存
+     */
+    bool isTileCacheEnabled() const;
+
+    /**
+     * @brief 设置图块缓存占用内存的上限
+     * @param bytes 字节数
+     */
+    void setTileCacheBudget(qint64 bytes);
+
+    /**
+     * @brief 在后台预取一个场景区域的图块（视图按滚动方向和速度计算区域）
+     * 区域内的页面不需要已创建图形项
+     * @param sceneRect 场景坐标中的区域
+     * @param scale 缩放级别（设备像素/场景单位）
+     */
+    void prefetchTiles(const QRectF &sceneRect, qreal scale);
+
     // ========== 场景重建方法 ==========
     
     /**
@@ -62,6 +154,14 @@ public:
      */
     void rebuildFromDocument();
 
+    /**
+     * @brief 为新追加到文档末尾的页面创建图形项，不重建已有页面
+     * 用于后台分页分批发布页面；页面不在末尾时退化为 rebuildFromDocument()
+     * @param firstPage 第一个新页面在文档中的页序号（从0开始）
+     * @param count 新页面数
+     */
+    void appendPages(int firstPage, int count);
+
     /**
      * @brief 更新所有文本项的内容而不重建场景
      * 用于内容变化但布局未改变的情况
@@ -73,6 +173,22 @@ public:
      * @param block 要更新的块
      */
     void updateSingleTextItem(Block *block);
+
+    /**
+     * @brief 只更新指定的一组文本块
+     * 用于命名样式修改后，只重新渲染引用该样式的段落；按文档顺序合并为连续区间
+     * 交给 updateBlockRange()，只有包含这些块的页面的图块失效
+     * @param blocks 要更新的块列表
+     */
+    void updateTextItems(const QList<Block*> &blocks);
+    
+    /**
+     * @brief 更新一段连续的块（批量格式修改后），每个受影响的页面只重新排列一次
+     * 只访问包含这些块的页面：已创建图形项的页面更新图形项，其余页面使图块失效
+     * @param firstBlock 第一个块的全局索引
+     * @param lastBlock 最后一个块的全局索引
+     */
+    void updateBlockRange(int firstBlock, int lastBlock);
     
     /**
      * @brief 重新计算所有文本块的位置
@@ -98,10 +214,14 @@ public:
     // ========== 选择区域相关方法 ==========
     
     /**
-     * @brief 更新选择区域矩形
-     * @param rects 选择区域矩形列表
+     * @brief 设置要显示的选择范围
+     *
+     * 与上次的范围相比，只重新计算选区起点或终点移动经过的块（拖动选择时即新旧焦点之间的块），
+     * 其余块沿用缓存的矩形；每页的选择区域合并为一条路径。
+     * 只有已创建图形项的页面有选择区域，页面创建时补上。
+     * @param range 选择范围
      */
-    void updateSelection(const QList<QRectF> &rects);
+    void setSelectionRange(const SelectionRange &range);
     
     /**
      * @brief 清除选择区域
@@ -109,9 +229,9 @@ public:
     void clearSelection();
 
     /**
-     * @brief 根据选择范围计算选择区域矩形列表
+     * @brief 根据选择范围计算选择区域矩形列表（只包括已创建图形项的页面）
      * @param range 选择范围
-     * @return 选择区域矩形列表
+     * @return 选择区域矩形列表（场景坐标）
      */
     QList<QRectF> calculateSelectionRects(const SelectionRange &range) const;
 
@@ -123,7 +243,8 @@ public:
     void clearPages();
     
     /**
-     * @brief 添加页面
+     * @brief 在场景末尾添加页面
+     * 虚拟化时页面不在视口附近则只记录几何信息，滚动到附近时再创建图形项
      * @param page 要添加的页面对象
      */
     void addPage(Page *page);
@@ -149,9 +270,35 @@ public:
      * @param pos 光标位置结构体
      * @return 对应的场景坐标位置
      */
-    QPointF calculateCursorVisualPosition(const CursorPosition &pos) const;
+    QPointF calculateCursorVisualPosition(const CursorPosition &pos);
+
+    /**
+     * @brief 根据光标位置计算光标矩形（宽度为0，高度为所在行的行高）
+     *
+     * 由图形项按缓存的行表二分查找得到，段落重新排版前重复查询不会重新遍历行。
+     * @param pos 光标位置结构体
+     * @return 场景坐标中的光标矩形，位置无效时返回空矩形
+     */
+    QRectF calculateCursorRect(const CursorPosition &pos);
+
+signals:
+    /**
+     * @brief 虚拟化场景中创建或回收了页面的图形项
+     * 依赖图形项的显示需要重新计算（选择区域由场景自己在页面创建时补上）
+     */
+    void visiblePagesChanged();
 
 public slots:
+    /**
+     * @brief 增量分页替换了一段页面后，只替换这段页面的几何信息和图形项
+     * 被替换页面的图形项回收（页面对象已被删除，不再访问），新页面按视口创建；
+     * 后续页面只平移位置和页序号，图块缓存随之平移，不重新创建
+     * @param firstPage 第一个被替换的页序号
+     * @param removedCount 被移除的页面数
+     * @param addedCount 插入的页面数
+     */
+    void replacePages(int firstPage, int removedCount, int addedCount);
+
     /**
      * @brief 处理块添加事件
      * @param globalIndex 添加的块的全局索引
@@ -170,12 +317,179 @@ public slots:
     void onLayoutChanged();
 
 private:
+    /**
+     * @brief 为一个页面创建页面项和其中的块图形项，并排列块的位置
+     * @param pageIndex 页面在文档中的页序号
+     */
+    void realizePage(int pageIndex);
+
+    /**
+     * @brief 回收一个页面的页面项和块图形项，只保留页面的几何信息
+     * @param pageIndex 页面在文档中的页序号
+     */
+    void releasePage(int pageIndex);
+
+    /**
+     * @brief 按当前视口创建进入范围的页面、回收离开范围的页面
+     */
+    void updateRealizedPages();
+
+    /**
+     * @brief 确保显示块的所有页面都已创建图形项（光标移到视口外时使用）
+     * @param block 块
+     */
+    void ensureBlockRealized(Block *block);
+
+    /**
+     * @brief 回收块图形项：段落图形项放回对象池，其余删除
+     * @param item 图形项
+     */
+    void recycleItem(BaseBlockItem *item);
+
+    /**
+     * @brief 获取页面内容的只读快照，供工作线程栅格化图块
+     * 快照按页缓存，页面的图块失效时丢弃
+     * @param pageIndex 页序号
+     * @return 快照，页面不存在或没有排版引擎时为空
+     */
+    PageSnapshotPtr pageSnapshot(int pageIndex);
+
+    /**
+     * @brief 使块所在的、未创建图形项的页面的图块全部失效
+     * @param block 块
+     * @param aroundPage 块所在的一个已创建图形项的页面，-1 表示没有（需要遍历所有页面）
+     */
+    void invalidateUnrealizedBlockPages(Block *block, int aroundPage);
+
+    /**
+     * @brief 使页面中与场景矩形相交的图块失效并重绘
+     * @param pageIndex 页序号
+     * @param sceneRect 场景坐标中的脏矩形
+     */
+    void invalidateTiles(int pageIndex, const QRectF &sceneRect);
+
+    /**
+     * @brief 页面在场景中的矩形（页面纵向排列，之间相隔 PAGE_SPACING）
+     * @param pageIndex 页面在文档中的页序号
+     */
+    QRectF pageSceneRect(int pageIndex) const;
+
+    /**
+     * @brief 查找底部（含页间距）在 y 之下的第一个页面，在页面顶部前缀和上二分查找
+     * @param y 场景纵坐标
+     * @return 页序号，y 在所有页面之下时返回页面数
+     */
+    int pageIndexAtY(qreal y) const;
+
+    /**
+     * @brief 查找最后一个块不在 blockIndex 之前的第一个页面，按页面的块顺序二分查找
+     * @param blockIndex 块的全局索引
+     * @return 页序号，块在所有页面之后时返回页面数
+     */
+    int firstPageOfBlock(int blockIndex) const;
+
+    /**
+     * @brief 页面第一个块片段的全局块索引，空页面返回 -1
+     * @param pageIndex 页面在文档中的页序号
+     */
+    int firstBlockOfPage(int pageIndex) const;
+
+    /**
+     * @brief 需要创建图形项的场景区域（视口加上下边距）
+     */
+    QRectF realizeArea() const;
+
+    /**
+     * @brief 按页面中块片段的顺序排列该页的块图形项
+     * @param pageIndex 页面在文档中的页序号
+     * @param fromFragment 第一个需要重新排列的片段（其前面的块位置不变）
+     * @param stopWhenSettled 只有起始片段的高度变化时为true，遇到位置未变的后续块即停止
+     */
+    void positionPageItems(int pageIndex, int fromFragment = 0, bool stopWhenSettled = false);
+
+    /**
+     * @brief 从块数据刷新该块的所有图形项（包括跨页段落的后续片段）
+     * @param block 块
+     */
+    void updateBlockItems(Block *block);
+
+    /**
+     * @brief 为段落片段创建图形项
+     * @param block 段落块
+     * @param fragment 页面中的块片段
+     * @return 新建的图形项
+     */
+    BaseBlockItem *createParagraphItem(ParagraphBlock *block, const BlockFragment &fragment);
+
+    /**
+     * @brief 查找显示块内指定偏移的图形项（跨页段落可能有多个图形项）
+     * @param block 块
+     * @param offset 块内字符偏移
+     * @return 图形项，不存在时返回nullptr
+     */
+    BaseBlockItem *itemForOffset(Block *block, int offset) const;
+
+    /**
+     * @brief 获取块的所有图形项，按页面顺序排列
+     * @param block 块
+     * @return 图形项列表
+     */
+    QList<BaseBlockItem*> itemsForBlock(Block *block) const;
+
+    /**
+     * @brief 计算图形项在选择范围内的矩形
+     * @param item 块图形项
+     * @param range 归一化的选择范围
+     * @return 场景坐标中的矩形
+     */
+    QVector<QRectF> itemSelectionRects(BaseBlockItem *item, const SelectionRange &range) const;
+
+    /**
+     * @brief 重新计算页面上所有图形项的选择矩形并重建该页的选择路径
+     * @param pageIndex 页序号
+     */
+    void refreshPageSelection(int pageIndex);
+
+    /**
+     * @brief 用缓存的矩形重建页面的选择路径
+     * @param pageIndex 页序号
+     */
+    void rebuildPageSelectionPath(int pageIndex);
+
+    /**
+     * @brief 命中测试区间：页面上一个块图形项的纵向范围（场景坐标）
+     */
+    struct HitInterval
+    {
+        qreal top;
+        qreal bottom;
+        BaseBlockItem *item;
+    };
+
     Document *m_document;                                   ///< 关联的文档
-    QHash<Block*, BaseBlockItem*> m_blockItems;            ///< 块到图形项的映射
-    QList<PageItem*> m_pageItems;                          ///< 页面项列表
-    QVector<QVector<QGraphicsTextItem*>> m_pageTextItems;  ///< 存储每个页、块对应的 QGraphicsTextItem
+    QHash<Block*, BaseBlockItem*> m_blockItems;            ///< 块到图形项的映射（跨页段落为第一个片段）
+    QMultiHash<Block*, BaseBlockItem*> m_fragmentItems;    ///< 跨页段落后续片段的图形项
+    QVector<QVector<BaseBlockItem*>> m_pageBlockItems;     ///< 每页每个块片段对应的图形项（非段落块为空）
+    QVector<Page*> m_pages;                                ///< 场景中的所有页面（按页序号）
+    QVector<qreal> m_pageTops;                             ///< 每页顶部的场景纵坐标（前缀和，递增）
+    qreal m_pagesWidth;                                    ///< 最宽页面的宽度
+    QVector<QVector<HitInterval>> m_pageHitTables;         ///< 每页按纵向排序的块区间表
+    QList<PageItem*> m_pageItems;                          ///< 每页的页面项（未创建时为空）
+    QSet<int> m_realizedPages;                             ///< 已创建图形项的页序号
+    QVector<PaintedTextBlockItem*> m_itemPool;             ///< 回收待复用的段落图形项（不在场景中）
+    QRectF m_viewportRect;                                 ///< 视图当前显示的场景区域
+    bool m_virtualized;                                    ///< 是否只为视口附近的页面创建图形项
+    qreal m_virtualizationMargin;                          ///< 视口上下额外创建图形项的范围
+    LayoutEngine *m_layoutEngine;                          ///< 排版引擎（为空时使用 TextBlockItem）
+    QHash<BaseBlockItem*, int> m_itemPages;                ///< 块图形项所在的页序号
+    PageTileCache m_tileCache;                             ///< 页面图块缓存
+    QHash<int, PageSnapshotPtr> m_pageSnapshots;           ///< 每页的内容快照（按需生成）
+    bool m_tileCacheEnabled;                               ///< 是否用图块缓存绘制页面
     CursorItem *m_cursorItem;                              ///< 光标图形项
     SelectionItem *m_selectionItem;                        ///< 选择区域图形项
+    SceneUpdateScheduler *m_updateScheduler;               ///< 合并编辑更新的调度器
+    SelectionRange m_selectionRange;                       ///< 当前显示的选择范围（已归一化，为空表示无选区）
+    QHash<BaseBlockItem*, QVector<QRectF>> m_itemSelectionRects;  ///< 每个图形项的选择矩形（场景坐标）
 };
 
 } // namespace QtWordEditor
@@ -0,0 +1,239 @@
+#ifndef PAGETILECACHE_H
+#define PAGETILECACHE_H
+
+#include <QObject>
+#include <QCache>
+#include <QHash>
+#include <QSet>
+#include <QImage>
+#include <QColor>
+#include <QRectF>
+#include <QVector>
+#include <QSharedPointer>
+#include <QThreadPool>
+#include <QHashFunctions>
+#include <functional>
+#include "core/layout/ParagraphLayout.h"
+#include "core/Global.h"
+
+class QPainter;
+
+namespace QtWordEditor {
+
+/**
+ * @brief 页面图块的键：页序号、缩放级别和图块坐标
+ */
+struct PageTileKey
+{
+    int page = 0;       ///< 页序号
+    int scale = 0;      ///< 缩放级别（设备像素/场景单位 × 1000，取整）
+    int x = 0;          ///< 图块列
+    int y = 0;          ///< 图块行
+};
+
+inline bool operator==(const PageTileKey &a, const PageTileKey &b)
+{
+    return a.page == b.page && a.scale == b.scale && a.x == b.x && a.y == b.y;
+}
+
+inline size_t qHash(const PageTileKey &key, size_t seed = 0)
+{
+    return qHashMulti(seed, key.page, key.scale, key.x, key.y);
+}
+
+/**
+ * @brief 页面内容的只读快照，用于在工作线程栅格化图块
+ *
+ * 只保存页面背景和各段落片段的排版结果（不可变、共享）及其位置，
+ * 不引用文档和图形项，可以在任意线程读取。坐标均为页面项坐标。
+ * 排版结果中的字形只含字体描述和字形数据，栅格化线程用自己的
+ * GlyphFontCache 取得 QRawFont。
+ */
+struct PageSnapshot
+{
+    /**
+     * @brief 页面上的一个段落片段
+     */
+    struct Fragment
+    {
+        ParagraphLayoutPtr layout;  ///< 段落排版结果
+        int firstLine = 0;          ///< 显示的第一行
+        int lastLine = 0;           ///< 显示的最后一行之后的行
+        QRectF rect;                ///< 片段在页面中的矩形（顶部对齐第一行的顶部）
+    };
+
+    QRectF pageRect;                ///< 页面矩形
+    QColor background;              ///< 页面背景色
+    QVector<Fragment> fragments;    ///< 段落片段
+
+    /**
+     * @brief 栅格化一个图块
+     * @param source 图块在页面项坐标中的矩形
+     * @param scale 缩放级别（设备像素/场景单位）
+     * @param size 图块边长（设备像素）
+     * @param fonts 调用线程的字体缓存，为空时本次栅格化临时创建
+     * @return 图块图像
+     */
+    QImage render(const QRectF &source, qreal scale, int size, GlyphFontCache *fonts = nullptr) const;
+
+    /**
+     * @brief 绘制占位内容：页面背景和代替文字的灰色线条
+     * @param painter 绘制器（页面项坐标）
+     * @param rect 需要绘制的区域
+     */
+    void drawPlaceholder(QPainter *painter, const QRectF &rect) const;
+
+private:
+    /** @brief 片段坐标原点在页面项坐标中的位置（第一行顶部对齐 rect 顶部） */
+    static QPointF origin(const Fragment &fragment);
+};
+
+using PageSnapshotPtr = QSharedPointer<const PageSnapshot>;
+
+/**
+ * @brief 页面内容的栅格图块缓存
+ *
+ * 页面内容按缩放级别切成 TileSize × TileSize 设备像素的图块渲染到 QImage：
+ * 1. 图块按页序号、缩放级别和图块坐标缓存，滚动和重绘时直接贴图
+ * 2. 编辑只使与脏矩形相交的图块失效，其余图块保留
+ * 3. 缓存按字节预算做 LRU 淘汰
+ *
+ * 未命中的图块在工作线程中从页面快照栅格化，完成后在界面线程放入缓存并
+ * 发出 tileReady()；在此之前由 drawPlaceholder() 绘制占位内容。
+ * 光标和选择区域等覆盖层不进入缓存，由各自的图形项绘制在图块之上。
+ */
+class PageTileCache : public QObject
+{
+    Q_OBJECT
+public:
+    static constexpr int TileSize = 256;    ///< 图块边长（设备像素）
+
+    /**
+     * @brief 页面快照提供函数（在界面线程调用），页面不存在时返回空指针
+     */
+    using SnapshotProvider = std::function<PageSnapshotPtr(int pageIndex)>;
+
+    /**
+     * @brief 构造函数
+     * @param maxBytes 图块占用内存的上限（字节）
+     * @param parent 父对象指针
+     */
+    explicit PageTileCache(qint64 maxBytes, QObject *parent = nullptr);
+
+    /**
+     * @brief 析构函数，等待正在栅格化的图块完成
+     */
+    ~PageTileCache() override;
+
+    /**
+     * @brief 设置页面快照提供函数
+     */
+    void setSnapshotProvider(const SnapshotProvider &provider);
+
+    /**
+     * @brief 设置图块占用内存的上限，超出时淘汰最久未使用的图块
+     * @param maxBytes 字节数
+     */
+    void setMaxBytes(qint64 maxBytes);
+
+    /**
+     * @brief 获取图块占用内存的上限
+     */
+    qint64 maxBytes() const;
+
+    /**
+     * @brief 获取已缓存的图块，未命中时在后台请求栅格化
+     * @param pageIndex 页序号
+     * @param scale 缩放级别（设备像素/场景单位）
+     * @param x 图块列
+     * @param y 图块行
+     * @return 图块图像，尚未就绪时为空图像
+     */
+    QImage tile(int pageIndex, qreal scale, int x, int y);
+
+    /**
+     * @brief 预取页面中一个区域的图块（优先级低于可见图块）
+     * @param pageIndex 页序号
+     * @param rect 页面项坐标中的区域
+     * @param scale 缩放级别
+     */
+    void prefetch(int pageIndex, const QRectF &rect, qreal scale);
+
+    /**
+     * @brief 绘制图块尚未就绪时的占位内容
+     * @param painter 绘制器（页面项坐标）
+     * @param pageIndex 页序号
+     * @param rect 需要绘制的区域
+     */
+    void drawPlaceholder(QPainter *painter, int pageIndex, const QRectF &rect);
+
+    /**
+     * @brief 使页面中与矩形相交的图块失效（所有缩放级别）
+     * 该页正在栅格化的图块结果将被丢弃
+     * @param pageIndex 页序号
+     * @param rect 页面项坐标中的脏矩形
+     */
+    void invalidate(int pageIndex, const QRectF &rect);
+
+    /**
+     * @brief 页面区间被替换（增量分页）后调整页序号
+     * 被替换页面的图块丢弃，后续页面的图块移到新的页序号下保留；
+     * 从 firstPage 起正在栅格化的图块按旧页序号返回，结果将被丢弃
+     * @param firstPage 第一个被替换的页序号
+     * @param removedCount 被移除的页面数
+     * @param addedCount 插入的页面数
+     */
+    void replacePages(int firstPage, int removedCount, int addedCount);
+
+    /**
+     * @brief 清空缓存并丢弃所有正在栅格化的图块
+     */
+    void clear();
+
+    /**
+     * @brief 把缩放级别量化为缓存键使用的整数
+     */
+    static int scaleKey(qreal scale);
+
+    /**
+     * @brief 图块在页面项坐标中的矩形
+     * @param scaleKey 量化后的缩放级别
+     * @param x 图块列
+     * @param y 图块行
+     */
+    static QRectF tileRect(int scaleKey, int x, int y);
+
+signals:
+    /**
+     * @brief 图块栅格化完成（或结果因失效被丢弃），该区域需要重绘
+     * @param pageIndex 页序号
+     * @param rect 页面项坐标中的图块矩形
+     */
+    void tileReady(int pageIndex, const QRectF &rect);
+
+private:
+    /**
+     * @brief 在工作线程中栅格化图块
+     * @param key 图块键
+     * @param priority 线程池优先级（可见图块高于预取图块）
+     */
+    void requestTile(const PageTileKey &key, int priority);
+
+    /** @brief 工作线程的结果回到界面线程后放入缓存 */
+    void finishTile(const PageTileKey &key, quint64 generation, const QImage &image);
+
+    /** @brief 页面当前的代数，页面失效或缓存清空后变大 */
+    quint64 generation(int pageIndex) const;
+
+    SnapshotProvider m_snapshotProvider;
+    QCache<PageTileKey, QImage> m_tiles;    ///< 开销为图像字节数
+    QSet<PageTileKey> m_pending;            ///< 正在栅格化的图块
+    QHash<int, quint64> m_pageGenerations;  ///< 每页最近一次失效时的计数
+    quint64 m_epoch;                        ///< 最近一次清空缓存时的计数
+    quint64 m_counter;                      ///< 失效计数（单调递增）
+    QThreadPool m_threadPool;               ///< 栅格化线程
+};
+
+} // namespace QtWordEditor
+
+#endif // PAGETILECACHE_H
@@ -0,0 +1,102 @@
+#ifndef SCENEUPDATESCHEDULER_H
+#define SCENEUPDATESCHEDULER_H
+
+#include <QObject>
+#include <QSet>
+#include <QVector>
+#include <QPair>
+#include <QTimer>
+#include <QElapsedTimer>
+#include "core/Global.h"
+
+namespace QtWordEditor {
+
+class Block;
+class DocumentScene;
+class LayoutEngine;
+
+/**
+ * @brief 场景更新调度器，把一帧内的脏块、光标和选区更新合并为一次刷新
+ *
+ * 编辑时文本变化、光标移动和选区变化只做标记，距上次刷新不足一帧时等到帧边界，
+ * 否则在下一轮事件循环刷新：
+ * 1. 脏块和脏块范围合并为连续区间，每个区间在各节内重新排版一次，再更新其图形项
+ *    （同一块在一帧内多次修改只处理一次）
+ * 2. 之后依次请求更新选区和光标的显示
+ *
+ * 脏块按块ID记录（范围记录两端的块ID），刷新前被删除的块直接跳过。
+ * 需要同步读取场景几何的操作（如鼠标命中测试）应先调用 flush()。
+ */
+class SceneUpdateScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    /**
+     * @brief 构造函数
+     * @param scene 要更新的场景
+     */
+    explicit SceneUpdateScheduler(DocumentScene *scene);
+
+    /**
+     * @brief 设置排版引擎，脏块刷新时先从该块开始增量排版（为空时只更新图形项）
+     */
+    void setLayoutEngine(LayoutEngine *engine);
+
+    /**
+     * @brief 标记块的内容或格式已变化
+     * @param block 块
+     */
+    void markBlockDirty(Block *block);
+
+    /**
+     * @brief 标记一段连续的块已变化（批量修改结束时的 Document::blocksChanged()）
+     * 刷新时整段只排版一次、只重新排列一次受影响的页面
+     * @param firstIndex 第一个块的全局索引
+     * @param lastIndex 最后一个块的全局索引
+     */
+    void markBlockRangeDirty(int firstIndex, int lastIndex);
+
+    /**
+     * @brief 标记一组块已变化（如命名样式修改后引用它的段落），按文档顺序合并为连续范围
+     * @param blocks 块，可以无序或重复
+     */
+    void markBlocksDirty(const QList<Block*> &blocks);
+
+    /** @brief 标记光标位置需要重新显示 */
+    void markCursorDirty();
+
+    /** @brief 标记选区需要重新显示 */
+    void markSelectionDirty();
+
+    /** @brief 是否有尚未刷新的更新 */
+    bool hasPendingUpdates() const;
+
+    /**
+     * @brief 立即刷新所有待处理的更新
+     */
+    void flush();
+
+signals:
+    /** @brief 刷新时光标需要重新显示（在脏块排版之后发出） */
+    void cursorUpdateRequested();
+
+    /** @brief 刷新时选区需要重新显示（在脏块排版之后、光标之前发出） */
+    void selectionUpdateRequested();
+
+private:
+    /** @brief 启动刷新定时器，对齐到距上次刷新一帧之后 */
+    void scheduleFlush();
+
+    DocumentScene *m_scene;             ///< 要更新的场景
+    LayoutEngine *m_layoutEngine;       ///< 排版引擎
+    QSet<int> m_dirtyBlockIds;          ///< 待更新的块ID
+    QVector<QPair<int, int>> m_dirtyRanges;  ///< 待更新的块范围（两端的块ID）
+    bool m_cursorDirty;                 ///< 光标是否待更新
+    bool m_selectionDirty;              ///< 选区是否待更新
+    QTimer m_timer;                     ///< 刷新定时器（单次）
+    QElapsedTimer m_sinceFlush;         ///< 距上次刷新的时间
+};
+
+} // namespace QtWordEditor
+
+#endif // SCENEUPDATESCHEDULER_H
@@ -2,6 +2,7 @@
 #define DOCUMENTVIEW_H
 
 #include <QGraphicsView>
+#include <QElapsedTimer>
 #include "core/Global.h"
 
 namespace QtWordEditor {
@@ -173,10 +174,20 @@ protected:
     void contextMenuEvent(QContextMenuEvent *event) override;
 
 private:
+    /** @brief 把当前视口对应的场景区域告知文档场景（用于视口虚拟化） */
+    void updateSceneViewport();
+
+    /**
+     * @brief 按滚动方向和速度让文档场景预取即将进入视口的图块
+     */
+    void prefetchAhead();
+
     qreal m_zoom;              ///< 当前缩放比例
     QPoint m_lastMousePos;     ///< 上次鼠标位置
     Cursor *m_cursor;          ///< 光标控制器
     QPointF m_cursorVisualPos; ///< 光标视觉位置
+    QElapsedTimer m_scrollTimer; ///< 距上次滚动的时间
+    qreal m_scrollVelocity;    ///< 平滑后的纵向滚动速度（场景单位/秒，向下为正）
 };
 
 } // namespace QtWordEditor
@@ -21,8 +21,10 @@ class Selection;
 class EditEventHandler;
 class FormatController;
 class StyleManager;
+class LayoutEngine;
 class RibbonBar;
 class DebugConsole;
+class CommandJournal;
 
 /**
  * @brief 主窗口类，应用程序的主要界面
@@ -76,6 +78,18 @@ private slots:
      */
     void onStyleChanged();
 
+    /**
+     * @brief 字符样式被修改后，只重新排版引用该样式（或其后代样式）的段落
+     * @param styleName 被修改的样式名称
+     */
+    void onCharacterStyleChanged(const QString &styleName);
+
+    /**
+     * @brief 段落样式被修改后，只重新排版引用该样式（或其后代样式）的段落
+     * @param styleName 被修改的样式名称
+     */
+    void onParagraphStyleChanged(const QString &styleName);
+
     // ========== 文件操作槽函数 ==========
     
     /** @brief 创建新文档 */
@@ -176,6 +190,14 @@ private:
     
     /** @brief 检查是否需要保存 */
     bool maybeSave();
+
+    /**
+     * @brief 上次异常退出后询问用户，在基准文件上重放命令日志
+     * @param baseFile 日志的基准文件路径
+     * @param records 日志记录
+     */
+    void recoverUnsavedChanges(const QString &baseFile, const QByteArray &records);
+
     
     /** @brief 重新翻译界面文本 */
     void retranslateUi();
@@ -212,7 +234,9 @@ private:
     EditEventHandler *m_editEventHandler;   ///< 编辑事件处理器
     FormatController *m_formatController;   ///< 格式控制器
     StyleManager *m_styleManager;           ///< 样式管理器
+    LayoutEngine *m_layoutEngine;           ///< 排版引擎
     RibbonBar *m_ribbonBar;                 ///< 功能区工具栏
+    CommandJournal *m_journal;              ///< 崩溃恢复用的命令日志
 
     QString m_currentFile;                  ///< 当前文件路径
     bool m_isModified;                      ///< 文档是否被修改
@@ -0,0 +1,328 @@
+#include "core/commands/CommandJournal.h"
+#include "core/commands/EditCommand.h"
+#include "core/commands/InsertTextCommand.h"
+#include "core/commands/RemoveTextCommand.h"
+#include "core/commands/SetCharacterStyleCommand.h"
+#include "core/commands/SetCharacterStyleRangeCommand.h"
+#include "core/commands/SetParagraphStyleCommand.h"
+#include "core/commands/InsertBlockCommand.h"
+#include "core/commands/RemoveBlockCommand.h"
+#include "core/document/Document.h"
+#include "core/utils/Constants.h"
+#include <QUndoStack>
+#include <QThread>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QLockFile>
+#include <QDateTime>
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QMutexLocker>
+#include <QDebug>
+
+namespace QtWordEditor {
+
+namespace {
+
+constexpr quint32 JournalMagic = 0x514A524E;   // "QJRN"
+constexpr quint16 JournalVersion = 2;   // 2: 序号记录相对于 reset() 时的撤销栈序号
+constexpr QDataStream::Version StreamVersion = QDataStream::Qt_6_0;
+
+// 命令记录直接使用 EditCommand::JournalType 的取值，其余类型从高位开始分配
+constexpr quint8 IndexRecord = 0xF0;     // 撤销栈序号变化（撤销、重做）
+constexpr quint8 BarrierRecord = 0xF1;   // 不能由记录重建的命令
+
+} // namespace
+
+CommandJournal::CommandJournal(Document *document, const QString &filePath, QObject *parent)
+    : QObject(parent)
+    , m_document(document)
+    , m_filePath(filePath)
+    , m_lock(new QLockFile(lockFilePath(filePath)))
+{
+    // 只按持有进程是否存活判断失效，长时间运行的实例的锁不会被当作失效
+    m_lock->setStaleLockTime(0);
+    if (!m_lock->tryLock(0))
+        qWarning() << "CommandJournal: cannot lock journal file" << m_filePath << m_lock->error();
+
+    connect(m_document->undoStack(), &QUndoStack::indexChanged, this, &CommandJournal::onIndexChanged);
+
+    m_writer = QThread::create([this]() { writerLoop(); });
+    m_writer->start(QThread::LowPriority);
+}
+
+CommandJournal::~CommandJournal()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stop = true;
+        m_wakeUp.wakeAll();
+    }
+    m_writer->wait();
+    delete m_writer;
+}
+
+QString CommandJournal::filePath() const
+{
+    return m_filePath;
+}
+
+void CommandJournal::reset(const QString &baseFile)
+{
+    QByteArray header;
+    QDataStream out(&header, QIODevice::WriteOnly);
+    out.setVersion(StreamVersion);
+    out << JournalMagic << JournalVersion << baseFile;
+
+    m_broken = false;
+    // 保存后撤销栈保留，重放时从空栈开始，之后的序号都相对于此
+    m_baseIndex = m_document->undoStack()->index();
+    QMutexLocker locker(&m_mutex);
+    // 缓冲区里尚未写出的记录已包含在基准文件中，一并丢弃
+    m_pending = header;
+    m_truncate = true;
+    m_remove = false;
+    ++m_appendedSerial;
+    m_wakeUp.wakeAll();
+}
+
+void CommandJournal::push(EditCommand *command)
+{
+    if (!m_broken) {
+        const EditCommand::JournalType type = command->journalType();
+        if (type == EditCommand::NotJournaled) {
+            // 之后的记录都依赖这条命令的结果，重放只能到此为止
+            append(BarrierRecord, QByteArray());
+            m_broken = true;
+        } else {
+            QByteArray payload;
+            QDataStream out(&payload, QIODevice::WriteOnly);
+            out.setVersion(StreamVersion);
+            command->writeJournal(out);
+            append(quint8(type), payload);
+        }
+    }
+
+    // 压入引起的序号变化由命令记录本身表示，重放时同样压入
+    m_pushing = true;
+    m_document->undoStack()->push(command);
+    m_pushing = false;
+}
+
+void CommandJournal::onIndexChanged(int index)
+{
+    if (m_pushing || m_broken)
+        return;
+    if (index < m_baseIndex) {
+        // 撤销了基准文件中已保存的修改，无法在基准文件上重放
+        append(BarrierRecord, QByteArray());
+        m_broken = true;
+        return;
+    }
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out.setVersion(StreamVersion);
+    out << qint32(index - m_baseIndex);
+    append(IndexRecord, payload);
+}
+
+void CommandJournal::append(quint8 type, const QByteArray &payload)
+{
+    QByteArray record;
+    QDataStream out(&record, QIODevice::WriteOnly);
+    out.setVersion(StreamVersion);
+    out << type << payload;
+
+    QMutexLocker locker(&m_mutex);
+    const bool wasEmpty = m_pending.isEmpty();
+    m_pending += record;
+    ++m_appendedSerial;
+    // 缓冲区非空时写入线程已在等待写入间隔，不必再唤醒
+    if (wasEmpty)
+        m_wakeUp.wakeAll();
+}
+
+void CommandJournal::flush()
+{
+    QMutexLocker locker(&m_mutex);
+    const quint64 target = m_appendedSerial;
+    m_flushRequested = true;
+    m_wakeUp.wakeAll();
+    while (m_writtenSerial < target)
+        m_written.wait(&m_mutex);
+}
+
+void CommandJournal::discard()
+{
+    m_broken = true;
+    QMutexLocker locker(&m_mutex);
+    m_pending.clear();
+    m_truncate = false;
+    m_remove = true;
+    ++m_appendedSerial;
+    m_wakeUp.wakeAll();
+}
+
+void CommandJournal::writerLoop()
+{
+    QFile file(m_filePath);
+    QMutexLocker locker(&m_mutex);
+    for (;;) {
+        while (m_pending.isEmpty() && !m_truncate && !m_remove && !m_stop)
+            m_wakeUp.wait(&m_mutex);
+        // 等待一个写入间隔，把连续输入的记录合并为一次写入
+        if (!m_stop && !m_remove && !m_flushRequested)
+            m_wakeUp.wait(&m_mutex, Constants::COMMAND_JOURNAL_FLUSH_INTERVAL_MS);
+
+        QByteArray data;
+        data.swap(m_pending);
+        const bool truncate = m_truncate;
+        const bool remove = m_remove;
+        const bool stop = m_stop;
+        const quint64 serial = m_appendedSerial;
+        m_truncate = false;
+        m_remove = false;
+        m_flushRequested = false;
+        locker.unlock();
+
+        if (remove) {
+            file.close();
+            QFile::remove(m_filePath);
+        } else if (truncate || !data.isEmpty()) {
+            if (!file.isOpen() && !file.open(QIODevice::ReadWrite))
+                qWarning() << "CommandJournal: cannot open journal file" << m_filePath << file.errorString();
+            if (file.isOpen()) {
+                if (truncate)
+                    file.resize(0);
+                // 写入后交给操作系统，进程崩溃时记录不会丢失
+                if (!file.seek(file.size()) || file.write(data) != data.size() || !file.flush())
+                    qWarning() << "CommandJournal: failed to write journal file" << m_filePath << file.errorString();
+            }
+        }
+
+        locker.relock();
+        m_writtenSerial = serial;
+        m_written.wakeAll();
+        if (stop)
+            return;
+    }
+}
+
+bool CommandJournal::readJournal(const QString &filePath, QString *baseFile, QByteArray *records)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream in(&file);
+    in.setVersion(StreamVersion);
+    quint32 magic = 0;
+    quint16 version = 0;
+    QString base;
+    in >> magic >> version >> base;
+    if (in.status() != QDataStream::Ok || magic != JournalMagic || version != JournalVersion)
+        return false;
+
+    if (baseFile)
+        *baseFile = base;
+    if (records)
+        *records = file.readAll();
+    return true;
+}
+
+QString CommandJournal::sessionFilePath(const QString &directory)
+{
+    // 进程号可能被重用，加上启动时间避免与崩溃留下的日志同名
+    const QString name = QStringLiteral("session-%1-%2.journal")
+                             .arg(QCoreApplication::applicationPid())
+                             .arg(QDateTime::currentMSecsSinceEpoch());
+    return QDir(directory).filePath(name);
+}
+
+QStringList CommandJournal::staleJournals(const QString &directory)
+{
+    QStringList result;
+    const QFileInfoList files = QDir(directory).entryInfoList(QStringList(QStringLiteral("*.journal")),
+                                                              QDir::Files, QDir::Time);
+    for (const QFileInfo &file : files) {
+        // 能拿到锁说明没有正在运行的实例使用该日志；检查后立即释放
+        QLockFile lock(lockFilePath(file.absoluteFilePath()));
+        lock.setStaleLockTime(0);
+        if (lock.tryLock(0)) {
+            lock.unlock();
+            result.append(file.absoluteFilePath());
+        }
+    }
+    return result;
+}
+
+void CommandJournal::removeJournal(const QString &filePath)
+{
+    QFile::remove(filePath);
+    QFile::remove(lockFilePath(filePath));
+}
+
+QString CommandJournal::lockFilePath(const QString &filePath)
+{
+    return filePath + QStringLiteral(".lock");
+}
+
+int CommandJournal::replay(const QByteArray &records)
+{
+    QDataStream in(records);
+    in.setVersion(StreamVersion);
+    int applied = 0;
+    while (!in.atEnd()) {
+        quint8 type = 0;
+        QByteArray payload;
+        in >> type >> payload;
+        // 崩溃时可能只写出了最后一条记录的一部分
+        if (in.status() != QDataStream::Ok)
+            break;
+
+        QDataStream args(payload);
+        args.setVersion(StreamVersion);
+        if (type == IndexRecord) {
+            qint32 index = 0;
+            args >> index;
+            m_document->undoStack()->setIndex(m_baseIndex + index);
+        } else if (type == BarrierRecord) {
+            qWarning() << "CommandJournal::replay - stopped at a command that cannot be replayed";
+            break;
+        } else {
+            EditCommand *command = createCommand(m_document, type, args);
+            if (!command) {
+                qWarning() << "CommandJournal::replay - invalid record of type" << type;
+                break;
+            }
+            push(command);
+        }
+        ++applied;
+    }
+    return applied;
+}
+
+EditCommand *CommandJournal::createCommand(Document *document, int type, QDataStream &in)
+{
+    switch (type) {
+        case EditCommand::InsertTextJournal:
+            return InsertTextCommand::fromJournal(document, in);
+        case EditCommand::RemoveTextJournal:
+            return RemoveTextCommand::fromJournal(document, in);
+        case EditCommand::SetCharacterStyleJournal:
+            return SetCharacterStyleCommand::fromJournal(document, in);
+        case EditCommand::SetCharacterStyleRangeJournal:
+            return SetCharacterStyleRangeCommand::fromJournal(document, in);
+        case EditCommand::SetParagraphStyleJournal:
+            return SetParagraphStyleCommand::fromJournal(document, in);
+        case EditCommand::InsertBlockJournal:
+            return InsertBlockCommand::fromJournal(document, in);
+        case EditCommand::RemoveBlockJournal:
+            return RemoveBlockCommand::fromJournal(document, in);
+        default:
+            return nullptr;
+    }
+}
+
+} // namespace QtWordEditor
@@ -8,7 +8,11 @@
  */
 
 #include "core/commands/EditCommand.h"
+#include "core/commands/UndoMemoryManager.h"
 #include "core/document/Document.h"
+#include "core/document/ParagraphBlock.h"
+#include <QDataStream>
+#include <QDebug>
 
 namespace QtWordEditor {
 
@@ -25,9 +29,15 @@ EditCommand::EditCommand(Document *document, const QString &text)
 
 /**
  * @brief 销毁编辑命令对象
+ *
+ * 丢弃重做分支或清空撤销栈时，从管理器的累计值中扣除占用并释放溢出记录。
  */
 EditCommand::~EditCommand()
 {
+    if (m_costManager)
+        m_costManager->adjustResidentBytes(-m_countedCost);
+    if (m_spillManager && m_spillOffset >= 0)
+        m_spillManager->releaseRecord(m_spillOffset, m_spillSize);
 }
 
 /**
@@ -55,5 +65,176 @@ void EditCommand::redo()
 {
 }
 
-} // namespace QtWordEditor
+/**
+ * @brief 获取指定全局索引处块的稳定ID
+ * @param blockIndex 块的全局索引
+ * @return 块ID，索引无效时返回 -1
+ */
+int EditCommand::blockIdAt(int blockIndex) const
+{
+    Block *block = m_document ? m_document->block(blockIndex) : nullptr;
+    return block ? block->blockId() : -1;
+}
+
+/**
+ * @brief 通过文档的块ID哈希表查找段落
+ * @param blockId 块ID
+ * @return 段落块，块已不在文档中或不是段落时返回nullptr
+ */
+ParagraphBlock *EditCommand::paragraphById(int blockId) const
+{
+    if (!m_document || blockId < 0)
+        return nullptr;
+    return qobject_cast<ParagraphBlock*>(m_document->blockById(blockId));
+}
+
+/**
+ * @brief 估算命令占用的内存（字节）
+ * @return 默认只计命令对象本身，持有文本或样式的子类加上其数据
+ */
+qint64 EditCommand::memoryCost() const
+{
+    return sizeof(EditCommand);
+}
+
+/**
+ * @brief 命令的数据能否写入撤销溢出文件
+ * @return 默认不能；实现了 savePayload()/loadPayload() 的子类返回 true
+ */
+bool EditCommand::canSpill() const
+{
+    return false;
+}
+
+/**
+ * @brief 命令的数据当前是否在溢出文件中
+ */
+bool EditCommand::isSpilled() const
+{
+    return m_spilled;
+}
+
+/**
+ * @brief 把命令的数据写入溢出文件并释放内存
+ * @param manager 持有溢出文件的撤销内存管理器
+ * @return 释放了内存返回 true
+ *
+ * 之前写过且之后未修改的数据直接复用已有记录，不再重复写入。
+ */
+bool EditCommand::spill(UndoMemoryManager *manager)
+{
+    if (m_spilled || !manager || !canSpill())
+        return false;
+
+    if (m_spillOffset < 0 || m_spillManager != manager) {
+        if (m_spillManager && m_spillOffset >= 0)
+            m_spillManager->releaseRecord(m_spillOffset, m_spillSize);
+        m_spillOffset = -1;
+        QByteArray data;
+        QDataStream out(&data, QIODevice::WriteOnly);
+        savePayload(out);
+        const qint64 offset = manager->writeRecord(data, &m_spillSize);
+        if (offset < 0)
+            return false;
+        m_spillOffset = offset;
+        m_spillManager = manager;
+    }
+    releasePayload();
+    m_spilled = true;
+    updateMemoryCost(manager);
+    return true;
+}
+
+/**
+ * @brief 把上次报告以来 memoryCost() 的变化计入管理器的累计值
+ * @param manager 撤销内存管理器
+ */
+void EditCommand::updateMemoryCost(UndoMemoryManager *manager)
+{
+    if (m_costManager && m_costManager != manager) {
+        m_costManager->adjustResidentBytes(-m_countedCost);
+        m_countedCost = 0;
+    }
+    m_costManager = manager;
+    if (!manager)
+        return;
+    const qint64 cost = memoryCost();
+    manager->adjustResidentBytes(cost - m_countedCost);
+    m_countedCost = cost;
+}
 
+/**
+ * @brief 数据在溢出文件中时读回内存
+ * @return 数据已在内存中返回 true；读取失败时命令保持溢出状态并返回 false，
+ *         调用者不能在已释放的空数据上执行
+ */
+bool EditCommand::ensureLoaded()
+{
+    if (!m_spilled)
+        return true;
+    const QByteArray data = m_spillManager->readRecord(m_spillOffset, m_spillSize);
+    if (data.isEmpty()) {
+        qCritical() << "EditCommand::ensureLoaded - failed to reload spilled undo data for" << text()
+                    << "at offset" << m_spillOffset;
+        return false;
+    }
+    QDataStream in(data);
+    loadPayload(in);
+    m_spilled = false;
+    updateMemoryCost(m_costManager);
+    return true;
+}
+
+/**
+ * @brief 数据被修改后释放溢出记录，下次溢出时重新写入
+ */
+void EditCommand::payloadChanged()
+{
+    if (m_spillManager && m_spillOffset >= 0)
+        m_spillManager->releaseRecord(m_spillOffset, m_spillSize);
+    m_spillOffset = -1;
+}
+
+/**
+ * @brief 写出命令的数据（由支持溢出的子类重写）
+ */
+void EditCommand::savePayload(QDataStream &out) const
+{
+    Q_UNUSED(out);
+}
+
+/**
+ * @brief 读回 savePayload() 写出的数据（由支持溢出的子类重写）
+ */
+void EditCommand::loadPayload(QDataStream &in)
+{
+    Q_UNUSED(in);
+}
+
+/**
+ * @brief 释放已写入溢出文件的数据（由支持溢出的子类重写）
+ */
+void EditCommand::releasePayload()
+{
+}
+
+/**
+ * @brief 命令在命令日志中的记录类型
+ * @return 默认不写入日志；能由记录重建的子类返回各自的类型
+ */
+EditCommand::JournalType EditCommand::journalType() const
+{
+    return NotJournaled;
+}
+
+/**
+ * @brief 写出重建命令所需的参数（由写入日志的子类重写）
+ *
+ * 在命令第一次执行之前调用，写出的是构造参数而不是执行后保存的撤销数据。
+ */
+void EditCommand::writeJournal(QDataStream &out) const
+{
+    Q_UNUSED(out);
+}
+
+} // namespace QtWordEditor
@@ -10,6 +10,9 @@
 #include "core/commands/InsertBlockCommand.h"
 #include "core/document/Document.h"
 #include "core/document/Section.h"
+#include "core/document/ParagraphBlock.h"
+#include "core/styles/StylePool.h"
+#include <QDataStream>
 #include <QDebug>
 
 namespace QtWordEditor {
@@ -79,5 +82,86 @@ void InsertBlockCommand::undo()
     }
 }
 
-} // namespace QtWordEditor
+/**
+ * @brief 估算命令占用的内存
+ * @return 命令对象的字节数；块不在文档中时（由命令持有）加上块的文本
+ *
+ * 块对象本身不写入溢出文件，只计入撤销内存预算。
+ */
+qint64 InsertBlockCommand::memoryCost() const
+{
+    qint64 cost = sizeof(InsertBlockCommand);
+    if (m_block && document()->indexOfBlock(m_block) < 0)
+        cost += sizeof(Block) + qint64(m_block->length()) * sizeof(QChar);
+    return cost;
+}
+
+/**
+ * @brief 命令在命令日志中的记录类型
+ * @return 只有段落块可以写入日志，其他类型的块不写入
+ */
+EditCommand::JournalType InsertBlockCommand::journalType() const
+{
+    return qobject_cast<ParagraphBlock*>(m_block.data()) ? InsertBlockJournal : NotJournaled;
+}
 
+/**
+ * @brief 写出重建命令所需的参数：插入位置和段落内容
+ *
+ * 样式游程按样式内容写出（样式池ID只在进程内有效），读回时重新驻留。
+ */
+void InsertBlockCommand::writeJournal(QDataStream &out) const
+{
+    const ParagraphBlock *para = qobject_cast<ParagraphBlock*>(m_block.data());
+    if (!para)
+        return;
+    out << qint32(m_index) << para->text() << para->paragraphStyle() << para->paragraphStyleName();
+    const QVector<StyleRun> runs = para->runs(0, para->length());
+    out << qint32(runs.size());
+    for (const StyleRun &run : runs)
+        out << qint32(run.length) << run.styleName << StylePool::instance()->characterStyle(run.styleId);
+}
+
+/**
+ * @brief 由日志记录重建插入块命令
+ * @param document 目标文档
+ * @param in 定位在记录参数处的数据流
+ * @return 新命令（持有新建的段落块），记录无效时返回nullptr
+ */
+InsertBlockCommand *InsertBlockCommand::fromJournal(Document *document, QDataStream &in)
+{
+    qint32 index = 0;
+    QString text;
+    ParagraphStyle paragraphStyle;
+    QString paragraphStyleName;
+    qint32 runCount = 0;
+    in >> index >> text >> paragraphStyle >> paragraphStyleName >> runCount;
+    if (runCount < 0 || in.status() != QDataStream::Ok)
+        return nullptr;
+
+    QVector<StyleRun> runs;
+    runs.reserve(runCount);
+    int length = 0;
+    for (qint32 i = 0; i < runCount && in.status() == QDataStream::Ok; ++i) {
+        qint32 runLength = 0;
+        StyleRun run;
+        CharacterStyle style;
+        in >> runLength >> run.styleName >> style;
+        run.length = runLength;
+        run.styleId = StylePool::instance()->internCharacterStyle(style);
+        length += run.length;
+        runs.append(run);
+    }
+    if (in.status() != QDataStream::Ok)
+        return nullptr;
+
+    ParagraphBlock *para = new ParagraphBlock();
+    para->setText(text);
+    para->setParagraphStyle(paragraphStyle);
+    para->setParagraphStyleName(paragraphStyleName);
+    if (!runs.isEmpty() && length == para->length())
+        para->replaceRuns(0, length, runs);
+    return new InsertBlockCommand(document, index, para);
+}
+
+} // namespace QtWordEditor
@@ -10,6 +10,7 @@
 #include "core/commands/InsertTextCommand.h"
 #include "core/document/Document.h"
 #include "core/document/ParagraphBlock.h"
+#include <QDataStream>
 #include <QDebug>
 
 namespace QtWordEditor {
@@ -26,6 +27,7 @@ InsertTextCommand::InsertTextCommand(Document *document, int blockIndex, int pos
                                      const QString &text, const CharacterStyle &style)
     : EditCommand(document, QString())
     , m_blockIndex(blockIndex)
+    , m_blockId(blockIdAt(blockIndex))
     , m_position(position)
     , m_text(text)
     , m_style(style)
@@ -47,14 +49,11 @@ InsertTextCommand::~InsertTextCommand()
  */
 void InsertTextCommand::redo()
 {
-    Block *block = document()->block(m_blockIndex);
-    if (!block) {
-        qWarning() << "Block not found at index" << m_blockIndex;
+    if (!ensureLoaded())
         return;
-    }
-    ParagraphBlock *para = qobject_cast<ParagraphBlock*>(block);
+    ParagraphBlock *para = paragraphById(m_blockId);
     if (!para) {
-        qWarning() << "Block is not a paragraph block";
+        qWarning() << "Paragraph block not found, index" << m_blockIndex << "id" << m_blockId;
         return;
     }
     para->insert(m_position, m_text, m_style);
@@ -67,15 +66,23 @@ void InsertTextCommand::redo()
  */
 void InsertTextCommand::undo()
 {
-    Block *block = document()->block(m_blockIndex);
-    if (!block)
+    if (!ensureLoaded())
         return;
-    ParagraphBlock *para = qobject_cast<ParagraphBlock*>(block);
+    ParagraphBlock *para = paragraphById(m_blockId);
     if (!para)
         return;
     para->remove(m_position, m_text.length());
 }
 
+/**
+ * @brief 合并标识
+ * @return 所有插入文本命令共用的标识，QUndoStack 据此调用 mergeWith()
+ */
+int InsertTextCommand::id() const
+{
+    return InsertTextMergeId;
+}
+
 /**
  * @brief 尝试与另一个命令合并
  * @param other 要合并的命令
@@ -89,14 +96,91 @@ bool InsertTextCommand::mergeWith(const QUndoCommand *other)
     const InsertTextCommand *cmd = dynamic_cast<const InsertTextCommand*>(other);
     if (!cmd)
         return false;
-    if (m_blockIndex == cmd->m_blockIndex &&
+    if (!ensureLoaded())
+        return false;
+    if (m_blockId == cmd->m_blockId &&
         m_position + m_text.length() == cmd->m_position &&
         m_style == cmd->m_style) {
         m_text += cmd->m_text;
+        payloadChanged();
         return true;
     }
     return false;
 }
 
-} // namespace QtWordEditor
+/**
+ * @brief 估算命令占用的内存
+ * @return 命令对象加上插入文本的字节数
+ */
+qint64 InsertTextCommand::memoryCost() const
+{
+    return sizeof(InsertTextCommand) + qint64(m_text.capacity()) * sizeof(QChar);
+}
+
+/**
+ * @brief 插入的文本可以写入撤销溢出文件
+ */
+bool InsertTextCommand::canSpill() const
+{
+    return true;
+}
+
+/**
+ * @brief 写出插入的文本
+ */
+void InsertTextCommand::savePayload(QDataStream &out) const
+{
+    out << m_text;
+}
+
+/**
+ * @brief 读回插入的文本
+ */
+void InsertTextCommand::loadPayload(QDataStream &in)
+{
+    in >> m_text;
+}
+
+/**
+ * @brief 释放插入的文本
+ */
+void InsertTextCommand::releasePayload()
+{
+    m_text = QString();
+}
+
+/**
+ * @brief 命令在命令日志中的记录类型
+ */
+EditCommand::JournalType InsertTextCommand::journalType() const
+{
+    return InsertTextJournal;
+}
+
+/**
+ * @brief 写出重建命令所需的参数：块索引、位置、文本和字符样式
+ */
+void InsertTextCommand::writeJournal(QDataStream &out) const
+{
+    out << qint32(m_blockIndex) << qint32(m_position) << m_text << m_style;
+}
 
+/**
+ * @brief 由日志记录重建插入文本命令
+ * @param document 目标文档
+ * @param in 定位在记录参数处的数据流
+ * @return 新命令，记录无效时返回nullptr
+ */
+InsertTextCommand *InsertTextCommand::fromJournal(Document *document, QDataStream &in)
+{
+    qint32 blockIndex = 0;
+    qint32 position = 0;
+    QString text;
+    CharacterStyle style;
+    in >> blockIndex >> position >> text >> style;
+    if (in.status() != QDataStream::Ok)
+        return nullptr;
+    return new InsertTextCommand(document, blockIndex, position, text, style);
+}
+
+} // namespace QtWordEditor
@@ -10,6 +10,7 @@
 #include "core/commands/RemoveBlockCommand.h"
 #include "core/document/Document.h"
 #include "core/document/Section.h"
+#include <QDataStream>
 #include <QDebug>
 
 namespace QtWordEditor {
@@ -69,5 +70,49 @@ void RemoveBlockCommand::undo()
     m_removedBlock = nullptr;
 }
 
-} // namespace QtWordEditor
+/**
+ * @brief 估算命令占用的内存
+ * @return 命令对象的字节数；块不在文档中时（由命令持有）加上块的文本
+ *
+ * 块对象本身不写入溢出文件，只计入撤销内存预算。
+ */
+qint64 RemoveBlockCommand::memoryCost() const
+{
+    qint64 cost = sizeof(RemoveBlockCommand);
+    if (m_removedBlock && document()->indexOfBlock(m_removedBlock) < 0)
+        cost += sizeof(Block) + qint64(m_removedBlock->length()) * sizeof(QChar);
+    return cost;
+}
+
+/**
+ * @brief 命令在命令日志中的记录类型
+ */
+EditCommand::JournalType RemoveBlockCommand::journalType() const
+{
+    return RemoveBlockJournal;
+}
 
+/**
+ * @brief 写出重建命令所需的参数：块索引
+ */
+void RemoveBlockCommand::writeJournal(QDataStream &out) const
+{
+    out << qint32(m_index);
+}
+
+/**
+ * @brief 由日志记录重建移除块命令
+ * @param document 目标文档
+ * @param in 定位在记录参数处的数据流
+ * @return 新命令，记录无效时返回nullptr
+ */
+RemoveBlockCommand *RemoveBlockCommand::fromJournal(Document *document, QDataStream &in)
+{
+    qint32 index = 0;
+    in >> index;
+    if (in.status() != QDataStream::Ok)
+        return nullptr;
+    return new RemoveBlockCommand(document, index);
+}
+
+} // namespace QtWordEditor
@@ -10,6 +10,7 @@
 #include "core/commands/RemoveTextCommand.h"
 #include "core/document/Document.h"
 #include "core/document/ParagraphBlock.h"
+#include <QDataStream>
 #include <QDebug>
 
 namespace QtWordEditor {
@@ -24,6 +25,7 @@ namespace QtWordEditor {
 RemoveTextCommand::RemoveTextCommand(Document *document, int blockIndex, int position, int length)
     : EditCommand(document, QString())
     , m_blockIndex(blockIndex)
+    , m_blockId(blockIdAt(blockIndex))
     , m_position(position)
     , m_length(length)
 {
@@ -44,38 +46,163 @@ RemoveTextCommand::~RemoveTextCommand()
  */
 void RemoveTextCommand::redo()
 {
-    Block *block = document()->block(m_blockIndex);
-    if (!block) {
-        qWarning() << "Block not found at index" << m_blockIndex;
+    if (!ensureLoaded())
         return;
-    }
-    ParagraphBlock *para = qobject_cast<ParagraphBlock*>(block);
+    ParagraphBlock *para = paragraphById(m_blockId);
     if (!para) {
-        qWarning() << "Block is not a paragraph block";
+        qWarning() << "Paragraph block not found, index" << m_blockIndex << "id" << m_blockId;
         return;
     }
     m_removedText = para->text().mid(m_position, m_length);
+    m_removedRuns = para->runs(m_position, m_length);
     para->remove(m_position, m_length);
 }
 
 /**
  * @brief 撤销移除文本操作
  *
- * 将之前移除的文本重新插入到段落块的原位置
+ * 将之前移除的文本重新插入到段落块的原位置，并恢复其原有的样式游程。
+ * 插入和恢复游程在同一批次内完成，只产生一次块变化通知。
  */
 void RemoveTextCommand::undo()
 {
-    Block *block = document()->block(m_blockIndex);
-    if (!block)
+    if (!ensureLoaded())
         return;
-    ParagraphBlock *para = qobject_cast<ParagraphBlock*>(block);
-    if (!para)
+    ParagraphBlock *para = paragraphById(m_blockId);
+    if (!para || m_removedText.isEmpty())
         return;
-    for (const auto& span : m_removedSpans) {
-        para->insert(m_position, span.text(), span.style());
-        m_position += span.text().length();
+
+    Document *doc = document();
+    doc->beginBlockChanges();
+    para->insert(m_position, m_removedText, CharacterStyle());
+    if (!m_removedRuns.isEmpty())
+        para->replaceRuns(m_position, m_removedText.length(), m_removedRuns);
+    doc->endBlockChanges();
+}
+
+/**
+ * @brief 合并标识
+ * @return 所有删除文本命令共用的标识，QUndoStack 据此调用 mergeWith()
+ */
+int RemoveTextCommand::id() const
+{
+    return RemoveTextMergeId;
+}
+
+/**
+ * @brief 尝试与另一个删除命令合并
+ * @param other 要合并的命令（已执行）
+ * @return 如果合并成功返回true，否则返回false
+ *
+ * 同一段落中：
+ * 1. 退格删除的是本命令范围之前紧邻的文本，合并后起点前移
+ * 2. 向前删除的是本命令起点处的文本（删除后原位置的后续文本），追加到末尾
+ * 合并后撤销一次恢复整段文本和样式游程。
+ */
+bool RemoveTextCommand::mergeWith(const QUndoCommand *other)
+{
+    const RemoveTextCommand *cmd = dynamic_cast<const RemoveTextCommand*>(other);
+    if (!cmd || cmd->m_blockId != m_blockId || cmd->m_removedText.isEmpty())
+        return false;
+    if (!ensureLoaded())
+        return false;
+    if (m_removedText.isEmpty())
+        return false;
+
+    const int removed = cmd->m_removedText.length();
+    if (cmd->m_position + removed == m_position) {
+        // 退格：被删除的文本在前
+        m_position = cmd->m_position;
+        m_removedText.prepend(cmd->m_removedText);
+        m_removedRuns = cmd->m_removedRuns + m_removedRuns;
+    } else if (cmd->m_position == m_position) {
+        // 向前删除：被删除的文本在后
+        m_removedText.append(cmd->m_removedText);
+        m_removedRuns += cmd->m_removedRuns;
+    } else {
+        return false;
     }
+    m_length = m_removedText.length();
+    payloadChanged();
+    return true;
 }
 
-} // namespace QtWordEditor
+/**
+ * @brief 估算命令占用的内存
+ * @return 命令对象加上被删除文本和样式游程的字节数
+ */
+qint64 RemoveTextCommand::memoryCost() const
+{
+    qint64 cost = sizeof(RemoveTextCommand) + qint64(m_removedText.capacity()) * sizeof(QChar);
+    for (const StyleRun &run : m_removedRuns)
+        cost += sizeof(StyleRun) + qint64(run.styleName.size()) * sizeof(QChar);
+    return cost;
+}
+
+/**
+ * @brief 被删除的文本和样式游程可以写入撤销溢出文件
+ */
+bool RemoveTextCommand::canSpill() const
+{
+    return true;
+}
 
+/**
+ * @brief 写出被删除的文本和样式游程
+ */
+void RemoveTextCommand::savePayload(QDataStream &out) const
+{
+    out << m_removedText << m_removedRuns;
+}
+
+/**
+ * @brief 读回被删除的文本和样式游程
+ */
+void RemoveTextCommand::loadPayload(QDataStream &in)
+{
+    in >> m_removedText >> m_removedRuns;
+}
+
+/**
+ * @brief 释放被删除的文本和样式游程
+ */
+void RemoveTextCommand::releasePayload()
+{
+    m_removedText = QString();
+    m_removedRuns = QVector<StyleRun>();
+}
+
+/**
+ * @brief 命令在命令日志中的记录类型
+ */
+EditCommand::JournalType RemoveTextCommand::journalType() const
+{
+    return RemoveTextJournal;
+}
+
+/**
+ * @brief 写出重建命令所需的参数：块索引、起始位置和长度
+ */
+void RemoveTextCommand::writeJournal(QDataStream &out) const
+{
+    out << qint32(m_blockIndex) << qint32(m_position) << qint32(m_length);
+}
+
+/**
+ * @brief 由日志记录重建删除文本命令
+ * @param document 目标文档
+ * @param in 定位在记录参数处的数据流
+ * @return 新命令，记录无效时返回nullptr
+ */
+RemoveTextCommand *RemoveTextCommand::fromJournal(Document *document, QDataStream &in)
+{
+    qint32 blockIndex = 0;
+    qint32 position = 0;
+    qint32 length = 0;
+    in >> blockIndex >> position >> length;
+    if (in.status() != QDataStream::Ok)
+        return nullptr;
+    return new RemoveTextCommand(document, blockIndex, position, length);
+}
+
+} // namespace QtWordEditor
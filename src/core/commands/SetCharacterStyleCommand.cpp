@@ -1,7 +1,9 @@
 #include "core/commands/SetCharacterStyleCommand.h"
 #include "core/document/Document.h"
 #include "core/document/ParagraphBlock.h"
+#include <QDataStream>
 #include <QDebug>
+#include <utility>
 
 namespace QtWordEditor {
 
@@ -10,6 +12,7 @@ SetCharacterStyleCommand::SetCharacterStyleCommand(Document *document, int block
                                                    const CharacterStyle &style)
     : EditCommand(document, QString())
     , m_blockIndex(blockIndex)
+    , m_blockId(blockIdAt(blockIndex))
     , m_start(start)
     , m_end(end)
     , m_newStyle(style)
@@ -17,47 +20,123 @@ SetCharacterStyleCommand::SetCharacterStyleCommand(Document *document, int block
     setText(QObject::tr("Change character style"));
 }
 
+SetCharacterStyleCommand::SetCharacterStyleCommand(Document *document, int blockIndex,
+                                                   int start, int end,
+                                                   const QString &styleName)
+    : EditCommand(document, QString())
+    , m_blockIndex(blockIndex)
+    , m_blockId(blockIdAt(blockIndex))
+    , m_start(start)
+    , m_end(end)
+    , m_newStyleName(styleName)
+    , m_isNamedStyle(true)
+{
+    setText(QObject::tr("Apply character style"));
+}
+
 SetCharacterStyleCommand::~SetCharacterStyleCommand()
 {
 }
 
 void SetCharacterStyleCommand::redo()
 {
-    Block *block = document()->block(m_blockIndex);
-    if (!block) {
-        qWarning() << "Block not found at index" << m_blockIndex;
+    if (!ensureLoaded())
         return;
-    }
-    ParagraphBlock *para = qobject_cast<ParagraphBlock*>(block);
+    ParagraphBlock *para = paragraphById(m_blockId);
     if (!para) {
-        qWarning() << "Block is not a paragraph block";
+        qWarning() << "Paragraph block not found, index" << m_blockIndex << "id" << m_blockId;
         return;
     }
 
-    // Save old spans for undo
-    m_oldSpans.clear();
-    for (int i = 0; i < para->spanCount(); ++i) {
-        m_oldSpans.append(para->span(i));
-    }
+    // Save only the runs of the formatted range for undo
+    m_oldStart = qBound(0, m_start, para->length());
+    m_oldRuns = para->runs(m_start, m_end - m_start);
 
-    // 使用 ParagraphBlock 的 setStyle 方法正确地应用样式到指定范围
-    para->setStyle(m_start, m_end - m_start, m_newStyle);
+    if (m_isNamedStyle) {
+        para->setStyleName(m_start, m_end - m_start, m_newStyleName);
+    } else {
+        // 使用 ParagraphBlock 的 setStyle 方法正确地应用样式到指定范围
+        para->setStyle(m_start, m_end - m_start, m_newStyle);
+    }
 }
 
 void SetCharacterStyleCommand::undo()
 {
-    Block *block = document()->block(m_blockIndex);
-    if (!block)
+    if (!ensureLoaded())
         return;
-    ParagraphBlock *para = qobject_cast<ParagraphBlock*>(block);
+    ParagraphBlock *para = paragraphById(m_blockId);
     if (!para)
         return;
 
-    // Restore old spans
-    para->setText(""); // clear
-    for (const Span &span : m_oldSpans) {
-        para->addSpan(span);
+    // Restore the saved runs in one replacement (one textChanged)
+    int length = 0;
+    for (const StyleRun &run : std::as_const(m_oldRuns)) {
+        length += run.length;
+    }
+    para->replaceRuns(m_oldStart, length, m_oldRuns);
+}
+
+qint64 SetCharacterStyleCommand::memoryCost() const
+{
+    qint64 cost = sizeof(SetCharacterStyleCommand);
+    for (const StyleRun &run : m_oldRuns)
+        cost += sizeof(StyleRun) + qint64(run.styleName.size()) * sizeof(QChar);
+    return cost;
+}
+
+bool SetCharacterStyleCommand::canSpill() const
+{
+    return true;
+}
+
+void SetCharacterStyleCommand::savePayload(QDataStream &out) const
+{
+    out << m_oldRuns;
+}
+
+void SetCharacterStyleCommand::loadPayload(QDataStream &in)
+{
+    in >> m_oldRuns;
+}
+
+void SetCharacterStyleCommand::releasePayload()
+{
+    m_oldRuns = QVector<StyleRun>();
+}
+
+EditCommand::JournalType SetCharacterStyleCommand::journalType() const
+{
+    return SetCharacterStyleJournal;
+}
+
+void SetCharacterStyleCommand::writeJournal(QDataStream &out) const
+{
+    out << qint32(m_blockIndex) << qint32(m_start) << qint32(m_end) << m_isNamedStyle;
+    if (m_isNamedStyle)
+        out << m_newStyleName;
+    else
+        out << m_newStyle;
+}
+
+SetCharacterStyleCommand *SetCharacterStyleCommand::fromJournal(Document *document, QDataStream &in)
+{
+    qint32 blockIndex = 0;
+    qint32 start = 0;
+    qint32 end = 0;
+    bool isNamedStyle = false;
+    in >> blockIndex >> start >> end >> isNamedStyle;
+    if (isNamedStyle) {
+        QString styleName;
+        in >> styleName;
+        if (in.status() != QDataStream::Ok)
+            return nullptr;
+        return new SetCharacterStyleCommand(document, blockIndex, start, end, styleName);
     }
+    CharacterStyle style;
+    in >> style;
+    if (in.status() != QDataStream::Ok)
+        return nullptr;
+    return new SetCharacterStyleCommand(document, blockIndex, start, end, style);
 }
 
-} // namespace QtWordEditor
\ No newline at end of file
+} // namespace QtWordEditor
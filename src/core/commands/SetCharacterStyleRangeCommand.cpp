@@ -0,0 +1,178 @@
+#include "core/commands/SetCharacterStyleRangeCommand.h"
+#include "core/document/Document.h"
+#include "core/document/ParagraphBlock.h"
+#include <QDataStream>
+#include <QDebug>
+#include <utility>
+
+namespace QtWordEditor {
+
+SetCharacterStyleRangeCommand::SetCharacterStyleRangeCommand(Document *document,
+                                                             int startBlock, int startOffset,
+                                                             int endBlock, int endOffset,
+                                                             const CharacterStyle &style)
+    : EditCommand(document, QString())
+    , m_startBlock(startBlock)
+    , m_startOffset(startOffset)
+    , m_endBlock(endBlock)
+    , m_endOffset(endOffset)
+    , m_newStyle(style)
+{
+    setText(QObject::tr("Change character style"));
+}
+
+SetCharacterStyleRangeCommand::SetCharacterStyleRangeCommand(Document *document,
+                                                             int startBlock, int startOffset,
+                                                             int endBlock, int endOffset,
+                                                             const QString &styleName)
+    : EditCommand(document, QString())
+    , m_startBlock(startBlock)
+    , m_startOffset(startOffset)
+    , m_endBlock(endBlock)
+    , m_endOffset(endOffset)
+    , m_newStyleName(styleName)
+    , m_isNamedStyle(true)
+{
+    setText(QObject::tr("Apply character style"));
+}
+
+SetCharacterStyleRangeCommand::~SetCharacterStyleRangeCommand()
+{
+}
+
+void SetCharacterStyleRangeCommand::redo()
+{
+    if (!ensureLoaded())
+        return;
+    Document *doc = document();
+    if (!doc)
+        return;
+
+    m_oldRuns.clear();
+    const int lastBlock = qMin(m_endBlock, doc->blockCount() - 1);
+
+    // One batch: paragraphs report their changes once, through Document::blocksChanged()
+    doc->beginBlockChanges();
+    for (int blockIndex = qMax(0, m_startBlock); blockIndex <= lastBlock; ++blockIndex) {
+        ParagraphBlock *para = qobject_cast<ParagraphBlock*>(doc->block(blockIndex));
+        if (!para)
+            continue;
+
+        const int start = qBound(0, (blockIndex == m_startBlock) ? m_startOffset : 0, para->length());
+        const int end = qBound(0, (blockIndex == m_endBlock) ? m_endOffset : para->length(), para->length());
+        if (start >= end)
+            continue;
+
+        // Save only the runs of the formatted range for undo
+        m_oldRuns.append(SavedRuns{para->blockId(), start, end - start, para->runs(start, end - start)});
+
+        if (m_isNamedStyle)
+            para->setStyleName(start, end - start, m_newStyleName);
+        else
+            para->setStyle(start, end - start, m_newStyle);
+    }
+    doc->endBlockChanges();
+}
+
+void SetCharacterStyleRangeCommand::undo()
+{
+    if (!ensureLoaded())
+        return;
+    Document *doc = document();
+    if (!doc)
+        return;
+
+    doc->beginBlockChanges();
+    for (const SavedRuns &saved : std::as_const(m_oldRuns)) {
+        ParagraphBlock *para = paragraphById(saved.blockId);
+        if (!para) {
+            qWarning() << "SetCharacterStyleRangeCommand::undo - paragraph" << saved.blockId << "not found";
+            continue;
+        }
+        para->replaceRuns(saved.start, saved.length, saved.runs);
+    }
+    doc->endBlockChanges();
+}
+
+qint64 SetCharacterStyleRangeCommand::memoryCost() const
+{
+    qint64 cost = sizeof(SetCharacterStyleRangeCommand);
+    for (const SavedRuns &saved : m_oldRuns) {
+        cost += sizeof(SavedRuns);
+        for (const StyleRun &run : saved.runs)
+            cost += sizeof(StyleRun) + qint64(run.styleName.size()) * sizeof(QChar);
+    }
+    return cost;
+}
+
+bool SetCharacterStyleRangeCommand::canSpill() const
+{
+    return true;
+}
+
+void SetCharacterStyleRangeCommand::savePayload(QDataStream &out) const
+{
+    out << qint32(m_oldRuns.size());
+    for (const SavedRuns &saved : m_oldRuns)
+        out << qint32(saved.blockId) << qint32(saved.start) << qint32(saved.length) << saved.runs;
+}
+
+void SetCharacterStyleRangeCommand::loadPayload(QDataStream &in)
+{
+    qint32 count = 0;
+    in >> count;
+    m_oldRuns.clear();
+    m_oldRuns.reserve(count);
+    for (qint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        qint32 blockId = 0;
+        qint32 start = 0;
+        qint32 length = 0;
+        QVector<StyleRun> runs;
+        in >> blockId >> start >> length >> runs;
+        m_oldRuns.append(SavedRuns{blockId, start, length, runs});
+    }
+}
+
+void SetCharacterStyleRangeCommand::releasePayload()
+{
+    m_oldRuns = QVector<SavedRuns>();
+}
+
+EditCommand::JournalType SetCharacterStyleRangeCommand::journalType() const
+{
+    return SetCharacterStyleRangeJournal;
+}
+
+void SetCharacterStyleRangeCommand::writeJournal(QDataStream &out) const
+{
+    out << qint32(m_startBlock) << qint32(m_startOffset) << qint32(m_endBlock) << qint32(m_endOffset)
+        << m_isNamedStyle;
+    if (m_isNamedStyle)
+        out << m_newStyleName;
+    else
+        out << m_newStyle;
+}
+
+SetCharacterStyleRangeCommand *SetCharacterStyleRangeCommand::fromJournal(Document *document, QDataStream &in)
+{
+    qint32 startBlock = 0;
+    qint32 startOffset = 0;
+    qint32 endBlock = 0;
+    qint32 endOffset = 0;
+    bool isNamedStyle = false;
+    in >> startBlock >> startOffset >> endBlock >> endOffset >> isNamedStyle;
+    if (isNamedStyle) {
+        QString styleName;
+        in >> styleName;
+        if (in.status() != QDataStream::Ok)
+            return nullptr;
+        return new SetCharacterStyleRangeCommand(document, startBlock, startOffset, endBlock, endOffset, styleName);
+    }
+    CharacterStyle style;
+    in >> style;
+    if (in.status() != QDataStream::Ok)
+        return nullptr;
+    return new SetCharacterStyleRangeCommand(document, startBlock, startOffset, endBlock, endOffset, style);
+}
+
+} // namespace QtWordEditor
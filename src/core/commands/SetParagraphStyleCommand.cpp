@@ -3,6 +3,7 @@
 #include "core/document/Section.h"
 #include "core/document/Block.h"
 #include "core/document/ParagraphBlock.h"
+#include <QDataStream>
 
 namespace QtWordEditor {
 
@@ -13,13 +14,32 @@ SetParagraphStyleCommand::SetParagraphStyleCommand(Document *document,
     , m_blockIndices(blockIndices)
     , m_newStyle(newStyle)
 {
-    // Store old styles for undo
-    for (int index : blockIndices) {
-        Block *block = document->block(index);
-        if (auto *paragraphBlock = dynamic_cast<ParagraphBlock*>(block)) {
+    saveOldStyles();
+}
+
+SetParagraphStyleCommand::SetParagraphStyleCommand(Document *document,
+                                                 const QList<int> &blockIndices,
+                                                 const QString &styleName)
+    : EditCommand(document, "Apply Paragraph Style")
+    , m_blockIndices(blockIndices)
+    , m_newStyleName(styleName)
+    , m_isNamedStyle(true)
+{
+    saveOldStyles();
+}
+
+void SetParagraphStyleCommand::saveOldStyles()
+{
+    // Resolve the blocks to stable IDs and store old styles for undo
+    for (int index : m_blockIndices) {
+        Block *block = document()->block(index);
+        m_blockIds.append(block ? block->blockId() : -1);
+        if (auto *paragraphBlock = qobject_cast<ParagraphBlock*>(block)) {
             m_oldStyles.append(paragraphBlock->paragraphStyle());
+            m_oldStyleNames.append(paragraphBlock->paragraphStyleName());
         } else {
             m_oldStyles.append(ParagraphStyle()); // Default style
+            m_oldStyleNames.append(QString());
         }
     }
 }
@@ -30,26 +50,82 @@ SetParagraphStyleCommand::~SetParagraphStyleCommand()
 
 void SetParagraphStyleCommand::redo()
 {
-    Document *doc = document();
-    for (int i = 0; i < m_blockIndices.size(); ++i) {
-        int index = m_blockIndices.at(i);
-        Block *block = doc->block(index);
-        if (auto *paragraphBlock = dynamic_cast<ParagraphBlock*>(block)) {
-            paragraphBlock->setParagraphStyle(m_newStyle);
+    for (int i = 0; i < m_blockIds.size(); ++i) {
+        if (ParagraphBlock *paragraphBlock = paragraphById(m_blockIds.at(i))) {
+            if (m_isNamedStyle) {
+                paragraphBlock->setParagraphStyle(ParagraphStyle());
+                paragraphBlock->setParagraphStyleName(m_newStyleName);
+            } else {
+                paragraphBlock->setParagraphStyle(m_newStyle);
+            }
         }
     }
 }
 
 void SetParagraphStyleCommand::undo()
 {
-    Document *doc = document();
-    for (int i = 0; i < m_blockIndices.size(); ++i) {
-        int index = m_blockIndices.at(i);
-        Block *block = doc->block(index);
-        if (auto *paragraphBlock = dynamic_cast<ParagraphBlock*>(block)) {
+    for (int i = 0; i < m_blockIds.size(); ++i) {
+        if (ParagraphBlock *paragraphBlock = paragraphById(m_blockIds.at(i))) {
             paragraphBlock->setParagraphStyle(m_oldStyles.at(i));
+            paragraphBlock->setParagraphStyleName(m_oldStyleNames.at(i));
         }
     }
 }
 
-} // namespace QtWordEditor
\ No newline at end of file
+qint64 SetParagraphStyleCommand::memoryCost() const
+{
+    qint64 cost = sizeof(SetParagraphStyleCommand)
+                  + qint64(m_blockIndices.size() + m_blockIds.size()) * sizeof(int)
+                  + qint64(m_oldStyles.size()) * sizeof(ParagraphStyle);
+    for (const QString &name : m_oldStyleNames)
+        cost += sizeof(QString) + qint64(name.size()) * sizeof(QChar);
+    return cost;
+}
+
+EditCommand::JournalType SetParagraphStyleCommand::journalType() const
+{
+    return SetParagraphStyleJournal;
+}
+
+void SetParagraphStyleCommand::writeJournal(QDataStream &out) const
+{
+    out << qint32(m_blockIndices.size());
+    for (int index : m_blockIndices)
+        out << qint32(index);
+    out << m_isNamedStyle;
+    if (m_isNamedStyle)
+        out << m_newStyleName;
+    else
+        out << m_newStyle;
+}
+
+SetParagraphStyleCommand *SetParagraphStyleCommand::fromJournal(Document *document, QDataStream &in)
+{
+    qint32 count = 0;
+    in >> count;
+    if (count < 0 || in.status() != QDataStream::Ok)
+        return nullptr;
+    QList<int> blockIndices;
+    blockIndices.reserve(count);
+    for (qint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        qint32 index = 0;
+        in >> index;
+        blockIndices.append(index);
+    }
+    bool isNamedStyle = false;
+    in >> isNamedStyle;
+    if (isNamedStyle) {
+        QString styleName;
+        in >> styleName;
+        if (in.status() != QDataStream::Ok)
+            return nullptr;
+        return new SetParagraphStyleCommand(document, blockIndices, styleName);
+    }
+    ParagraphStyle style;
+    in >> style;
+    if (in.status() != QDataStream::Ok)
+        return nullptr;
+    return new SetParagraphStyleCommand(document, blockIndices, style);
+}
+
+} // namespace QtWordEditor
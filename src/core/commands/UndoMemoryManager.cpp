@@ -0,0 +1,180 @@
+#include "core/commands/UndoMemoryManager.h"
+#include "core/commands/EditCommand.h"
+#include <QUndoStack>
+#include <QDir>
+#include <QDebug>
+
+namespace QtWordEditor {
+
+UndoMemoryManager::UndoMemoryManager(QUndoStack *stack, qint64 budget, QObject *parent)
+    : QObject(parent)
+    , m_stack(stack)
+    , m_budget(budget)
+    , m_spillFile(QDir::tempPath() + QStringLiteral("/qtwordeditor-undo-XXXXXX"))
+{
+    // 命令入栈、合并或撤销后都会改变当前序号
+    connect(m_stack, &QUndoStack::indexChanged, this, &UndoMemoryManager::onIndexChanged);
+}
+
+UndoMemoryManager::~UndoMemoryManager()
+{
+}
+
+void UndoMemoryManager::setBudget(qint64 bytes)
+{
+    m_budget = qMax<qint64>(0, bytes);
+    enforceBudget();
+}
+
+qint64 UndoMemoryManager::budget() const
+{
+    return m_budget;
+}
+
+qint64 UndoMemoryManager::residentBytes() const
+{
+    return m_residentBytes;
+}
+
+void UndoMemoryManager::adjustResidentBytes(qint64 delta)
+{
+    m_residentBytes += delta;
+}
+
+qint64 UndoMemoryManager::spillFileSize() const
+{
+    return m_spillFile.isOpen() ? m_spillFile.size() : 0;
+}
+
+template <typename Visitor>
+void UndoMemoryManager::forEachCommand(int first, int end, Visitor visit) const
+{
+    for (int index = qMax(0, first); index < qMin(end, m_stack->count()); ++index) {
+        // 撤销栈只提供常量访问，溢出只释放命令的缓存数据，不改变它的撤销语义
+        QUndoCommand *command = const_cast<QUndoCommand*>(m_stack->command(index));
+        if (EditCommand *edit = dynamic_cast<EditCommand*>(command)) {
+            if (!visit(edit, index))
+                return;
+            continue;
+        }
+        for (int i = 0; i < command->childCount(); ++i) {
+            EditCommand *child = dynamic_cast<EditCommand*>(const_cast<QUndoCommand*>(command->child(i)));
+            if (child && !visit(child, index))
+                return;
+        }
+    }
+}
+
+void UndoMemoryManager::onIndexChanged(int index)
+{
+    // 两次序号之间的命令执行过撤销或重做；入栈或合并的命令是新的栈顶。
+    // 丢弃的重做分支和清空的命令在析构时已从累计值中扣除
+    const int first = qMin(m_lastIndex, index - 1);
+    const int end = qMax(m_lastIndex, index);
+    forEachCommand(first, end, [this](EditCommand *command, int topIndex) {
+        command->updateMemoryCost(this);
+        // 执行时可能读回了溢出的数据
+        m_spillFrom = qMin(m_spillFrom, topIndex);
+        return true;
+    });
+    m_lastIndex = index;
+    enforceBudget();
+}
+
+void UndoMemoryManager::enforceBudget()
+{
+    // 撤销栈清空后所有记录都已无用
+    if (m_stack->count() == 0) {
+        if (m_spillFile.isOpen())
+            m_spillFile.resize(0);
+        m_freeRecords.clear();
+        m_spillFrom = 0;
+        return;
+    }
+
+    if (m_residentBytes <= m_budget)
+        return;
+
+    // 从最早未溢出的命令开始溢出；栈顶命令可能还会与新命令合并，保留在内存中
+    const int spillableEnd = m_stack->index() - 1;
+    const int first = qMin(m_spillFrom, qMax(0, spillableEnd));
+    int stoppedAt = first;
+    forEachCommand(first, spillableEnd, [&](EditCommand *command, int index) {
+        stoppedAt = index;
+        if (!command->isSpilled() && command->canSpill())
+            command->spill(this);
+        return m_residentBytes > m_budget;
+    });
+    m_spillFrom = stoppedAt;
+}
+
+qint64 UndoMemoryManager::writeRecord(const QByteArray &data, int *size)
+{
+    if (!m_spillFile.isOpen() && !m_spillFile.open()) {
+        qWarning() << "UndoMemoryManager: cannot open undo spill file" << m_spillFile.fileTemplate();
+        return -1;
+    }
+    const QByteArray compressed = qCompress(data);
+
+    // 首个足够大的已释放空间，没有时追加到文件末尾
+    qint64 offset = m_spillFile.size();
+    for (auto it = m_freeRecords.begin(); it != m_freeRecords.end(); ++it) {
+        if (it.value() >= compressed.size()) {
+            offset = it.key();
+            const qint64 rest = it.value() - compressed.size();
+            m_freeRecords.erase(it);
+            if (rest > 0)
+                m_freeRecords.insert(offset + compressed.size(), rest);
+            break;
+        }
+    }
+
+    if (!m_spillFile.seek(offset) || m_spillFile.write(compressed) != compressed.size()) {
+        qWarning() << "UndoMemoryManager: failed to write undo spill file" << m_spillFile.fileName();
+        releaseRecord(offset, compressed.size());
+        return -1;
+    }
+    if (size)
+        *size = compressed.size();
+    return offset;
+}
+
+QByteArray UndoMemoryManager::readRecord(qint64 offset, int size)
+{
+    if (!m_spillFile.isOpen() || offset < 0 || !m_spillFile.seek(offset))
+        return QByteArray();
+    const QByteArray compressed = m_spillFile.read(size);
+    if (compressed.size() != size)
+        return QByteArray();
+    return qUncompress(compressed);
+}
+
+void UndoMemoryManager::releaseRecord(qint64 offset, int size)
+{
+    if (!m_spillFile.isOpen() || offset < 0 || size <= 0)
+        return;
+
+    // 与前后相邻的已释放空间合并
+    qint64 end = offset + size;
+    auto next = m_freeRecords.find(end);
+    if (next != m_freeRecords.end()) {
+        end += next.value();
+        m_freeRecords.erase(next);
+    }
+    auto it = m_freeRecords.lowerBound(offset);
+    if (it != m_freeRecords.begin()) {
+        --it;
+        if (it.key() + it.value() == offset) {
+            offset = it.key();
+            m_freeRecords.erase(it);
+        }
+    }
+
+    // 位于文件末尾的空间直接截掉
+    if (end >= m_spillFile.size())
+        m_spillFile.resize(offset);
+    else
+        m_freeRecords.insert(offset, end - offset);
+}
+
+} // namespace QtWordEditor
@@ -8,6 +8,7 @@
  */
 
 #include "core/document/Block.h"
+#include "core/document/Document.h"
 #include <QDebug>
 
 namespace QtWordEditor {
@@ -92,23 +93,45 @@ void Block::setHeight(qreal height)
 
 /**
  * @brief 获取块在文档中的全局位置
- * @return 全局块索引
+ * @return 全局块索引，块不在文档中时返回 -1
+ *
+ * 插入、删除块后全局位置会整体移动，因此每次由文档的分块索引计算而不保存在块中。
  */
 int Block::positionInDocument() const
 {
-    return m_positionInDocument;
+    Document *doc = document();
+    return doc ? doc->indexOfBlock(this) : -1;
+}
+
+/**
+ * @brief 获取块在所属节中的索引
+ * @return 节内块索引，不在节中时返回 -1
+ */
+int Block::indexInSection() const
+{
+    return m_indexInSection;
 }
 
 /**
- * @brief 设置块在文档中的全局位置
- * @param pos 新的全局块索引
+ * @brief 设置块在所属节中的索引
+ * @param index 新的节内块索引
  */
-void Block::setPositionInDocument(int pos)
+void Block::setIndexInSection(int index)
 {
-    if (m_positionInDocument != pos) {
-        m_positionInDocument = pos;
+    m_indexInSection = index;
+}
+
+/**
+ * @brief 获取块所属的文档
+ * @return 文档指针，块尚未加入文档时返回nullptr
+ */
+Document *Block::document() const
+{
+    for (QObject *object = parent(); object; object = object->parent()) {
+        if (Document *doc = qobject_cast<Document*>(object))
+            return doc;
     }
+    return nullptr;
 }
 
 } // namespace QtWordEditor
-
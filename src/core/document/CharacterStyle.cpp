@@ -1,5 +1,8 @@
 #include "core/document/CharacterStyle.h"
 #include "core/utils/Constants.h"
+#include "core/styles/StyleRounding.h"
+#include <QHash>
+#include <QDataStream>
 #include <QDebug>
 
 namespace QtWordEditor {
@@ -196,7 +199,7 @@ bool CharacterStyle::operator==(const CharacterStyle &other) const
     return d->m_font == other.d->m_font &&
            d->m_textColor == other.d->m_textColor &&
            d->m_backgroundColor == other.d->m_backgroundColor &&
-           qFuzzyCompare(d->m_letterSpacing, other.d->m_letterSpacing);
+           styleLengthKey(d->m_letterSpacing) == styleLengthKey(other.d->m_letterSpacing);
 }
 
 bool CharacterStyle::operator!=(const CharacterStyle &other) const
@@ -214,6 +217,11 @@ bool CharacterStyle::isPropertySet(CharacterStyleProperty property) const
     return d->m_propertySetFlags.testFlag(property);
 }
 
+CharacterStylePropertyFlags CharacterStyle::propertyFlags() const
+{
+    return d->m_propertySetFlags;
+}
+
 void CharacterStyle::clearProperty(CharacterStyleProperty property)
 {
     // 清除属性标记
@@ -292,4 +300,32 @@ CharacterStyle CharacterStyle::mergeWith(const CharacterStyle &other) const
     return result;
 }
 
-} // namespace QtWordEditor
\ No newline at end of file
+size_t CharacterStyle::hash(size_t seed) const
+{
+    return qHashMulti(seed,
+                      d->m_font,
+                      d->m_textColor.rgba(),
+                      d->m_backgroundColor.rgba(),
+                      styleLengthKey(d->m_letterSpacing),
+                      d->m_propertySetFlags.toInt());
+}
+
+QDataStream &operator<<(QDataStream &out, const CharacterStyle &style)
+{
+    const CharacterStyleData *data = style.d.constData();
+    return out << data->m_font << data->m_textColor << data->m_backgroundColor
+               << double(data->m_letterSpacing) << qint32(data->m_propertySetFlags.toInt());
+}
+
+QDataStream &operator>>(QDataStream &in, CharacterStyle &style)
+{
+    CharacterStyleData *data = style.d.data();
+    double letterSpacing = 0.0;
+    qint32 flags = 0;
+    in >> data->m_font >> data->m_textColor >> data->m_backgroundColor >> letterSpacing >> flags;
+    data->m_letterSpacing = letterSpacing;
+    data->m_propertySetFlags = CharacterStylePropertyFlags(QFlag(flags));
+    return in;
+}
+
+} // namespace QtWordEditor
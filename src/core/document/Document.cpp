@@ -10,8 +10,15 @@
 #include "core/document/Document.h"
 #include "core/document/Section.h"
 #include "core/document/Block.h"
+#include "core/document/ParagraphBlock.h"
+#include "core/commands/UndoMemoryManager.h"
+#include "core/commands/CommandJournal.h"
+#include "core/commands/EditCommand.h"
+#include "core/utils/Constants.h"
 #include <QUndoStack>
 #include <QDebug>
+#include <utility>
+#include <algorithm>
 
 namespace QtWordEditor {
 
@@ -25,6 +32,7 @@ Document::Document(QObject *parent)
     , m_modified(m_created)
     , m_undoStack(new QUndoStack(this))
 {
+    m_undoMemory = new UndoMemoryManager(m_undoStack.data(), Constants::UNDO_MEMORY_BUDGET_BYTES, this);
 }
 
 /**
@@ -148,8 +156,10 @@ void Document::insertSection(int index, Section *section)
         return;
     section->setParent(this);
     m_sections.insert(index, section);
+    connectSection(section);
+    registerSectionBlocks(section);
+    rebuildSectionIndex();
     emit sectionAdded(index);
-    updateBlockPositions();
 }
 
 /**
@@ -161,9 +171,11 @@ void Document::removeSection(int index)
     if (index < 0 || index >= m_sections.size())
         return;
     Section *section = m_sections.takeAt(index);
+    disconnect(section, nullptr, this, nullptr);
+    unregisterSectionBlocks(section);
+    rebuildSectionIndex();
     section->deleteLater();
     emit sectionRemoved(index);
-    updateBlockPositions();
 }
 
 /**
@@ -172,10 +184,7 @@ void Document::removeSection(int index)
  */
 int Document::blockCount() const
 {
-    int total = 0;
-    for (Section *section : m_sections)
-        total += section->blockCount();
-    return total;
+    return m_totalBlockCount;
 }
 
 /**
@@ -185,16 +194,130 @@ int Document::blockCount() const
  */
 Block *Document::block(int globalIndex) const
 {
-    if (globalIndex < 0)
+    if (globalIndex < 0 || globalIndex >= m_totalBlockCount)
         return nullptr;
-    int remaining = globalIndex;
-    for (Section *section : m_sections) {
-        int cnt = section->blockCount();
-        if (remaining < cnt)
-            return section->block(remaining);
-        remaining -= cnt;
+    int localIndex = 0;
+    int sectionIndex = fenwickFind(globalIndex, &localIndex);
+    Section *section = m_sections.value(sectionIndex);
+    return section ? section->block(localIndex) : nullptr;
+}
+
+/**
+ * @brief Gets a block by its unique ID
+ * @param blockId Block ID
+ * @return Pointer to Block, or nullptr if no such block exists
+ */
+Block *Document::blockById(int blockId) const
+{
+    return m_blocksById.value(blockId, nullptr);
+}
+
+/**
+ * @brief Starts a batch of paragraph changes
+ *
+ * Until the matching endBlockChanges(), paragraphs record their changes here
+ * instead of emitting textChanged() one by one. Batches may be nested.
+ */
+void Document::beginBlockChanges()
+{
+    ++m_blockChangeDepth;
+}
+
+/**
+ * @brief Ends a batch of paragraph changes
+ *
+ * When the outermost batch ends, the style usage index is updated for the
+ * changed paragraphs and blocksChanged() is emitted once for their index range.
+ */
+void Document::endBlockChanges()
+{
+    if (m_blockChangeDepth <= 0 || --m_blockChangeDepth > 0)
+        return;
+    if (m_changedBlocks.isEmpty())
+        return;
+
+    const QSet<ParagraphBlock*> changed = std::exchange(m_changedBlocks, QSet<ParagraphBlock*>());
+    int firstIndex = -1;
+    int lastIndex = -1;
+    for (ParagraphBlock *para : changed) {
+        const int index = indexOfBlock(para);
+        if (index < 0)
+            continue;
+        firstIndex = (firstIndex < 0) ? index : qMin(firstIndex, index);
+        lastIndex = qMax(lastIndex, index);
     }
-    return nullptr;
+    if (firstIndex >= 0)
+        emit blocksChanged(firstIndex, lastIndex);
+}
+
+/**
+ * @brief Checks whether paragraph changes are currently batched
+ * @return true between beginBlockChanges() and the outermost endBlockChanges()
+ */
+bool Document::isBatchingBlockChanges() const
+{
+    return m_blockChangeDepth > 0;
+}
+
+/**
+ * @brief Records a paragraph whose content changed during a batch
+ * @param block Changed paragraph
+ */
+void Document::noteBlockChanged(ParagraphBlock *block)
+{
+    if (block)
+        m_changedBlocks.insert(block);
+}
+
+/**
+ * @brief Gets the global index of a block
+ * @param block Block to look up
+ * @return Global block index, or -1 if the block is not in this document
+ *
+ * The section offset comes from the Fenwick tree of block counts and the
+ * index within the section is kept exact by Section, so the lookup is O(log n).
+ */
+int Document::indexOfBlock(const Block *block) const
+{
+    if (!block)
+        return -1;
+    Section *section = qobject_cast<Section*>(block->parent());
+    auto it = m_sectionIndices.constFind(section);
+    if (!section || it == m_sectionIndices.constEnd())
+        return -1;
+
+    const int localIndex = section->indexOfBlock(block);
+    if (localIndex < 0)
+        return -1;
+    return fenwickPrefix(it.value()) + localIndex;
+}
+
+/**
+ * @brief Merges a set of blocks into consecutive global index ranges
+ * @param blocks Blocks in any order, duplicates allowed
+ * @return (first, last) index pairs in document order
+ */
+QVector<QPair<int, int>> Document::blockIndexRanges(const QList<Block*> &blocks) const
+{
+    QVector<int> indices;
+    indices.reserve(blocks.size());
+    for (Block *block : blocks) {
+        const int index = indexOfBlock(block);
+        if (index >= 0)
+            indices.append(index);
+    }
+    std::sort(indices.begin(), indices.end());
+    indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+
+    QVector<QPair<int, int>> ranges;
+    for (int i = 0; i < indices.size(); ) {
+        const int first = indices.at(i);
+        int last = first;
+        for (++i; i < indices.size() && indices.at(i) == last + 1; ++i)
+            last = indices.at(i);
+        ranges.append(qMakePair(first, last));
+    }
+    return ranges;
 }
 
 /**
@@ -206,6 +329,94 @@ QUndoStack *Document::undoStack() const
     return m_undoStack.data();
 }
 
+/**
+ * @brief Gets the memory manager of the undo stack
+ * @return Pointer to the UndoMemoryManager (owned by the document)
+ */
+UndoMemoryManager *Document::undoMemoryManager() const
+{
+    return m_undoMemory;
+}
+
+/**
+ * @brief Runs an edit command by pushing it onto the undo stack
+ * @param command Command to run; the undo stack takes ownership
+ *
+ * When a command journal is attached the command is recorded first, so
+ * every edit can be replayed after a crash.
+ */
+void Document::pushCommand(EditCommand *command)
+{
+    if (!command)
+        return;
+    if (m_commandJournal)
+        m_commandJournal->push(command);
+    else
+        m_undoStack->push(command);
+}
+
+/**
+ * @brief Sets the journal that records edit commands
+ * @param journal Command journal, or nullptr to stop recording
+ */
+void Document::setCommandJournal(CommandJournal *journal)
+{
+    m_commandJournal = journal;
+}
+
+/**
+ * @brief Returns the journal recording edit commands
+ * @return Command journal, or nullptr if none is set
+ */
+CommandJournal *Document::commandJournal() const
+{
+    return m_commandJournal;
+}
+
+/**
+ * @brief Returns the style manager resolving named styles for this document
+ * @return Style manager, or nullptr if none is attached
+ */
+StyleManager *Document::styleManager() const
+{
+    return m_styleManager;
+}
+
+/**
+ * @brief Attaches the style manager used to resolve named styles
+ * @param styleManager Style manager (not owned)
+ */
+void Document::setStyleManager(StyleManager *styleManager)
+{
+    m_styleManager = styleManager;
+}
+
+/**
+ * @brief Returns the blocks whose runs reference any of the given character styles
+ * @param styleNames Character style names
+ * @return Blocks without duplicates
+ */
+QList<Block*> Document::blocksUsingCharacterStyles(const QStringList &styleNames) const
+{
+    QSet<Block*> blocks;
+    for (const QString &name : styleNames)
+        blocks.unite(m_characterStyleUsers.value(name));
+    return blocks.values();
+}
+
+/**
+ * @brief Returns the blocks whose paragraph style is any of the given styles
+ * @param styleNames Paragraph style names
+ * @return Blocks without duplicates
+ */
+QList<Block*> Document::blocksUsingParagraphStyles(const QStringList &styleNames) const
+{
+    QSet<Block*> blocks;
+    for (const QString &name : styleNames)
+        blocks.unite(m_paragraphStyleUsers.value(name));
+    return blocks.values();
+}
+
 /**
  * @brief Exports the document as plain text (for testing)
  * @return Plain text representation
@@ -224,18 +435,279 @@ QString Document::plainText() const
 }
 
 /**
- * @brief Updates the global position of all blocks in the document
+ * @brief Rebuilds the section index map and the Fenwick tree of block counts
  */
-void Document::updateBlockPositions()
+void Document::rebuildSectionIndex()
 {
-    int globalIndex = 0;
-    for (Section *section : m_sections) {
-        for (int i = 0; i < section->blockCount(); ++i) {
-            Block *blk = section->block(i);
-            blk->setPositionInDocument(globalIndex++);
+    m_sectionIndices.clear();
+    m_sectionBlockTree.fill(0, m_sections.size() + 1);
+    m_totalBlockCount = 0;
+    for (int i = 0; i < m_sections.size(); ++i) {
+        m_sectionIndices.insert(m_sections.at(i), i);
+        int count = m_sections.at(i)->blockCount();
+        m_totalBlockCount += count;
+        // O(n) Fenwick construction: push each node into its parent
+        int node = i + 1;
+        m_sectionBlockTree[node] += count;
+        int parentNode = node + (node & -node);
+        if (parentNode < m_sectionBlockTree.size())
+            m_sectionBlockTree[parentNode] += m_sectionBlockTree[node];
+    }
+}
+
+/**
+ * @brief Connects the block insert/remove signals of a section
+ * @param section Section to connect
+ */
+void Document::connectSection(Section *section)
+{
+    connect(section, &Section::blockAdded, this, [this, section](int index) {
+        handleBlockInserted(section, index);
+    });
+    connect(section, &Section::blockAboutToBeRemoved, this, [this, section](int index) {
+        handleBlockAboutToBeRemoved(section, index);
+    });
+}
+
+/**
+ * @brief Registers every block of a section in the block ID hash
+ * @param section Section whose blocks are registered
+ */
+void Document::registerSectionBlocks(Section *section)
+{
+    for (int i = 0; i < section->blockCount(); ++i)
+        registerBlock(section->block(i));
+}
+
+/**
+ * @brief Removes every block of a section from the block ID hash
+ * @param section Section whose blocks are unregistered
+ */
+void Document::unregisterSectionBlocks(Section *section)
+{
+    for (int i = 0; i < section->blockCount(); ++i)
+        unregisterBlock(section->block(i));
+}
+
+/**
+ * @brief Incrementally updates the index after a block was inserted into a section
+ * @param section Section that received the block
+ * @param localIndex Index of the block within the section
+ */
+void Document::handleBlockInserted(Section *section, int localIndex)
+{
+    auto it = m_sectionIndices.constFind(section);
+    if (it == m_sectionIndices.constEnd())
+        return;
+    fenwickAdd(it.value(), 1);
+    ++m_totalBlockCount;
+
+    Block *blk = section->block(localIndex);
+    registerBlock(blk);
+    emit blockAdded(fenwickPrefix(it.value()) + localIndex);
+}
+
+/**
+ * @brief Incrementally updates the index before a block is removed from a section
+ * @param section Section losing the block
+ * @param localIndex Index of the block within the section
+ */
+void Document::handleBlockAboutToBeRemoved(Section *section, int localIndex)
+{
+    auto it = m_sectionIndices.constFind(section);
+    if (it == m_sectionIndices.constEnd())
+        return;
+    int globalIndex = fenwickPrefix(it.value()) + localIndex;
+    unregisterBlock(section->block(localIndex));
+    fenwickAdd(it.value(), -1);
+    --m_totalBlockCount;
+    emit blockRemoved(globalIndex);
+}
+
+/**
+ * @brief Assigns a unique ID to a block if needed and registers it
+ * @param block Block to register
+ */
+void Document::registerBlock(Block *block)
+{
+    if (!block)
+        return;
+    int id = block->blockId();
+    // 克隆出来的块会沿用原块的ID，冲突时重新分配
+    Block *existing = (id >= 0) ? m_blocksById.value(id, nullptr) : nullptr;
+    if (id < 0 || (existing && existing != block)) {
+        id = m_nextBlockId++;
+        block->setBlockId(id);
+    } else if (id >= m_nextBlockId) {
+        m_nextBlockId = id + 1;
+    }
+    m_blocksById.insert(id, block);
+
+    if (ParagraphBlock *para = qobject_cast<ParagraphBlock*>(block)) {
+        // 只在游程的样式名称变化时更新反向索引，普通输入不触发
+        connect(para, &ParagraphBlock::characterStyleNamesChanged, this, [this, para]() {
+            updateCharacterStyleUsage(para);
+        });
+        connect(para, &ParagraphBlock::paragraphStyleNameChanged, this, [this, para]() {
+            updateParagraphStyleUsage(para);
+        });
+        updateCharacterStyleUsage(para);
+        updateParagraphStyleUsage(para);
+    }
+}
+
+/**
+ * @brief Removes a block from the ID hash
+ * @param block Block to unregister
+ */
+void Document::unregisterBlock(Block *block)
+{
+    if (!block)
+        return;
+    auto it = m_blocksById.find(block->blockId());
+    if (it != m_blocksById.end() && it.value() == block)
+        m_blocksById.erase(it);
+    if (ParagraphBlock *para = qobject_cast<ParagraphBlock*>(block))
+        m_changedBlocks.remove(para);
+
+    disconnect(block, nullptr, this, nullptr);
+    removeStyleUsage(block);
+}
+
+/**
+ * @brief Re-indexes the character style names referenced by a paragraph's runs
+ * @param block Paragraph whose runs changed
+ */
+void Document::updateCharacterStyleUsage(ParagraphBlock *block)
+{
+    QSet<QString> names = block->characterStyleNames();
+    QSet<QString> oldNames = m_blockCharacterStyles.value(block);
+    if (names == oldNames)
+        return;
+
+    for (const QString &name : oldNames) {
+        if (!names.contains(name)) {
+            auto users = m_characterStyleUsers.find(name);
+            if (users != m_characterStyleUsers.end()) {
+                users->remove(block);
+                if (users->isEmpty())
+                    m_characterStyleUsers.erase(users);
+            }
         }
     }
+    for (const QString &name : names) {
+        if (!oldNames.contains(name))
+            m_characterStyleUsers[name].insert(block);
+    }
+
+    if (names.isEmpty())
+        m_blockCharacterStyles.remove(block);
+    else
+        m_blockCharacterStyles.insert(block, names);
 }
 
-} // namespace QtWordEditor
+/**
+ * @brief Re-indexes the paragraph style name of a paragraph
+ * @param block Paragraph whose style name changed
+ */
+void Document::updateParagraphStyleUsage(ParagraphBlock *block)
+{
+    QString name = block->paragraphStyleName();
+    QString oldName = m_blockParagraphStyles.value(block);
+    if (name == oldName)
+        return;
+
+    if (!oldName.isEmpty()) {
+        auto users = m_paragraphStyleUsers.find(oldName);
+        if (users != m_paragraphStyleUsers.end()) {
+            users->remove(block);
+            if (users->isEmpty())
+                m_paragraphStyleUsers.erase(users);
+        }
+    }
+    if (name.isEmpty()) {
+        m_blockParagraphStyles.remove(block);
+    } else {
+        m_paragraphStyleUsers[name].insert(block);
+        m_blockParagraphStyles.insert(block, name);
+    }
+}
+
+/**
+ * @brief Drops a block from both style reverse indexes
+ * @param block Block leaving the document
+ */
+void Document::removeStyleUsage(Block *block)
+{
+    const QSet<QString> names = m_blockCharacterStyles.take(block);
+    for (const QString &name : names) {
+        auto users = m_characterStyleUsers.find(name);
+        if (users != m_characterStyleUsers.end()) {
+            users->remove(block);
+            if (users->isEmpty())
+                m_characterStyleUsers.erase(users);
+        }
+    }
 
+    const QString paragraphName = m_blockParagraphStyles.take(block);
+    if (!paragraphName.isEmpty()) {
+        auto users = m_paragraphStyleUsers.find(paragraphName);
+        if (users != m_paragraphStyleUsers.end()) {
+            users->remove(block);
+            if (users->isEmpty())
+                m_paragraphStyleUsers.erase(users);
+        }
+    }
+}
+
+/**
+ * @brief Adds delta to the block count of a section in the Fenwick tree
+ * @param sectionIndex Section index (0-based)
+ * @param delta Block count change
+ */
+void Document::fenwickAdd(int sectionIndex, int delta)
+{
+    for (int node = sectionIndex + 1; node < m_sectionBlockTree.size(); node += node & -node)
+        m_sectionBlockTree[node] += delta;
+}
+
+/**
+ * @brief Sums the block counts of the first count sections
+ * @param count Number of sections
+ * @return Number of blocks before section index count
+ */
+int Document::fenwickPrefix(int count) const
+{
+    int sum = 0;
+    for (int node = qMin(count, m_sectionBlockTree.size() - 1); node > 0; node -= node & -node)
+        sum += m_sectionBlockTree.at(node);
+    return sum;
+}
+
+/**
+ * @brief Finds the section containing a global block index
+ * @param globalIndex Global block index, must be < blockCount()
+ * @param localIndex Output: index of the block within the section
+ * @return Section index
+ */
+int Document::fenwickFind(int globalIndex, int *localIndex) const
+{
+    // 二进制提升：找到前缀和不超过 globalIndex 的最长前缀
+    int node = 0;
+    int remaining = globalIndex;
+    int step = 1;
+    while (step * 2 < m_sectionBlockTree.size())
+        step *= 2;
+    for (; step > 0; step /= 2) {
+        int next = node + step;
+        if (next < m_sectionBlockTree.size() && m_sectionBlockTree.at(next) <= remaining) {
+            node = next;
+            remaining -= m_sectionBlockTree.at(next);
+        }
+    }
+    if (localIndex)
+        *localIndex = remaining;
+    return node;
+}
+
+} // namespace QtWordEditor
@@ -69,7 +69,6 @@ Block *ImageBlock::clone() const
     copy->setBlockId(blockId());
     copy->setBoundingRect(boundingRect());
     copy->setHeight(height());
-    copy->setPositionInDocument(positionInDocument());
     return copy;
 }
 
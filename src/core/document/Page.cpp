@@ -37,31 +37,58 @@ QRectF Page::contentRect() const
 
 int Page::blockCount() const
 {
-    return m_blocks.size();
+    return m_fragments.size();
 }
 
 Block *Page::block(int index) const
 {
-    if (index >= 0 && index < m_blocks.size())
-        return m_blocks.at(index);
+    if (index >= 0 && index < m_fragments.size())
+        return m_fragments.at(index).block;
     return nullptr;
 }
 
 void Page::addBlock(Block *block)
 {
     if (block) {
-        m_blocks.append(block);
+        BlockFragment fragment;
+        fragment.block = block;
+        fragment.textHeight = block->height();
+        fragment.height = block->height();
+        m_fragments.append(fragment);
     }
 }
 
 void Page::clearBlocks()
 {
-    m_blocks.clear();
+    m_fragments.clear();
 }
 
 bool Page::isEmpty() const
 {
-    return m_blocks.isEmpty();
+    return m_fragments.isEmpty();
+}
+
+bool Page::containsBlock(const Block *block) const
+{
+    for (const BlockFragment &fragment : m_fragments) {
+        if (fragment.block == block)
+            return true;
+    }
+    return false;
+}
+
+BlockFragment Page::fragment(int index) const
+{
+    if (index >= 0 && index < m_fragments.size())
+        return m_fragments.at(index);
+    return BlockFragment();
+}
+
+void Page::addFragment(const BlockFragment &fragment)
+{
+    if (fragment.block) {
+        m_fragments.append(fragment);
+    }
 }
 
 } // namespace QtWordEditor
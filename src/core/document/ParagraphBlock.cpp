@@ -1,6 +1,11 @@
 #include "core/document/ParagraphBlock.h"
+#include "core/document/Document.h"
+#include "core/styles/StylePool.h"
+#include "core/styles/StyleManager.h"
 #include "core/utils/Logger.h"
+#include <QHash>
 #include <QDebug>
+#include <algorithm>
 
 namespace QtWordEditor {
 
@@ -11,8 +16,10 @@ ParagraphBlock::ParagraphBlock(QObject *parent)
 
 ParagraphBlock::ParagraphBlock(const ParagraphBlock &other)
     : Block(other.parent())
-    , m_spans(other.m_spans)
-    , m_paragraphStyle(other.m_paragraphStyle)
+    , m_text(other.m_text)
+    , m_runs(other.m_runs)
+    , m_paragraphStyleId(other.m_paragraphStyleId)
+    , m_paragraphStyleName(other.m_paragraphStyleName)
 {
     // Note: clone() should be used for deep copy
 }
@@ -23,79 +30,91 @@ ParagraphBlock::~ParagraphBlock()
 
 QString ParagraphBlock::text() const
 {
-    QString result;
-    for (const Span &span : m_spans)
-        result += span.text();
-    return result;
+    // 文本存放在连续缓冲区中，隐式共享返回，无需拼接
+    return m_text;
 }
 
 void ParagraphBlock::setText(const QString &text)
 {
-    m_spans.clear();
+    const bool hadNames = hasStyleNames(0, m_runs.size());
+    m_text = text;
+    m_runs.clear();
     if (!text.isEmpty()) {
-        m_spans.append(Span(text, CharacterStyle()));
+        StyleRun run;
+        run.length = text.length();
+        m_runs.append(run);
     }
-    emit textChanged();
+    invalidateRunStarts(0);
+    notifyContentChanged();
+    if (hadNames)
+        emit characterStyleNamesChanged();
 }
 
 int ParagraphBlock::findSpanIndex(int globalPosition, int *positionInSpan) const
 {
-    int totalLength = this->length();
-    
+    if (m_runs.isEmpty()) {
+        if (positionInSpan) {
+            *positionInSpan = 0;
+        }
+        return -1;
+    }
+
+    int totalLength = m_text.length();
+
     // 特殊处理：如果位置等于总长度（文档末尾）
-    if (globalPosition == totalLength && !m_spans.isEmpty()) {
+    if (globalPosition == totalLength) {
         if (positionInSpan) {
-            *positionInSpan = m_spans.last().length();
+            *positionInSpan = m_runs.last().length;
         }
-        return m_spans.size() - 1;
-    }
-    
-    int currentPos = 0;
-    for (int i = 0; i < m_spans.size(); ++i) {
-        int spanLength = m_spans.at(i).length();
-        if (globalPosition < currentPos + spanLength) { // 使用 < 判断位置是否在当前 span 内
-            if (positionInSpan) {
-                *positionInSpan = globalPosition - currentPos;
-            }
-            return i;
+        return m_runs.size() - 1;
+    }
+    if (globalPosition > totalLength) {
+        if (positionInSpan) {
+            *positionInSpan = 0;
         }
-        currentPos += spanLength;
+        return m_runs.size() - 1;
     }
+
+    // 在缓存的游程起始偏移上二分查找
+    ensureRunStarts();
+    int position = qMax(0, globalPosition);
+    auto begin = m_runStarts.constBegin();
+    auto it = std::upper_bound(begin, begin + m_runs.size(), position);
+    int index = int(it - begin) - 1;
     if (positionInSpan) {
-        *positionInSpan = 0;
+        *positionInSpan = position - m_runStarts.at(index);
     }
-    return m_spans.size() - 1;
+    return index;
 }
 
 CharacterStyle ParagraphBlock::styleAt(int position) const
 {
-    if (m_spans.isEmpty()) {
-        return CharacterStyle();
-    }
+    return StylePool::instance()->characterStyle(styleIdAt(position));
+}
+
+int ParagraphBlock::styleIdAt(int position) const
+{
     int spanIndex = findSpanIndex(position);
-    if (spanIndex >= 0 && spanIndex < m_spans.size()) {
-        return m_spans.at(spanIndex).style();
+    if (spanIndex >= 0 && spanIndex < m_runs.size()) {
+        return m_runs.at(spanIndex).styleId;
     }
-    return CharacterStyle();
+    return StylePool::DefaultStyleId;
 }
 
 QChar ParagraphBlock::characterAt(int position) const
 {
-    if (position < 0 || position >= this->length()) {
+    if (position < 0 || position >= m_text.length()) {
         return QChar();
     }
-    
-    int currentPos = 0;
-    for (const Span &span : m_spans) {
-        int spanLength = span.length();
-        if (position < currentPos + spanLength) {
-            int posInSpan = position - currentPos;
-            return span.text().at(posInSpan);
-        }
-        currentPos += spanLength;
+    return m_text.at(position);
+}
+
+bool ParagraphBlock::isRangeSpansMultipleSpans(int start, int end) const
+{
+    if (start >= end) {
+        return false;
     }
-    
-    return QChar();
+    return findSpanIndex(start) != findSpanIndex(end - 1);
 }
 
 void ParagraphBlock::setStyle(int start, int length, const CharacterStyle &style)
@@ -103,178 +122,137 @@ void ParagraphBlock::setStyle(int start, int length, const CharacterStyle &style
     if (!validatePositionAndLength(start, length)) {
         return;
     }
-    
-    int end = start + length;
-    
+
     LOG_DEBUG(QString("ParagraphBlock::setStyle - 开始处理: 位置%1 长度%2").arg(start).arg(length));
-    
-    // 找到起始和结束的 span
-    int posInStartSpan = 0;
-    int startSpanIndex = findSpanIndex(start, &posInStartSpan);
-    
-    int posInEndSpan = 0;
-    int endSpanIndex = findSpanIndex(end, &posInEndSpan);
-    
-    // 如果在同一个 span 内
-    if (startSpanIndex == endSpanIndex) {
-        Span &span = m_spans[startSpanIndex];
-        QString text = span.text();
-        
-        LOG_DEBUG(QString("  同一个 span 内处理: startSpanIndex=%1, text=[%2], 长度=%3")
-            .arg(startSpanIndex).arg(text).arg(text.length()));
-        LOG_DEBUG(QString("    posInStartSpan=%1, posInEndSpan=%2").arg(posInStartSpan).arg(posInEndSpan));
-        
-        // 分割成三个部分
-        QString before = text.left(posInStartSpan);
-        QString middle = text.mid(posInStartSpan, end - start);
-        QString after = text.mid(posInEndSpan);
-        
-        LOG_DEBUG(QString("    before=[%1], middle=[%2], after=[%3]").arg(before).arg(middle).arg(after));
-        
-        // 保存原始样式的副本！防止隐式共享问题！必须在删除之前获取！
-        CharacterStyle originalStyle = span.style();
-        
-        // 替换原来的 span
-        m_spans.removeAt(startSpanIndex);
-        
-        LOG_DEBUG(QString("    原始样式的加粗: %1").arg(originalStyle.bold()));
-        
-        if (!before.isEmpty()) {
-            LOG_DEBUG(QString("    插入 before span, 加粗: %1").arg(originalStyle.bold()));
-            m_spans.insert(startSpanIndex, Span(before, originalStyle));
-            startSpanIndex++;
-        }
-        
-        // ========== 修改：合并样式而不是直接替换 ==========
-        LOG_DEBUG("    合并样式：");
-        LOG_DEBUG(QString("      originalStyle - 字体族:%1，字号:%2，加粗:%3")
-            .arg(originalStyle.fontFamily())
-            .arg(originalStyle.fontSize())
-            .arg(originalStyle.bold()));
-        LOG_DEBUG(QString("      传入的 style - 字体族:%1，字号:%2，加粗:%3")
-            .arg(style.fontFamily())
-            .arg(style.fontSize())
-            .arg(style.bold()));
-        LOG_DEBUG(QString("      传入的 style 属性标记 - 字体族:%1，字号:%2，加粗:%3")
-            .arg(style.isPropertySet(CharacterStyleProperty::FontFamily))
-            .arg(style.isPropertySet(CharacterStyleProperty::FontSize))
-            .arg(style.isPropertySet(CharacterStyleProperty::Bold)));
-        
-        CharacterStyle mergedMiddleStyle = originalStyle.mergeWith(style);
-        
-        LOG_DEBUG(QString("      mergedMiddleStyle - 字体族:%1，字号:%2，加粗:%3")
-            .arg(mergedMiddleStyle.fontFamily())
-            .arg(mergedMiddleStyle.fontSize())
-            .arg(mergedMiddleStyle.bold()));
-        
-        m_spans.insert(startSpanIndex, Span(middle, mergedMiddleStyle));
-        startSpanIndex++;
-        
-        if (!after.isEmpty()) {
-            LOG_DEBUG(QString("    插入 after span, 加粗: %1").arg(originalStyle.bold()));
-            m_spans.insert(startSpanIndex, Span(after, originalStyle));
+
+    // 在范围两端切分游程，只修改游程数组，不触碰文本缓冲区
+    int firstRun = splitRunAt(start);
+    int endRun = splitRunAt(start + length);
+
+    // ========== 合并样式而不是直接替换 ==========
+    // 同一段落中的游程通常只有少数几种样式，按旧ID记住合并结果避免重复驻留
+    StylePool *pool = StylePool::instance();
+    QHash<int, int> mergedIds;
+    for (int i = firstRun; i < endRun; ++i) {
+        const int oldId = m_runs.at(i).styleId;
+        auto it = mergedIds.constFind(oldId);
+        if (it == mergedIds.constEnd()) {
+            it = mergedIds.insert(oldId, pool->internCharacterStyle(pool->characterStyle(oldId).mergeWith(style)));
         }
-        
-        LOG_DEBUG(QString("  同一个 span 内处理完成，当前 spans 数量: %1").arg(m_spans.size()));
+        m_runs[i].styleId = it.value();
+    }
+
+    mergeAdjacentSpans(firstRun - 1, endRun);
+
+    LOG_DEBUG(QString("ParagraphBlock::setStyle - 处理完成，当前游程数量: %1").arg(m_runs.size()));
+    notifyContentChanged();
+}
+
+const QVector<StyleRun> &ParagraphBlock::styleRuns() const
+{
+    return m_runs;
+}
+
+QVector<StyleRun> ParagraphBlock::runs(int start, int length) const
+{
+    QVector<StyleRun> result;
+    if (!validatePositionAndLength(start, length)) {
+        return result;
+    }
+
+    const int end = start + length;
+    int positionInRun = 0;
+    int runIndex = findSpanIndex(start, &positionInRun);
+    int runStart = start - positionInRun;
+    for (; runIndex < m_runs.size() && runStart < end; ++runIndex) {
+        StyleRun run = m_runs.at(runIndex);
+        const int runEnd = runStart + run.length;
+        run.length = qMin(runEnd, end) - qMax(runStart, start);
+        result.append(run);
+        runStart = runEnd;
+    }
+    return result;
+}
+
+void ParagraphBlock::replaceRuns(int start, int length, const QVector<StyleRun> &runs)
+{
+    if (!validatePositionAndLength(start, length)) {
+        return;
+    }
+    int total = 0;
+    for (const StyleRun &run : runs) {
+        total += run.length;
+    }
+    if (total != length) {
+        qWarning() << "ParagraphBlock::replaceRuns - run lengths" << total << "do not match range length" << length;
+        return;
+    }
+
+    // 只替换范围内的游程，文本缓冲区不变
+    const int firstRun = splitRunAt(start);
+    const int endRun = splitRunAt(start + length);
+    bool namesChanged = hasStyleNames(firstRun, endRun);
+    for (int i = 0; i < runs.size() && !namesChanged; ++i) {
+        namesChanged = !runs.at(i).styleName.isEmpty();
+    }
+    if (runs.size() == endRun - firstRun) {
+        std::copy(runs.constBegin(), runs.constEnd(), m_runs.begin() + firstRun);
     } else {
-        LOG_DEBUG(QString("  跨 span 处理: startSpanIndex=%1, endSpanIndex=%2")
-            .arg(startSpanIndex).arg(endSpanIndex));
-        
-        // 处理起始 span
-        Span &startSpan = m_spans[startSpanIndex];
-        QString startText = startSpan.text();
-        QString beforeStart = startText.left(posInStartSpan);
-        QString afterStart = startText.mid(posInStartSpan);
-        
-        LOG_DEBUG(QString("    起始 span 文本: [%1], 长度: %2").arg(startText).arg(startText.length()));
-        LOG_DEBUG(QString("      beforeStart: [%1], afterStart: [%2]").arg(beforeStart).arg(afterStart));
-        
-        // 保存原始样式的副本！防止隐式共享问题！
-        CharacterStyle originalStartStyle = startSpan.style();
-        
-        m_spans.removeAt(startSpanIndex);
-        
-        if (!beforeStart.isEmpty()) {
-            m_spans.insert(startSpanIndex, Span(beforeStart, originalStartStyle));
-            startSpanIndex++;
-        }
-        
-        // ========== 修改：合并样式而不是直接替换 ==========
-        CharacterStyle mergedStartStyle = originalStartStyle.mergeWith(style);
-        m_spans.insert(startSpanIndex, Span(afterStart, mergedStartStyle));
-        
-        LOG_DEBUG(QString("    起始 span 处理后, startSpanIndex 现在是: %1").arg(startSpanIndex));
-        LOG_DEBUG(QString("    当前 spans 数量: %1").arg(m_spans.size()));
-        
-        // 重要！因为我们删除和插入了 span，需要重新计算 endSpanIndex
-        // 重新计算当前的 endSpanIndex
-        int adjustedEndSpanIndex = 0;
-        int posInEndSpanAdjusted = 0;
-        if (end > 0 && end <= this->length()) {
-            adjustedEndSpanIndex = findSpanIndex(end, &posInEndSpanAdjusted);
-        } else {
-            adjustedEndSpanIndex = m_spans.size() - 1;
-            posInEndSpanAdjusted = m_spans.last().length();
-        }
-        
-        LOG_DEBUG(QString("    重新计算后的 endSpanIndex: %1, posInEndSpanAdjusted: %2")
-            .arg(adjustedEndSpanIndex).arg(posInEndSpanAdjusted));
-        
-        // 处理中间的 span（完全包含在范围内的）
-        // 注意：现在中间 span 的索引范围是 startSpanIndex + 1 到 adjustedEndSpanIndex - 1
-        for (int i = startSpanIndex + 1; i < adjustedEndSpanIndex; ++i) {
-            if (i >= 0 && i < m_spans.size()) {
-                LOG_DEBUG(QString("      处理中间 span %1").arg(i));
-                CharacterStyle mergedMiddleStyle = m_spans[i].style().mergeWith(style);
-                m_spans[i].setStyle(mergedMiddleStyle);
-            }
-        }
-        
-        // 处理结束 span
-        if (adjustedEndSpanIndex >= 0 && adjustedEndSpanIndex < m_spans.size()) {
-            Span &endSpan = m_spans[adjustedEndSpanIndex];
-            QString endText = endSpan.text();
-            QString beforeEnd = endText.left(posInEndSpanAdjusted);
-            QString afterEnd = endText.mid(posInEndSpanAdjusted);
-            
-            LOG_DEBUG(QString("    结束 span 文本: [%1], 长度: %2").arg(endText).arg(endText.length()));
-            LOG_DEBUG(QString("      beforeEnd: [%1], afterEnd: [%2]").arg(beforeEnd).arg(afterEnd));
-            
-            // 保存原始样式引用
-            CharacterStyle originalEndStyle = endSpan.style();
-            
-            m_spans.removeAt(adjustedEndSpanIndex);
-            
-            if (!beforeEnd.isEmpty()) {
-                CharacterStyle mergedEndStyle = originalEndStyle.mergeWith(style);
-                m_spans.insert(adjustedEndSpanIndex, Span(beforeEnd, mergedEndStyle));
-                adjustedEndSpanIndex++;
-            }
-            
-            if (!afterEnd.isEmpty()) {
-                m_spans.insert(adjustedEndSpanIndex, Span(afterEnd, originalEndStyle));
-            }
-        }
-        
-        LOG_DEBUG("  跨 span 处理完成");
-    }
-    
-    LOG_DEBUG("  mergeAdjacentSpans 之前的 spans:");
-    for (int i = 0; i < m_spans.size(); ++i) {
-        LOG_DEBUG(QString("    span %1: text=[%2], 加粗:%3")
-            .arg(i).arg(m_spans[i].text()).arg(m_spans[i].style().bold()));
-    }
-    
-    mergeAdjacentSpans();
-    
-    LOG_DEBUG("  mergeAdjacentSpans 之后的 spans:");
-    for (int i = 0; i < m_spans.size(); ++i) {
-        LOG_DEBUG(QString("    span %1: text=[%2], 加粗:%3")
-            .arg(i).arg(m_spans[i].text()).arg(m_spans[i].style().bold()));
-    }
-    
-    LOG_DEBUG("ParagraphBlock::setStyle - 处理完成");
-    emit textChanged();
+        const QVector<StyleRun> tail = m_runs.mid(endRun);
+        m_runs.resize(firstRun);
+        m_runs += runs;
+        m_runs += tail;
+    }
+    invalidateRunStarts(firstRun);
+
+    mergeAdjacentSpans(firstRun - 1, firstRun + runs.size());
+    notifyContentChanged();
+    if (namesChanged)
+        emit characterStyleNamesChanged();
+}
+
+void ParagraphBlock::setStyleName(int start, int length, const QString &styleName)
+{
+    if (!validatePositionAndLength(start, length)) {
+        return;
+    }
+
+    int firstRun = splitRunAt(start);
+    int endRun = splitRunAt(start + length);
+    bool namesChanged = false;
+    for (int i = firstRun; i < endRun; ++i) {
+        namesChanged |= (m_runs.at(i).styleName != styleName);
+        m_runs[i].styleName = styleName;
+    }
+
+    mergeAdjacentSpans(firstRun - 1, endRun);
+    notifyContentChanged();
+    if (namesChanged)
+        emit characterStyleNamesChanged();
+}
+
+QSet<QString> ParagraphBlock::characterStyleNames() const
+{
+    QSet<QString> names;
+    for (const StyleRun &run : m_runs) {
+        if (!run.styleName.isEmpty())
+            names.insert(run.styleName);
+    }
+    return names;
+}
+
+CharacterStyle ParagraphBlock::effectiveStyleAt(int position) const
+{
+    int spanIndex = findSpanIndex(position);
+    if (spanIndex < 0)
+        return CharacterStyle();
+
+    const StyleRun &run = m_runs.at(spanIndex);
+    CharacterStyle direct = StylePool::instance()->characterStyle(run.styleId);
+    const StyleManager *styles = run.styleName.isEmpty() ? nullptr : styleManager();
+    if (!styles || !styles->hasCharacterStyle(run.styleName))
+        return direct;
+    return styles->getResolvedCharacterStyle(run.styleName).mergeWith(direct);
 }
 
 void ParagraphBlock::insert(int position, const QString &text, const CharacterStyle &style)
@@ -282,61 +260,32 @@ void ParagraphBlock::insert(int position, const QString &text, const CharacterSt
     if (text.isEmpty())
         return;
 
-  //  QDebug() << "ParagraphBlock::insert - 插入文本，位置:" << position << "，文本:" << text;
-    
-    if (m_spans.isEmpty()) {
-        m_spans.append(Span(text, style));
+    position = qBound(0, position, m_text.length());
+
+    StyleRun newRun;
+    newRun.length = text.length();
+    newRun.styleId = StylePool::instance()->internCharacterStyle(style);
+
+    // 先在旧文本坐标下定位游程，再写入文本
+    int runIndex = splitRunAt(position);
+    if (runIndex > 0 && sameRunStyle(m_runs.at(runIndex - 1), newRun)) {
+        // 样式与前一个游程相同，在其末尾继续
+        m_runs[runIndex - 1].length += newRun.length;
+        invalidateRunStarts(runIndex);
+    } else if (runIndex < m_runs.size() && sameRunStyle(m_runs.at(runIndex), newRun)) {
+        // 样式与后一个游程相同，在其开头插入
+        m_runs[runIndex].length += newRun.length;
+        invalidateRunStarts(runIndex + 1);
     } else {
-        int posInSpan = 0;
-        int spanIndex = findSpanIndex(position, &posInSpan);
-        
-        if (spanIndex >= 0 && spanIndex < m_spans.size()) {
-            Span &span = m_spans[spanIndex];
-            QString spanText = span.text();
-            
-            if (posInSpan == 0) {
-                // 在 span 开头插入
-                if (span.style() == style) {
-                    // 样式相同，直接追加
-                    span.setText(text + spanText);
-                } else {
-                    // 样式不同，插入新 span
-                    m_spans.insert(spanIndex, Span(text, style));
-                }
-            } else if (posInSpan == spanText.length()) {
-                // 在 span 末尾插入
-                if (span.style() == style) {
-                    // 样式相同，直接追加
-                    span.append(text);
-                } else {
-                    // 样式不同，添加新 span
-                    m_spans.insert(spanIndex + 1, Span(text, style));
-                }
-            } else {
-                // 在 span 中间插入，需要分割
-                QString before = spanText.left(posInSpan);
-                QString after = spanText.mid(posInSpan);
-                
-                m_spans.removeAt(spanIndex);
-                
-                if (!before.isEmpty()) {
-                    m_spans.insert(spanIndex, Span(before, span.style()));
-                    spanIndex++;
-                }
-                
-                m_spans.insert(spanIndex, Span(text, style));
-                spanIndex++;
-                
-                if (!after.isEmpty()) {
-                    m_spans.insert(spanIndex, Span(after, span.style()));
-                }
-                
-                mergeAdjacentSpans();
-            }
-        }
+        // 样式不同，插入新游程
+        m_runs.insert(runIndex, newRun);
+        invalidateRunStarts(runIndex);
     }
-    
-    emit textChanged();
+    m_text.insert(position, text);
+
+    mergeAdjacentSpans(runIndex - 1, runIndex + 1);
+
+    notifyContentChanged();
 }
 
 void ParagraphBlock::remove(int position, int length)
@@ -345,155 +294,297 @@ void ParagraphBlock::remove(int position, int length)
         return;
     }
 
-    int end = position + length;
-    
-    // 找到起始和结束的 span
-    int posInStartSpan = 0;
-    int startSpanIndex = findSpanIndex(position, &posInStartSpan);
-    
-    int posInEndSpan = 0;
-    int endSpanIndex = findSpanIndex(end, &posInEndSpan);
-    
-    if (startSpanIndex == endSpanIndex) {
-        // 在同一个 span 内
-        Span &span = m_spans[startSpanIndex];
-        QString text = span.text();
-        QString before = text.left(posInStartSpan);
-        QString after = text.mid(posInEndSpan);
-        
-        if (before.isEmpty() && after.isEmpty()) {
-            m_spans.removeAt(startSpanIndex);
-        } else {
-            span.setText(before + after);
-        }
-    } else {
-        // 处理起始 span
-        Span &startSpan = m_spans[startSpanIndex];
-        QString startText = startSpan.text();
-        QString beforeStart = startText.left(posInStartSpan);
-        
-        if (beforeStart.isEmpty()) {
-            m_spans.removeAt(startSpanIndex);
-            endSpanIndex--;
-        } else {
-            startSpan.setText(beforeStart);
-            startSpanIndex++;
-        }
-        
-        // 删除中间的 span
-        while (startSpanIndex < endSpanIndex) {
-            m_spans.removeAt(startSpanIndex);
-            endSpanIndex--;
-        }
-        
-        // 处理结束 span
-        if (startSpanIndex < m_spans.size()) {
-            Span &endSpan = m_spans[startSpanIndex];
-            QString endText = endSpan.text();
-            QString afterEnd = endText.mid(posInEndSpan);
-            
-            if (afterEnd.isEmpty()) {
-                m_spans.removeAt(startSpanIndex);
-            } else {
-                endSpan.setText(afterEnd);
-            }
-        }
-        
-        mergeAdjacentSpans();
-    }
-    
-    emit textChanged();
+    // 切分出完整覆盖删除范围的游程，整体移除
+    int firstRun = splitRunAt(position);
+    int endRun = splitRunAt(position + length);
+    // 只有整个带样式名称的游程被删除时，引用的名称才可能减少
+    const bool namesChanged = hasStyleNames(firstRun, endRun);
+    m_runs.remove(firstRun, endRun - firstRun);
+    invalidateRunStarts(firstRun);
+    m_text.remove(position, length);
+
+    mergeAdjacentSpans(firstRun - 1, firstRun);
+
+    notifyContentChanged();
+    if (namesChanged)
+        emit characterStyleNamesChanged();
 }
 
 int ParagraphBlock::spanCount() const
 {
-    return m_spans.size();
+    return m_runs.size();
 }
 
 Span ParagraphBlock::span(int index) const
 {
-    if (index >= 0 && index < m_spans.size())
-        return m_spans.at(index);
-    return Span();
+    if (index < 0 || index >= m_runs.size())
+        return Span();
+
+    ensureRunStarts();
+    const StyleRun &run = m_runs.at(index);
+    Span result(m_text.mid(m_runStarts.at(index), run.length),
+                StylePool::instance()->characterStyle(run.styleId));
+    result.setStyleName(run.styleName);
+    return result;
+}
+
+int ParagraphBlock::spanStart(int index) const
+{
+    if (index < 0 || index > m_runs.size())
+        return -1;
+    ensureRunStarts();
+    return m_runStarts.at(index);
 }
 
 void ParagraphBlock::addSpan(const Span &span)
 {
-    m_spans.append(span);
-    emit textChanged();
+    if (span.length() > 0) {
+        StyleRun run;
+        run.length = span.length();
+        run.styleName = span.styleName();
+        run.styleId = StylePool::instance()->internCharacterStyle(span.style());
+        m_runs.append(run);
+        invalidateRunStarts(m_runs.size() - 1);
+        m_text.append(span.text());
+        mergeAdjacentSpans(m_runs.size() - 2, m_runs.size() - 1);
+    }
+    notifyContentChanged();
+    if (span.length() > 0 && !span.styleName().isEmpty())
+        emit characterStyleNamesChanged();
 }
 
 void ParagraphBlock::setSpan(int index, const Span &span)
 {
-    if (index >= 0 && index < m_spans.size()) {
-        m_spans[index] = span;
-        emit textChanged();
+    if (index < 0 || index >= m_runs.size())
+        return;
+
+    ensureRunStarts();
+    int start = m_runStarts.at(index);
+    const bool namesChanged = m_runs.at(index).styleName != span.styleName()
+                              || (span.length() == 0 && !span.styleName().isEmpty());
+    m_text.replace(start, m_runs.at(index).length, span.text());
+
+    if (span.length() == 0) {
+        m_runs.remove(index);
+        invalidateRunStarts(index);
+    } else {
+        StyleRun &run = m_runs[index];
+        run.length = span.length();
+        run.styleName = span.styleName();
+        run.styleId = StylePool::instance()->internCharacterStyle(span.style());
+        invalidateRunStarts(index + 1);
     }
+    mergeAdjacentSpans(index - 1, index + 1);
+    notifyContentChanged();
+    if (namesChanged)
+        emit characterStyleNamesChanged();
 }
 
 ParagraphStyle ParagraphBlock::paragraphStyle() const
 {
-    return m_paragraphStyle;
+    return StylePool::instance()->paragraphStyle(m_paragraphStyleId);
 }
 
 void ParagraphBlock::setParagraphStyle(const ParagraphStyle &style)
 {
-    if (m_paragraphStyle != style) {
-        m_paragraphStyle = style;
+    int styleId = StylePool::instance()->internParagraphStyle(style);
+    if (m_paragraphStyleId != styleId) {
+        m_paragraphStyleId = styleId;
+        ++m_styleVersion;
         // Emit style change signal if needed
     }
 }
 
+int ParagraphBlock::paragraphStyleId() const
+{
+    return m_paragraphStyleId;
+}
+
+QString ParagraphBlock::paragraphStyleName() const
+{
+    return m_paragraphStyleName;
+}
+
+void ParagraphBlock::setParagraphStyleName(const QString &styleName)
+{
+    if (m_paragraphStyleName != styleName) {
+        m_paragraphStyleName = styleName;
+        ++m_styleVersion;
+        emit paragraphStyleNameChanged();
+    }
+}
+
+ParagraphStyle ParagraphBlock::effectiveParagraphStyle() const
+{
+    ParagraphStyle direct = paragraphStyle();
+    const StyleManager *styles = m_paragraphStyleName.isEmpty() ? nullptr : styleManager();
+    if (!styles || !styles->hasParagraphStyle(m_paragraphStyleName))
+        return direct;
+    return styles->getResolvedParagraphStyle(m_paragraphStyleName).mergeWith(direct);
+}
+
+bool ParagraphBlock::hasNamedStyles() const
+{
+    if (!m_paragraphStyleName.isEmpty())
+        return true;
+    for (const StyleRun &run : m_runs) {
+        if (!run.styleName.isEmpty())
+            return true;
+    }
+    return false;
+}
+
+quint64 ParagraphBlock::contentVersion() const
+{
+    return m_contentVersion;
+}
+
+quint64 ParagraphBlock::styleVersion() const
+{
+    return m_styleVersion;
+}
+
+void ParagraphBlock::notifyContentChanged()
+{
+    ++m_contentVersion;
+    // During a document batch the change is reported once, by Document::blocksChanged()
+    Document *doc = document();
+    if (doc && doc->isBatchingBlockChanges()) {
+        doc->noteBlockChanged(this);
+        return;
+    }
+    emit textChanged();
+}
+
+const StyleManager *ParagraphBlock::styleManager() const
+{
+    Document *doc = document();
+    return doc ? doc->styleManager() : nullptr;
+}
+
 int ParagraphBlock::length() const
 {
-    int total = 0;
-    for (const Span &span : m_spans)
-        total += span.length();
-    return total;
+    return m_text.length();
 }
 
 bool ParagraphBlock::isEmpty() const
 {
-    return m_spans.isEmpty() || (m_spans.size() == 1 && m_spans.first().length() == 0);
+    return m_text.isEmpty();
 }
 
 Block *ParagraphBlock::clone() const
 {
     ParagraphBlock *copy = new ParagraphBlock(parent());
-    copy->m_spans = m_spans;
-    copy->m_paragraphStyle = m_paragraphStyle;
+    copy->m_text = m_text;
+    copy->m_runs = m_runs;
+    copy->m_paragraphStyleId = m_paragraphStyleId;
+    copy->m_paragraphStyleName = m_paragraphStyleName;
+    copy->m_contentVersion = m_contentVersion;
+    copy->m_styleVersion = m_styleVersion;
     copy->setBlockId(blockId());
     copy->setBoundingRect(boundingRect());
     copy->setHeight(height());
-    copy->setPositionInDocument(positionInDocument());
     return copy;
 }
 
 bool ParagraphBlock::validatePositionAndLength(int& position, int& length) const
 {
-    if (length <= 0 || m_spans.isEmpty()) {
+    if (length <= 0 || m_runs.isEmpty()) {
         return false;
     }
-    
-    int totalLength = this->length();
+
+    int totalLength = m_text.length();
     int end = position + length;
     position = qBound(0, position, totalLength);
     end = qBound(0, end, totalLength);
     length = end - position;
-    
+
     return length > 0;
 }
 
-void ParagraphBlock::mergeAdjacentSpans()
+int ParagraphBlock::splitRunAt(int offset)
+{
+    if (offset >= m_text.length())
+        return m_runs.size();
+
+    int positionInRun = 0;
+    int runIndex = findSpanIndex(offset, &positionInRun);
+    if (runIndex < 0 || positionInRun <= 0)
+        return qMax(0, runIndex);
+
+    StyleRun tail = m_runs.at(runIndex);
+    tail.length -= positionInRun;
+    m_runs[runIndex].length = positionInRun;
+    m_runs.insert(runIndex + 1, tail);
+    invalidateRunStarts(runIndex + 1);
+    return runIndex + 1;
+}
+
+void ParagraphBlock::ensureRunStarts() const
 {
-    for (int i = m_spans.size() - 1; i > 0; --i) {
-        Span &prev = m_spans[i - 1];
-        Span &curr = m_spans[i];
-        if (prev.style() == curr.style()) {
-            prev.append(curr.text());
-            m_spans.removeAt(i);
+    const int count = m_runs.size();
+    if (m_runStartsDirtyFrom > count && m_runStarts.size() == count + 1)
+        return;
+
+    m_runStarts.resize(count + 1);
+    int from = qBound(0, m_runStartsDirtyFrom, count);
+    if (from == 0) {
+        m_runStarts[0] = 0;
+        from = 1;
+    }
+    for (int i = from; i <= count; ++i) {
+        m_runStarts[i] = m_runStarts.at(i - 1) + m_runs.at(i - 1).length;
+    }
+    m_runStartsDirtyFrom = count + 1;
+}
+
+void ParagraphBlock::invalidateRunStarts(int fromRun)
+{
+    m_runStartsDirtyFrom = qMin(m_runStartsDirtyFrom, qMax(0, fromRun));
+}
+
+bool ParagraphBlock::hasStyleNames(int first, int end) const
+{
+    for (int i = qMax(0, first); i < end && i < m_runs.size(); ++i) {
+        if (!m_runs.at(i).styleName.isEmpty())
+            return true;
+    }
+    return false;
+}
+
+bool ParagraphBlock::sameRunStyle(const StyleRun &a, const StyleRun &b)
+{
+    return a.styleId == b.styleId && a.styleName == b.styleName;
+}
+
+void ParagraphBlock::mergeAdjacentSpans(int first, int last)
+{
+    first = qMax(0, first);
+    if (last < 0 || last >= m_runs.size())
+        last = m_runs.size() - 1;
+
+    for (int i = last; i > first; --i) {
+        if (sameRunStyle(m_runs.at(i - 1), m_runs.at(i))) {
+            m_runs[i - 1].length += m_runs.at(i).length;
+            m_runs.remove(i);
+            invalidateRunStarts(i);
         }
     }
 }
 
-} // namespace QtWordEditor
\ No newline at end of file
+QDataStream &operator<<(QDataStream &out, const StyleRun &run)
+{
+    return out << qint32(run.length) << run.styleName << qint32(run.styleId);
+}
+
+QDataStream &operator>>(QDataStream &in, StyleRun &run)
+{
+    qint32 length = 0;
+    qint32 styleId = 0;
+    in >> length >> run.styleName >> styleId;
+    run.length = length;
+    run.styleId = styleId;
+    return in;
+}
+
+} // namespace QtWordEditor
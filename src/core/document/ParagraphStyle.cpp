@@ -1,5 +1,8 @@
 #include "core/document/ParagraphStyle.h"
 #include "core/utils/Constants.h"
+#include "core/styles/StyleRounding.h"
+#include <QHash>
+#include <QDataStream>
 #include <QDebug>
 
 namespace QtWordEditor {
@@ -159,11 +162,11 @@ void ParagraphStyle::setLineHeight(int percent)
 bool ParagraphStyle::operator==(const ParagraphStyle &other) const
 {
     return d->m_alignment == other.d->m_alignment &&
-           qFuzzyCompare(d->m_firstLineIndent, other.d->m_firstLineIndent) &&
-           qFuzzyCompare(d->m_leftIndent, other.d->m_leftIndent) &&
-           qFuzzyCompare(d->m_rightIndent, other.d->m_rightIndent) &&
-           qFuzzyCompare(d->m_spaceBefore, other.d->m_spaceBefore) &&
-           qFuzzyCompare(d->m_spaceAfter, other.d->m_spaceAfter) &&
+           styleLengthKey(d->m_firstLineIndent) == styleLengthKey(other.d->m_firstLineIndent) &&
+           styleLengthKey(d->m_leftIndent) == styleLengthKey(other.d->m_leftIndent) &&
+           styleLengthKey(d->m_rightIndent) == styleLengthKey(other.d->m_rightIndent) &&
+           styleLengthKey(d->m_spaceBefore) == styleLengthKey(other.d->m_spaceBefore) &&
+           styleLengthKey(d->m_spaceAfter) == styleLengthKey(other.d->m_spaceAfter) &&
            d->m_lineHeight == other.d->m_lineHeight;
 }
 
@@ -182,6 +185,11 @@ bool ParagraphStyle::isPropertySet(ParagraphStyleProperty property) const
     return d->m_propertySetFlags.testFlag(property);
 }
 
+ParagraphStylePropertyFlags ParagraphStyle::propertyFlags() const
+{
+    return d->m_propertySetFlags;
+}
+
 void ParagraphStyle::clearProperty(ParagraphStyleProperty property)
 {
     // 清除属性标记
@@ -248,4 +256,50 @@ ParagraphStyle ParagraphStyle::mergeWith(const ParagraphStyle &other) const
     return result;
 }
 
-} // namespace QtWordEditor
\ No newline at end of file
+size_t ParagraphStyle::hash(size_t seed) const
+{
+    return qHashMulti(seed,
+                      int(d->m_alignment),
+                      styleLengthKey(d->m_firstLineIndent),
+                      styleLengthKey(d->m_leftIndent),
+                      styleLengthKey(d->m_rightIndent),
+                      styleLengthKey(d->m_spaceBefore),
+                      styleLengthKey(d->m_spaceAfter),
+                      d->m_lineHeight,
+                      d->m_propertySetFlags.toInt());
+}
+
+QDataStream &operator<<(QDataStream &out, const ParagraphStyle &style)
+{
+    const ParagraphStyleData *data = style.d.constData();
+    return out << qint32(data->m_alignment) << double(data->m_firstLineIndent)
+               << double(data->m_leftIndent) << double(data->m_rightIndent)
+               << double(data->m_spaceBefore) << double(data->m_spaceAfter)
+               << qint32(data->m_lineHeight) << qint32(data->m_propertySetFlags.toInt());
+}
+
+QDataStream &operator>>(QDataStream &in, ParagraphStyle &style)
+{
+    ParagraphStyleData *data = style.d.data();
+    qint32 alignment = 0;
+    double firstLineIndent = 0.0;
+    double leftIndent = 0.0;
+    double rightIndent = 0.0;
+    double spaceBefore = 0.0;
+    double spaceAfter = 0.0;
+    qint32 lineHeight = 0;
+    qint32 flags = 0;
+    in >> alignment >> firstLineIndent >> leftIndent >> rightIndent
+       >> spaceBefore >> spaceAfter >> lineHeight >> flags;
+    data->m_alignment = static_cast<ParagraphAlignment>(alignment);
+    data->m_firstLineIndent = firstLineIndent;
+    data->m_leftIndent = leftIndent;
+    data->m_rightIndent = rightIndent;
+    data->m_spaceBefore = spaceBefore;
+    data->m_spaceAfter = spaceAfter;
+    data->m_lineHeight = lineHeight;
+    data->m_propertySetFlags = ParagraphStylePropertyFlags(QFlag(flags));
+    return in;
+}
+
+} // namespace QtWordEditor
@@ -113,6 +113,22 @@ Block *Section::block(int index) const
     return nullptr;
 }
 
+/**
+ * @brief Gets the index of a block within this section
+ * @param block Block to look up
+ * @return Block index, or -1 if the block is not in this section
+ *
+ * Uses the index stored in the block, which insertBlock() and removeBlock()
+ * keep exact, so the lookup is constant time.
+ */
+int Section::indexOfBlock(const Block *block) const
+{
+    if (!block)
+        return -1;
+    const int index = block->indexInSection();
+    return (index >= 0 && index < m_blocks.size() && m_blocks.at(index) == block) ? index : -1;
+}
+
 /**
  * @brief Adds a block to the end of the section
  * @param block Block to add
@@ -133,6 +149,7 @@ void Section::insertBlock(int index, Block *block)
         return;
     block->setParent(this);
     m_blocks.insert(index, block);
+    renumberBlocks(index);
     emit blockAdded(index);
 }
 
@@ -144,11 +161,26 @@ void Section::removeBlock(int index)
 {
     if (index < 0 || index >= m_blocks.size())
         return;
+    emit blockAboutToBeRemoved(index);
     Block *block = m_blocks.takeAt(index);
+    block->setIndexInSection(-1);
+    renumberBlocks(index);
     block->deleteLater();
     emit blockRemoved(index);
 }
 
+/**
+ * @brief Updates the stored section index of the blocks from a position on
+ * @param from Index of the first block whose position changed
+ *
+ * Costs the same as the list insertion or removal that shifted the blocks.
+ */
+void Section::renumberBlocks(int from)
+{
+    for (int i = from; i < m_blocks.size(); ++i)
+        m_blocks.at(i)->setIndexInSection(i);
+}
+
 /**
  * @brief Gets the number of pages in this section
  * @return Page count
@@ -182,6 +214,23 @@ void Section::addPage(Page *page)
     emit pagesChanged();
 }
 
+/**
+ * @brief Replaces a range of pages, used by incremental layout
+ * @param index Index of the first page to replace
+ * @param count Number of pages to remove (deleted)
+ * @param pages Pages inserted in their place (ownership transferred)
+ */
+void Section::replacePages(int index, int count, const QList<Page*> &pages)
+{
+    index = qBound(0, index, m_pages.size());
+    count = qBound(0, count, m_pages.size() - index);
+    for (int i = 0; i < count; ++i)
+        delete m_pages.takeAt(index);
+    for (int i = 0; i < pages.size(); ++i)
+        m_pages.insert(index + i, pages.at(i));
+    emit pagesChanged();
+}
+
 /**
  * @brief Clears all pages from the section
  */
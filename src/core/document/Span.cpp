@@ -1,5 +1,6 @@
 #include "core/document/Span.h"
 #include "core/styles/StyleManager.h"
+#include "core/styles/StylePool.h"
 #include <QDebug>
 
 namespace QtWordEditor {
@@ -16,7 +17,7 @@ public:
     SpanData(const QString &text, const CharacterStyle &style)
         : m_text(text)
         , m_styleName("")
-        , m_directStyle(style)
+        , m_directStyleId(StylePool::instance()->internCharacterStyle(style))
     {
     }
 
@@ -24,7 +25,7 @@ public:
         : QSharedData(other)
         , m_text(other.m_text)
         , m_styleName(other.m_styleName)
-        , m_directStyle(other.m_directStyle)
+        , m_directStyleId(other.m_directStyleId)
     {
     }
 
@@ -32,7 +33,7 @@ public:
 
     QString m_text;
     QString m_styleName;           // 命名样式名称
-    CharacterStyle m_directStyle;  // 直接样式（覆盖命名样式）
+    int m_directStyleId = StylePool::DefaultStyleId;  // 直接样式ID（覆盖命名样式）
 };
 
 Span::Span()
@@ -99,13 +100,13 @@ int Span::length() const
 CharacterStyle Span::style() const
 {
     // 向后兼容：返回直接样式
-    return d->m_directStyle;
+    return StylePool::instance()->characterStyle(d->m_directStyleId);
 }
 
 void Span::setStyle(const CharacterStyle &style)
 {
     // 向后兼容：设置直接样式
-    d->m_directStyle = style;
+    d->m_directStyleId = StylePool::instance()->internCharacterStyle(style);
 }
 
 QString Span::styleName() const
@@ -120,12 +121,17 @@ void Span::setStyleName(const QString &styleName)
 
 CharacterStyle Span::directStyle() const
 {
-    return d->m_directStyle;
+    return StylePool::instance()->characterStyle(d->m_directStyleId);
 }
 
 void Span::setDirectStyle(const CharacterStyle &style)
 {
-    d->m_directStyle = style;
+    d->m_directStyleId = StylePool::instance()->internCharacterStyle(style);
+}
+
+int Span::directStyleId() const
+{
+    return d->m_directStyleId;
 }
 
 CharacterStyle Span::effectiveStyle(const StyleManager *styleManager) const
@@ -140,7 +146,7 @@ CharacterStyle Span::effectiveStyle(const StyleManager *styleManager) const
     }
     
     // 2. 然后用直接样式覆盖
-    result = result.mergeWith(d->m_directStyle);
+    result = result.mergeWith(directStyle());
     
     return result;
 }
@@ -154,7 +160,7 @@ Span Span::split(int position)
     QString secondPart = d->m_text.mid(position);
     Span second(secondPart);
     second.setStyleName(d->m_styleName);
-    second.setDirectStyle(d->m_directStyle);
+    second.d->m_directStyleId = d->m_directStyleId;
     d->m_text = firstPart;
     return second;
 }
@@ -163,7 +169,7 @@ bool Span::operator==(const Span &other) const
 {
     return d->m_text == other.d->m_text && 
            d->m_styleName == other.d->m_styleName &&
-           d->m_directStyle == other.d->m_directStyle;
+           d->m_directStyleId == other.d->m_directStyleId;
 }
 
 bool Span::operator!=(const Span &other) const
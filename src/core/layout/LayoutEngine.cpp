@@ -1,28 +1,117 @@
 #include "core/layout/LayoutEngine.h"
+#include "core/layout/PageBuilder.h"
 #include "core/document/Document.h"
 #include "core/document/Section.h"
 #include "core/document/Block.h"
+#include "core/document/Page.h"
 #include "core/document/ParagraphBlock.h"
+#include "core/styles/StyleManager.h"
 #include "core/utils/FontUtils.h"
 #include <QDebug>
+#include <QAtomicInt>
+#include <QMetaObject>
+#include <algorithm>
 
 namespace QtWordEditor {
 
+namespace {
+
+// 第一批之后，每批发布的页数
+constexpr int BackgroundBatchPages = 16;
+
+// 后台分页时一次并行整形的块数
+constexpr int BackgroundShapingWindow = 256;
+
+} // namespace
+
+/**
+ * @brief 后台分页中一个块的快照
+ *
+ * 工作线程只读取快照，不访问块本身；block 指针只作为页面内容的标识。
+ */
+struct LayoutEngine::BlockSnapshot
+{
+    Block *block = nullptr;
+    int globalIndex = 0;
+    int blockId = 0;
+    quint64 contentVersion = 0;
+    quint64 styleVersion = 0;
+    quint64 styleGeneration = 0;
+    qreal height = 0.0;             ///< 块高度（需要整形的段落由工作线程填写）
+    bool needsShaping = false;      ///< 缓存未命中，需要在工作线程整形
+    ParagraphLayoutInput input;     ///< 整形输入，整形后清空
+    ParagraphLayoutPtr layout;      ///< 排版结果（缓存命中或工作线程整形得到）
+};
+
+/**
+ * @brief 一次后台分页任务：创建时的文档快照和取消标记
+ */
+struct LayoutEngine::PaginationJob
+{
+    struct SectionSnapshot {
+        int sectionIndex = 0;
+        int firstBlock = 0;                 ///< 快照中第一个块的全局索引
+        PageBreak firstBreak;               ///< 第一页的起点（可能从段落中间的某一行开始）
+        QVector<BlockSnapshot> blocks;
+    };
+
+    QAtomicInt cancelled;
+    qreal pageWidth = 0.0;
+    qreal pageHeight = 0.0;
+    qreal margin = 0.0;
+    qreal contentWidth = 0.0;
+    int priorityPages = 1;
+    int minOrphanLines = 2;
+    int minWidowLines = 2;
+    int firstPage = 0;                      ///< 第一个新页面在文档中的页序号
+    QVector<SectionSnapshot> sections;
+};
+
+/**
+ * @brief 工作线程投递回界面线程的一批结果
+ */
+struct LayoutEngine::PaginationBatch
+{
+    ~PaginationBatch() { qDeleteAll(pages); }   // 未被应用（任务已取消）的页面在这里释放
+
+    int sectionIndex = 0;
+    int firstPage = 0;
+    QList<Page*> pages;
+    QVector<PageBreak> breaks;                  ///< 与 pages 一一对应的分页点
+    QVector<BlockSnapshot> blocks;              ///< 本批新确定高度的块
+    bool sectionFinished = false;               ///< 节的最后一批，替换掉该节剩余的旧页面
+    bool finished = false;                      ///< 任务的最后一批
+};
+
 LayoutEngine::LayoutEngine(QObject *parent)
     : QObject(parent)
 {
+    m_threadPool.setMaxThreadCount(1);
 }
 
 LayoutEngine::~LayoutEngine()
 {
+    cancelBackgroundLayout();
+    m_threadPool.waitForDone();
 }
 
 void LayoutEngine::setDocument(Document *document)
 {
     if (m_document == document)
         return;
+    if (m_document)
+        disconnect(m_document, nullptr, this, nullptr);
+    cancelBackgroundLayout();
+    m_restartPending = false;
     m_document = document;
-    m_cachedHeights.clear();
+    m_paragraphLayouts.clear();
+    invalidatePageBreaks();
+    if (m_document) {
+        connect(m_document, &Document::blockAdded, this, &LayoutEngine::handleBlockAdded);
+        connect(m_document, &Document::blockRemoved, this, &LayoutEngine::handleBlockRemoved);
+        connect(m_document, &Document::sectionAdded, this, &LayoutEngine::handleSectionsChanged);
+        connect(m_document, &Document::sectionRemoved, this, &LayoutEngine::handleSectionsChanged);
+    }
 }
 
 Document *LayoutEngine::document() const
@@ -30,31 +119,679 @@ Document *LayoutEngine::document() const
     return m_document;
 }
 
+void LayoutEngine::setPageSize(qreal width, qreal height, qreal margin)
+{
+    m_pageWidth = width;
+    m_pageHeight = height;
+    m_margin = margin;
+}
+
+void LayoutEngine::getPageSize(qreal *width, qreal *height, qreal *margin) const
+{
+    if (width)
+        *width = m_pageWidth;
+    if (height)
+        *height = m_pageHeight;
+    if (margin)
+        *margin = m_margin;
+}
+
+qreal LayoutEngine::contentWidth() const
+{
+    return m_pageWidth - 2 * m_margin;
+}
+
 void LayoutEngine::layout()
 {
     if (!m_document) {
         qWarning() << "No document set for layout";
         return;
     }
-    // Simplified: just emit signal
-  //  QDebug() << "LayoutEngine::layout() called (placeholder)";
+    cancelBackgroundLayout();
+    m_restartPending = false;
+
+    const qreal maxWidth = contentWidth();
+    // 先并行整形所有缓存未命中的段落，之后的分页只读缓存
+    shapeParagraphs(maxWidth);
+
+    int pageNumber = 0;
+    int sectionStart = 0;
+    m_pageBreaks.clear();
+    for (int sectionIdx = 0; sectionIdx < m_document->sectionCount(); ++sectionIdx) {
+        Section *section = m_document->section(sectionIdx);
+        if (!section)
+            continue;
+
+        section->clearPages();
+        PageBuilder builder(m_pageWidth, m_pageHeight, m_margin);
+        builder.setWidowOrphanControl(m_minOrphanLines, m_minWidowLines);
+        m_pageBreaks.append(PageBreak{sectionStart, 0});
+        for (int i = 0; i < section->blockCount(); ++i) {
+            Block *block = section->block(i);
+            if (!block)
+                continue;
+            block->setHeight(calculateBlockHeight(block, maxWidth));
+            const ParagraphLayoutPtr lines = linesForPaging(block, maxWidth);
+            int line = 0;
+            while (!builder.addBlock(block, block->height(), lines.data(), &line)) {
+                Page *page = builder.finishPage();
+                page->setPageNumber(++pageNumber);
+                section->addPage(page);
+                m_pageBreaks.append(PageBreak{sectionStart + i, line});
+            }
+        }
+        // 每个节至少有一页（空节也显示一张空白页）
+        Page *page = builder.finishPage();
+        page->setPageNumber(++pageNumber);
+        section->addPage(page);
+        sectionStart += section->blockCount();
+    }
+    m_pageBreaksValid = true;
+
+    pruneParagraphLayouts();
     emit layoutChanged();
 }
 
-void LayoutEngine::layoutFrom(int blockIndex)
+void LayoutEngine::layoutFrom(int blockIndex, int lastChangedBlock)
 {
-    Q_UNUSED(blockIndex);
-    // Simplified
-    layout();
+    if (!m_document) {
+        qWarning() << "No document set for layout";
+        return;
+    }
+    // 后台分页尚未完成：从修改处重新开始后台分页
+    if (isBackgroundLayoutRunning()) {
+        startBackgroundLayout(m_restartPending ? qMin(m_restartFrom, blockIndex) : blockIndex);
+        return;
+    }
+    if (!m_pageBreaksValid || m_document->sectionCount() == 0) {
+        layout();
+        return;
+    }
+    lastChangedBlock = qMax(lastChangedBlock, blockIndex);
+
+    // 定位修改所在的节，以及该节的页面在文档页序中的起点
+    Section *section = nullptr;
+    int sectionIndex = 0;
+    int sectionStart = 0;
+    int firstPage = 0;
+    const int sectionCount = m_document->sectionCount();
+    for (int sectionIdx = 0; sectionIdx < sectionCount; ++sectionIdx) {
+        Section *candidate = m_document->section(sectionIdx);
+        if (blockIndex < sectionStart + candidate->blockCount() || sectionIdx == sectionCount - 1) {
+            section = candidate;
+            sectionIndex = sectionIdx;
+            break;
+        }
+        sectionStart += candidate->blockCount();
+        firstPage += candidate->pageCount();
+    }
+    const int sectionPages = section->pageCount();
+    if (sectionPages == 0 || firstPage + sectionPages > m_pageBreaks.size()) {
+        layout();
+        return;
+    }
+    const int sectionEnd = sectionStart + section->blockCount();
+
+    // 从包含修改块开头的页的前一页开始：内容变短时，该页开头的内容可能回流到前一页
+    const int startPage = qMax(0, pageContainingBlock(firstPage, sectionPages, blockIndex) - 1);
+    const PageBreak startBreak = (startPage == 0) ? PageBreak{sectionStart, 0}
+                                                  : m_pageBreaks.at(firstPage + startPage);
+
+    // 向后重新分页，直到新的分页点与旧的分页点重合
+    const qreal maxWidth = contentWidth();
+    PageBuilder builder(m_pageWidth, m_pageHeight, m_margin);
+    builder.setWidowOrphanControl(m_minOrphanLines, m_minWidowLines);
+    QList<Page*> newPages;
+    QVector<PageBreak> newBreaks;
+    newBreaks.append(startBreak);
+    int resumePage = sectionPages;  // 旧页面中从此页起保持不变
+    bool converged = false;
+    for (int global = startBreak.blockIndex; global < sectionEnd && !converged; ++global) {
+        Block *block = section->block(global - sectionStart);
+        if (!block)
+            continue;
+        block->setHeight(calculateBlockHeight(block, maxWidth));
+        const ParagraphLayoutPtr lines = linesForPaging(block, maxWidth);
+        int line = (global == startBreak.blockIndex) ? startBreak.line : 0;
+        while (!builder.addBlock(block, block->height(), lines.data(), &line)) {
+            newPages.append(builder.finishPage());
+            const PageBreak pageBreak{global, line};
+            if (global > lastChangedBlock) {
+                int oldPage = findPageBreak(pageBreak, firstPage + startPage + 1, firstPage + sectionPages);
+                if (oldPage >= 0) {
+                    resumePage = oldPage - firstPage;
+                    converged = true;
+                    break;
+                }
+            }
+            newBreaks.append(pageBreak);
+        }
+    }
+    if (!converged)
+        newPages.append(builder.finishPage());
+
+    const int oldCount = resumePage - startPage;
+
+    // 分页结果未变（例如只是在页内打字）：保留原页面对象，不通知
+    bool unchanged = (newPages.size() == oldCount);
+    for (int i = 0; unchanged && i < oldCount; ++i) {
+        unchanged = samePageContent(newPages.at(i), section->page(startPage + i));
+    }
+    if (unchanged) {
+        qDeleteAll(newPages);
+        return;
+    }
+
+    for (int i = 0; i < newPages.size(); ++i) {
+        newPages.at(i)->setPageNumber(firstPage + startPage + i + 1);
+    }
+    section->replacePages(startPage, oldCount, newPages);
+    m_pageBreaks.remove(firstPage + startPage, oldCount);
+    for (int i = 0; i < newBreaks.size(); ++i) {
+        m_pageBreaks.insert(firstPage + startPage + i, newBreaks.at(i));
+    }
+
+    // 页数变化时，只平移新页面之后的页码；之前的页面不受影响，不必遍历
+    if (newPages.size() != oldCount) {
+        int pageNumber = firstPage + startPage + newPages.size();
+        for (int sectionIdx = sectionIndex; sectionIdx < sectionCount; ++sectionIdx) {
+            Section *current = m_document->section(sectionIdx);
+            const int from = (sectionIdx == sectionIndex) ? startPage + newPages.size() : 0;
+            for (int i = from; i < current->pageCount(); ++i)
+                current->page(i)->setPageNumber(++pageNumber);
+        }
+    }
+
+    emit pagesChanged(firstPage + startPage, oldCount, newPages.size());
+}
+
+void LayoutEngine::shapeParagraphs(qreal width)
+{
+    QVector<ParagraphBlock*> paragraphs;
+    QVector<ParagraphLayoutInput> inputs;
+    for (int sectionIdx = 0; sectionIdx < m_document->sectionCount(); ++sectionIdx) {
+        Section *section = m_document->section(sectionIdx);
+        if (!section)
+            continue;
+        for (int i = 0; i < section->blockCount(); ++i) {
+            ParagraphBlock *para = qobject_cast<ParagraphBlock*>(section->block(i));
+            if (para && !findParagraphLayout(para, width)) {
+                paragraphs.append(para);
+                inputs.append(ParagraphLayout::prepare(para));
+            }
+        }
+    }
+    if (paragraphs.isEmpty())
+        return;
+
+    QVector<const ParagraphLayoutInput*> inputPtrs;
+    inputPtrs.reserve(inputs.size());
+    for (const ParagraphLayoutInput &input : inputs) {
+        inputPtrs.append(&input);
+    }
+    const QVector<ParagraphLayoutPtr> layouts = ParagraphLayout::shapeParallel(inputPtrs, width);
+
+    for (int i = 0; i < paragraphs.size(); ++i) {
+        ParagraphBlock *para = paragraphs.at(i);
+        CachedParagraphLayout entry;
+        entry.contentVersion = para->contentVersion();
+        entry.styleVersion = para->styleVersion();
+        entry.styleGeneration = styleGenerationFor(para);
+        entry.width = width;
+        entry.layout = layouts.at(i);
+        m_paragraphLayouts.insert(para->blockId(), entry);
+    }
 }
 
 qreal LayoutEngine::calculateBlockHeight(Block *block, qreal maxWidth)
 {
-    Q_UNUSED(maxWidth);
     if (!block)
         return 0.0;
-    // For now, return a fixed height
-    return 20.0;
+
+    if (ParagraphBlock *para = qobject_cast<ParagraphBlock*>(block)) {
+        return paragraphLayout(para, maxWidth)->height();
+    }
+
+    // 非段落块（图片、表格）尚无排版实现，沿用已有高度
+    return block->height() > 0.0 ? block->height() : 20.0;
+}
+
+ParagraphLayoutPtr LayoutEngine::paragraphLayout(ParagraphBlock *block)
+{
+    return paragraphLayout(block, contentWidth());
+}
+
+ParagraphLayoutPtr LayoutEngine::paragraphLayout(ParagraphBlock *block, qreal width)
+{
+    if (!block)
+        return ParagraphLayoutPtr::create();
+
+    if (const CachedParagraphLayout *cached = findParagraphLayout(block, width))
+        return cached->layout;
+
+    CachedParagraphLayout entry;
+    entry.contentVersion = block->contentVersion();
+    entry.styleVersion = block->styleVersion();
+    entry.styleGeneration = styleGenerationFor(block);
+    entry.width = width;
+    entry.layout = ParagraphLayoutPtr::create(ParagraphLayout::shape(block, width));
+    m_paragraphLayouts.insert(block->blockId(), entry);
+    return entry.layout;
+}
+
+const LayoutEngine::CachedParagraphLayout *LayoutEngine::findParagraphLayout(const ParagraphBlock *block,
+                                                                             qreal width) const
+{
+    auto it = m_paragraphLayouts.constFind(block->blockId());
+    if (it != m_paragraphLayouts.constEnd()
+        && it->contentVersion == block->contentVersion()
+        && it->styleVersion == block->styleVersion()
+        && it->styleGeneration == styleGenerationFor(block)
+        && qFuzzyCompare(it->width, width)) {
+        return &it.value();
+    }
+    return nullptr;
+}
+
+quint64 LayoutEngine::styleGenerationFor(const ParagraphBlock *block) const
+{
+    // 只有段落引用的命名样式（及其继承链）的修改影响排版，其他样式的修改不使缓存失效
+    if (!block->hasNamedStyles())
+        return 0;
+    Document *doc = block->document();
+    StyleManager *styleManager = doc ? doc->styleManager() : nullptr;
+    if (!styleManager)
+        return 0;
+    quint64 generation = 0;
+    if (!block->paragraphStyleName().isEmpty())
+        generation = styleManager->paragraphStyleGeneration(block->paragraphStyleName());
+    QString previous;
+    for (const StyleRun &run : block->styleRuns()) {
+        if (run.styleName.isEmpty() || run.styleName == previous)
+            continue;
+        previous = run.styleName;
+        generation = qMax(generation, styleManager->characterStyleGeneration(run.styleName));
+    }
+    return generation;
+}
+
+void LayoutEngine::handleBlockAdded(int globalIndex)
+{
+    for (PageBreak &pageBreak : m_pageBreaks) {
+        if (pageBreak.blockIndex >= globalIndex)
+            ++pageBreak.blockIndex;
+    }
+    if (isBackgroundLayoutRunning())
+        scheduleBackgroundRestart(globalIndex);
+}
+
+void LayoutEngine::handleBlockRemoved(int globalIndex)
+{
+    for (PageBreak &pageBreak : m_pageBreaks) {
+        if (pageBreak.blockIndex > globalIndex)
+            --pageBreak.blockIndex;
+    }
+    if (isBackgroundLayoutRunning())
+        scheduleBackgroundRestart(qMax(0, globalIndex - 1));
+}
+
+void LayoutEngine::invalidatePageBreaks()
+{
+    m_pageBreaks.clear();
+    m_pageBreaksValid = false;
+    m_laidOutPages = 0;
+}
+
+void LayoutEngine::handleSectionsChanged()
+{
+    invalidatePageBreaks();
+    if (isBackgroundLayoutRunning())
+        scheduleBackgroundRestart(0);
+}
+
+int LayoutEngine::findPageBreak(const PageBreak &pageBreak, int first, int last) const
+{
+    if (first >= last)
+        return -1;
+    auto begin = m_pageBreaks.constBegin() + first;
+    auto end = m_pageBreaks.constBegin() + last;
+    auto it = std::lower_bound(begin, end, pageBreak, [](const PageBreak &a, const PageBreak &b) {
+        return a.blockIndex < b.blockIndex || (a.blockIndex == b.blockIndex && a.line < b.line);
+    });
+    if (it != end && it->blockIndex == pageBreak.blockIndex && it->line == pageBreak.line)
+        return int(it - m_pageBreaks.constBegin());
+    return -1;
+}
+
+bool LayoutEngine::samePageContent(const Page *a, const Page *b)
+{
+    if (!a || !b || a->blockCount() != b->blockCount())
+        return false;
+    for (int i = 0; i < a->blockCount(); ++i) {
+        const BlockFragment fa = a->fragment(i);
+        const BlockFragment fb = b->fragment(i);
+        if (fa.block != fb.block || fa.startLine != fb.startLine || fa.endLine != fb.endLine)
+            return false;
+        // 拆分段落的片段偏移和高度变化时，页面的绘制范围也随之变化
+        if (!fa.isWhole() && (!qFuzzyCompare(1.0 + fa.offset, 1.0 + fb.offset)
+                              || !qFuzzyCompare(1.0 + fa.textHeight, 1.0 + fb.textHeight)))
+            return false;
+    }
+    return true;
+}
+
+int LayoutEngine::pageContainingBlock(int firstPage, int sectionPages, int blockIndex) const
+{
+    // 第一个不早于该块开头的分页点；它不恰好是块开头时，块从前一页开始
+    auto begin = m_pageBreaks.constBegin() + firstPage;
+    auto end = begin + sectionPages;
+    auto found = std::lower_bound(begin, end, blockIndex,
+                                  [](const PageBreak &pageBreak, int value) { return pageBreak.blockIndex < value; });
+    int page = int(found - begin);
+    if (found == end || found->blockIndex != blockIndex || found->line != 0)
+        --page;
+    return qBound(0, page, sectionPages - 1);
+}
+
+ParagraphLayoutPtr LayoutEngine::linesForPaging(Block *block, qreal width)
+{
+    ParagraphBlock *para = qobject_cast<ParagraphBlock*>(block);
+    return para ? paragraphLayout(para, width) : ParagraphLayoutPtr();
+}
+
+void LayoutEngine::setWidowOrphanControl(int minOrphanLines, int minWidowLines)
+{
+    m_minOrphanLines = qMax(1, minOrphanLines);
+    m_minWidowLines = qMax(1, minWidowLines);
+}
+
+void LayoutEngine::pruneParagraphLayouts()
+{
+    if (!m_document || m_paragraphLayouts.size() <= m_document->blockCount())
+        return;
+    for (auto it = m_paragraphLayouts.begin(); it != m_paragraphLayouts.end();) {
+        if (!m_document->blockById(it.key()))
+            it = m_paragraphLayouts.erase(it);
+        else
+            ++it;
+    }
+}
+
+void LayoutEngine::startBackgroundLayout(int fromBlock)
+{
+    if (!m_document) {
+        qWarning() << "No document set for layout";
+        return;
+    }
+    cancelBackgroundLayout();
+    m_restartPending = false;
+
+    const int sectionCount = m_document->sectionCount();
+    int totalPages = 0;
+    for (int i = 0; i < sectionCount; ++i) {
+        totalPages += m_document->section(i)->pageCount();
+    }
+
+    // 上一个任务被打断时，已替换到的页面之后还是旧的分页结果，只能从已重新分页的部分继续
+    if (!m_pageBreaksValid && fromBlock > 0) {
+        fromBlock = (m_laidOutPages > 0 && m_laidOutPages <= m_pageBreaks.size())
+                        ? qMin(fromBlock, m_pageBreaks.at(m_laidOutPages - 1).blockIndex)
+                        : 0;
+    }
+
+    // 定位起始节和起始页。已有页面的分页点表不完整时从头开始
+    int sectionIdx = 0;
+    int sectionStart = 0;
+    int firstPage = 0;
+    int startPage = 0;
+    PageBreak startBreak{0, 0};
+    if (fromBlock > 0 && totalPages > 0 && m_pageBreaks.size() == totalPages) {
+        for (; sectionIdx < sectionCount - 1; ++sectionIdx) {
+            Section *candidate = m_document->section(sectionIdx);
+            if (fromBlock < sectionStart + candidate->blockCount())
+                break;
+            sectionStart += candidate->blockCount();
+            firstPage += candidate->pageCount();
+        }
+        const int sectionPages = m_document->section(sectionIdx)->pageCount();
+        if (sectionPages > 0) {
+            // 与 layoutFrom() 相同，从包含该块开头的页的前一页开始
+            startPage = qMax(0, pageContainingBlock(firstPage, sectionPages, fromBlock) - 1);
+        }
+        startBreak = (startPage == 0) ? PageBreak{sectionStart, 0} : m_pageBreaks.at(firstPage + startPage);
+    }
+
+    // 起始页及之后的页面保留显示，后台任务的结果到达时原位替换
+    m_pageBreaksValid = false;
+    m_laidOutPages = firstPage + startPage;
+
+    // 在界面线程拍快照：样式解析和块访问都不是线程安全的
+    const qreal width = contentWidth();
+    auto job = QSharedPointer<PaginationJob>::create();
+    job->pageWidth = m_pageWidth;
+    job->pageHeight = m_pageHeight;
+    job->margin = m_margin;
+    job->contentWidth = width;
+    job->priorityPages = m_priorityPageCount;
+    job->minOrphanLines = m_minOrphanLines;
+    job->minWidowLines = m_minWidowLines;
+    job->firstPage = firstPage + startPage;
+    int globalStart = sectionStart;
+    for (int i = sectionIdx; i < sectionCount; ++i) {
+        Section *section = m_document->section(i);
+        PaginationJob::SectionSnapshot sectionSnapshot;
+        sectionSnapshot.sectionIndex = i;
+        sectionSnapshot.firstBreak = (i == sectionIdx) ? startBreak : PageBreak{globalStart, 0};
+        sectionSnapshot.firstBlock = sectionSnapshot.firstBreak.blockIndex;
+        sectionSnapshot.blocks.reserve(globalStart + section->blockCount() - sectionSnapshot.firstBlock);
+        for (int global = sectionSnapshot.firstBlock; global < globalStart + section->blockCount(); ++global) {
+            Block *block = section->block(global - globalStart);
+            if (block)
+                sectionSnapshot.blocks.append(snapshotBlock(block, global, width));
+        }
+        job->sections.append(sectionSnapshot);
+        globalStart += section->blockCount();
+    }
+
+    m_job = job;
+    m_threadPool.start([this, job]() { paginate(this, job); });
+}
+
+void LayoutEngine::cancelBackgroundLayout()
+{
+    if (!m_job)
+        return;
+    m_job->cancelled.storeRelaxed(1);
+    m_job.reset();
+}
+
+bool LayoutEngine::isBackgroundLayoutRunning() const
+{
+    return !m_job.isNull() || m_restartPending;
+}
+
+void LayoutEngine::setPriorityPageCount(int count)
+{
+    m_priorityPageCount = qMax(1, count);
+}
+
+int LayoutEngine::priorityPageCount() const
+{
+    return m_priorityPageCount;
+}
+
+LayoutEngine::BlockSnapshot LayoutEngine::snapshotBlock(Block *block, int globalIndex, qreal width) const
+{
+    BlockSnapshot snapshot;
+    snapshot.block = block;
+    snapshot.globalIndex = globalIndex;
+
+    ParagraphBlock *para = qobject_cast<ParagraphBlock*>(block);
+    if (!para) {
+        snapshot.height = block->height() > 0.0 ? block->height() : 20.0;
+        return snapshot;
+    }
+
+    snapshot.blockId = para->blockId();
+    snapshot.contentVersion = para->contentVersion();
+    snapshot.styleVersion = para->styleVersion();
+    snapshot.styleGeneration = styleGenerationFor(para);
+    if (const CachedParagraphLayout *cached = findParagraphLayout(para, width)) {
+        snapshot.layout = cached->layout;
+        snapshot.height = cached->layout->height();
+    } else {
+        snapshot.needsShaping = true;
+        snapshot.input = ParagraphLayout::prepare(para);
+    }
+    return snapshot;
+}
+
+void LayoutEngine::paginate(LayoutEngine *engine, QSharedPointer<PaginationJob> job)
+{
+    auto batch = QSharedPointer<PaginationBatch>::create();
+    int pageIndex = job->firstPage;
+    int batchLimit = job->priorityPages;
+
+    // 投递当前批次并开始新的一批；引擎析构前会等待本线程结束
+    auto publish = [&](int sectionIndex) {
+        QMetaObject::invokeMethod(engine, [engine, job, batch]() {
+            engine->applyBatch(job, batch);
+        }, Qt::QueuedConnection);
+        batch = QSharedPointer<PaginationBatch>::create();
+        batch->sectionIndex = sectionIndex;
+        batch->firstPage = pageIndex;
+        batchLimit = BackgroundBatchPages;
+    };
+
+    batch->firstPage = pageIndex;
+    for (PaginationJob::SectionSnapshot &section : job->sections) {
+        batch->sectionIndex = section.sectionIndex;
+        PageBuilder builder(job->pageWidth, job->pageHeight, job->margin);
+        builder.setWidowOrphanControl(job->minOrphanLines, job->minWidowLines);
+        PageBreak currentBreak = section.firstBreak;
+
+        auto finishPage = [&]() {
+            Page *page = builder.finishPage();
+            page->setPageNumber(++pageIndex);
+            batch->pages.append(page);
+            batch->breaks.append(currentBreak);
+        };
+
+        for (int i = 0; i < section.blocks.size(); ++i) {
+            if (job->cancelled.loadRelaxed())
+                return;
+            // 按窗口并行整形，窗口足够小，第一批页面不必等待整节整形完成
+            if (i % BackgroundShapingWindow == 0)
+                shapeSnapshots(section.blocks, i, qMin(i + BackgroundShapingWindow, int(section.blocks.size())),
+                               job->contentWidth);
+            const BlockSnapshot &snapshot = section.blocks.at(i);
+            // 块高度随包含它的页面之前（或同一批）发布
+            batch->blocks.append(snapshot);
+
+            int line = (snapshot.globalIndex == section.firstBreak.blockIndex) ? section.firstBreak.line : 0;
+            while (!builder.addBlock(snapshot.block, snapshot.height, snapshot.layout.data(), &line)) {
+                finishPage();
+                currentBreak = PageBreak{snapshot.globalIndex, line};
+                if (batch->pages.size() >= batchLimit)
+                    publish(section.sectionIndex);
+            }
+        }
+        // 每个节至少有一页（空节也显示一张空白页）
+        finishPage();
+        // 节的页面按节发布，下一节的页面不能与本节混在同一批中
+        batch->sectionFinished = true;
+        publish(section.sectionIndex);
+    }
+
+    batch->finished = true;
+    publish(batch->sectionIndex);
+}
+
+void LayoutEngine::shapeSnapshots(QVector<BlockSnapshot> &snapshots, int first, int last, qreal width)
+{
+    QVector<const ParagraphLayoutInput*> inputs;
+    QVector<int> indexes;
+    for (int i = first; i < last; ++i) {
+        if (snapshots.at(i).needsShaping) {
+            inputs.append(&snapshots.at(i).input);
+            indexes.append(i);
+        }
+    }
+    if (inputs.isEmpty())
+        return;
+
+    const QVector<ParagraphLayoutPtr> layouts = ParagraphLayout::shapeParallel(inputs, width);
+    for (int i = 0; i < indexes.size(); ++i) {
+        BlockSnapshot &snapshot = snapshots[indexes.at(i)];
+        snapshot.layout = layouts.at(i);
+        snapshot.height = snapshot.layout->height();
+        snapshot.input = ParagraphLayoutInput();
+    }
+}
+
+void LayoutEngine::applyBatch(const QSharedPointer<PaginationJob> &job, const QSharedPointer<PaginationBatch> &batch)
+{
+    // 任务已被取消或替换：丢弃结果，未应用的页面由批次析构释放
+    if (job != m_job || !m_document)
+        return;
+
+    for (const BlockSnapshot &snapshot : batch->blocks) {
+        snapshot.block->setHeight(snapshot.height);
+        if (snapshot.needsShaping) {
+            CachedParagraphLayout entry;
+            entry.contentVersion = snapshot.contentVersion;
+            entry.styleVersion = snapshot.styleVersion;
+            entry.styleGeneration = snapshot.styleGeneration;
+            entry.width = job->contentWidth;
+            entry.layout = snapshot.layout;
+            m_paragraphLayouts.insert(snapshot.blockId, entry);
+        }
+    }
+
+    const int pageCount = batch->pages.size();
+    if (pageCount > 0) {
+        Section *section = m_document->section(batch->sectionIndex);
+        int sectionFirstPage = 0;
+        for (int i = 0; i < batch->sectionIndex; ++i) {
+            sectionFirstPage += m_document->section(i)->pageCount();
+        }
+        // 新页面原位替换同样数量的旧页面，节的最后一批替换掉剩余的全部旧页面
+        const int local = batch->firstPage - sectionFirstPage;
+        const int oldPages = qMax(0, section->pageCount() - local);
+        const int replaced = batch->sectionFinished ? oldPages : qMin(pageCount, oldPages);
+        section->replacePages(local, replaced, batch->pages);
+        batch->pages.clear();
+        m_pageBreaks.remove(batch->firstPage, replaced);
+        for (int i = 0; i < batch->breaks.size(); ++i) {
+            m_pageBreaks.insert(batch->firstPage + i, batch->breaks.at(i));
+        }
+        m_laidOutPages = batch->firstPage + pageCount;
+        if (replaced > 0)
+            emit pagesChanged(batch->firstPage, replaced, pageCount);
+        else
+            emit pagesAppended(batch->firstPage, pageCount);
+    }
+
+    if (batch->finished) {
+        m_job.reset();
+        m_pageBreaksValid = true;
+        pruneParagraphLayouts();
+        emit backgroundLayoutFinished();
+    }
+}
+
+void LayoutEngine::scheduleBackgroundRestart(int blockIndex)
+{
+    cancelBackgroundLayout();
+    m_restartFrom = m_restartPending ? qMin(m_restartFrom, blockIndex) : blockIndex;
+    if (m_restartPending)
+        return;
+    m_restartPending = true;
+    // 结构修改的信号在修改完成前发出，等修改完成后再拍快照
+    QMetaObject::invokeMethod(this, [this]() {
+        if (m_restartPending)
+            startBackgroundLayout(m_restartFrom);
+    }, Qt::QueuedConnection);
 }
 
-} // namespace QtWordEditor
\ No newline at end of file
+} // namespace QtWordEditor
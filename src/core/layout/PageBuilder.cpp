@@ -1,4 +1,5 @@
 #include "core/layout/PageBuilder.h"
+#include "core/layout/ParagraphLayout.h"
 #include "core/document/Block.h"
 #include "core/document/Page.h"
 #include <QDebug>
@@ -12,6 +13,8 @@ PageBuilder::PageBuilder(qreal pageWidth, qreal pageHeight, qreal margin)
     , m_contentWidth(pageWidth - 2 * margin)
     , m_contentHeight(pageHeight - 2 * margin)
     , m_currentY(0)
+    , m_minOrphanLines(2)
+    , m_minWidowLines(2)
 {
 }
 
@@ -23,31 +26,119 @@ bool PageBuilder::tryAddBlock(Block *block)
 {
     if (!block)
         return false;
-    // Simplified: always add block, assume it fits
-    m_currentPageBlocks.append(block);
-    // Update current Y (placeholder)
-    m_currentY += block->height();
+    return tryAddBlock(block, block->height());
+}
+
+bool PageBuilder::tryAddBlock(Block *block, qreal height)
+{
+    if (!block)
+        return false;
+    // A block that does not fit goes to the next page, unless the page is
+    // still empty (an oversized block must land somewhere).
+    if (!m_currentPageFragments.isEmpty() && m_currentY + height > m_contentHeight)
+        return false;
+    BlockFragment fragment;
+    fragment.block = block;
+    fragment.textHeight = height;
+    fragment.height = height;
+    m_currentPageFragments.append(fragment);
+    m_currentY += height;
     return true;
 }
 
+bool PageBuilder::addBlock(Block *block, qreal height, const ParagraphLayout *layout, int *line)
+{
+    if (!block || !line)
+        return true;
+    const int lineCount = layout ? layout->lineCount() : 0;
+    if (lineCount == 0) {
+        *line = 0;
+        return tryAddBlock(block, height);
+    }
+
+    const QVector<LineBox> &lines = layout->lines();
+    const int start = qBound(0, *line, lineCount - 1);
+    const bool pageEmpty = m_currentPageFragments.isEmpty();
+    const qreal available = m_contentHeight - m_currentY;
+    const qreal spaceBefore = (start == 0) ? layout->spaceBefore() : 0.0;
+    const qreal top = lines.at(start).y - layout->spaceBefore();
+
+    BlockFragment fragment;
+    fragment.block = block;
+    fragment.startLine = start;
+    fragment.offset = top;
+
+    // The rest of the paragraph fits; the space after may run into the bottom margin
+    const qreal restText = layout->textHeight() - top;
+    if (spaceBefore + restText <= available) {
+        fragment.textHeight = restText;
+        fragment.height = spaceBefore + restText + layout->spaceAfter();
+        m_currentPageFragments.append(fragment);
+        m_currentY += fragment.height;
+        *line = lineCount;
+        return true;
+    }
+
+    // Count the lines that fit, walking the cached line boxes (no re-measuring)
+    int fit = 0;
+    qreal used = spaceBefore;
+    while (start + fit < lineCount && used + lines.at(start + fit).height <= available) {
+        used += lines.at(start + fit).height;
+        ++fit;
+    }
+
+    // Widow/orphan control: leave enough lines for the next page, and do not
+    // start a paragraph with too few lines at the bottom of a page
+    int allowed = qMin(fit, lineCount - start - m_minWidowLines);
+    if (start == 0 && allowed < m_minOrphanLines)
+        allowed = 0;
+    if (allowed <= 0) {
+        if (!pageEmpty)
+            return false;
+        // An empty page must take something: drop the limits, and place at
+        // least one line even if it is taller than the page
+        allowed = qMax(1, fit);
+    }
+
+    const int end = start + allowed;
+    const LineBox &last = lines.at(end - 1);
+    fragment.textHeight = last.y + last.height - lines.at(start).y;
+    fragment.height = spaceBefore + fragment.textHeight;
+    if (end < lineCount) {
+        fragment.endLine = end;
+    } else {
+        fragment.height += layout->spaceAfter();
+    }
+    m_currentPageFragments.append(fragment);
+    m_currentY += fragment.height;
+    *line = end;
+    return end >= lineCount;
+}
+
+void PageBuilder::setWidowOrphanControl(int minOrphanLines, int minWidowLines)
+{
+    m_minOrphanLines = qMax(1, minOrphanLines);
+    m_minWidowLines = qMax(1, minWidowLines);
+}
+
 Page *PageBuilder::finishPage()
 {
     // Create a page with default rect
     QRectF pageRect(0, 0, m_pageWidth, m_pageHeight);
     QRectF contentRect(m_margin, m_margin, m_contentWidth, m_contentHeight);
     Page *page = new Page(0, pageRect, contentRect);
-    for (Block *block : m_currentPageBlocks) {
-        page->addBlock(block);
+    for (const BlockFragment &fragment : m_currentPageFragments) {
+        page->addFragment(fragment);
     }
-    m_currentPageBlocks.clear();
+    m_currentPageFragments.clear();
     m_currentY = 0;
     return page;
 }
 
 void PageBuilder::reset()
 {
-    m_currentPageBlocks.clear();
+    m_currentPageFragments.clear();
     m_currentY = 0;
 }
 
-} // namespace QtWordEditor
\ No newline at end of file
+} // namespace QtWordEditor
@@ -0,0 +1,304 @@
+#include "core/layout/ParagraphLayout.h"
+#include "core/document/ParagraphBlock.h"
+#include "core/document/ParagraphStyle.h"
+#include "core/document/CharacterStyle.h"
+#include <QTextLayout>
+#include <QTextOption>
+#include <QTextCharFormat>
+#include <QThreadPool>
+#include <QSemaphore>
+#include <QAtomicInt>
+#include <QPainter>
+#include <algorithm>
+
+namespace QtWordEditor {
+
+namespace {
+
+// 每个线程至少分到的段落数，少于此数时并行的调度开销大于收益
+constexpr int MinParagraphsPerThread = 8;
+
+} // namespace
+
+ParagraphLayout::ParagraphLayout()
+{
+}
+
+Qt::Alignment ParagraphLayout::qtAlignment(ParagraphAlignment alignment)
+{
+    switch (alignment) {
+        case ParagraphAlignment::AlignCenter:
+            return Qt::AlignHCenter;
+        case ParagraphAlignment::AlignRight:
+            return Qt::AlignRight;
+        case ParagraphAlignment::AlignJustify:
+        case ParagraphAlignment::AlignDistributed:
+            return Qt::AlignJustify;
+        case ParagraphAlignment::AlignLeft:
+        default:
+            return Qt::AlignLeft;
+    }
+}
+
+QTextCharFormat ParagraphLayout::charFormat(const CharacterStyle &style)
+{
+    QTextCharFormat format;
+    format.setFont(style.font());
+    format.setForeground(style.textColor());
+    if (style.backgroundColor().alpha() > 0)
+        format.setBackground(style.backgroundColor());
+    if (!qFuzzyIsNull(style.letterSpacing())) {
+        format.setFontLetterSpacingType(QFont::AbsoluteSpacing);
+        format.setFontLetterSpacing(style.letterSpacing());
+    }
+    return format;
+}
+
+ParagraphLayout ParagraphLayout::shape(const ParagraphBlock *block, qreal availableWidth)
+{
+    if (!block) {
+        ParagraphLayout result;
+        result.m_availableWidth = availableWidth;
+        return result;
+    }
+    return shape(prepare(block), availableWidth);
+}
+
+ParagraphLayoutInput ParagraphLayout::prepare(const ParagraphBlock *block)
+{
+    ParagraphLayoutInput input;
+    if (!block)
+        return input;
+
+    input.style = block->effectiveParagraphStyle();
+    input.text = block->text();
+    input.defaultFont = block->effectiveStyleAt(0).font();
+
+    // 每个样式游程对应一个格式区间，命名样式在这里解析为生效样式
+    input.formats.reserve(block->spanCount());
+    for (int i = 0; i < block->spanCount(); ++i) {
+        QTextLayout::FormatRange range;
+        range.start = block->spanStart(i);
+        range.length = block->spanStart(i + 1) - range.start;
+        range.format = charFormat(block->effectiveStyleAt(range.start));
+        input.formats.append(range);
+    }
+    return input;
+}
+
+ParagraphLayout ParagraphLayout::shape(const ParagraphLayoutInput &input, qreal availableWidth)
+{
+    ParagraphLayout result;
+    result.m_availableWidth = availableWidth;
+
+    const ParagraphStyle &style = input.style;
+    result.m_spaceBefore = style.spaceBefore();
+    result.m_spaceAfter = style.spaceAfter();
+
+    QTextLayout layout(input.text, input.defaultFont);
+    layout.setFormats(input.formats);
+    QTextOption option;
+    option.setWrapMode(QTextOption::WrapAnywhere);
+    option.setAlignment(qtAlignment(style.alignment()));
+    layout.setTextOption(option);
+
+    const qreal leftIndent = style.leftIndent();
+    const qreal rightIndent = style.rightIndent();
+    const qreal lineHeightFactor = style.lineHeight() / 100.0;
+
+    qreal y = 0.0;
+    layout.beginLayout();
+    for (;;) {
+        QTextLine line = layout.createLine();
+        if (!line.isValid())
+            break;
+
+        const bool firstLine = result.m_lines.isEmpty();
+        const qreal x = leftIndent + (firstLine ? style.firstLineIndent() : 0.0);
+        const qreal width = qMax<qreal>(1.0, availableWidth - x - rightIndent);
+        line.setLineWidth(width);
+        line.setPosition(QPointF(x, y));
+
+        LineBox box;
+        box.start = line.textStart();
+        box.length = line.textLength();
+        box.x = x;
+        box.y = result.m_spaceBefore + y;
+        box.width = width;
+        box.naturalWidth = line.naturalTextWidth();
+        box.ascent = line.ascent();
+        box.descent = line.descent();
+        box.height = line.height() * lineHeightFactor;
+        box.caretX.reserve(box.length + 1);
+        for (int offset = box.start; offset <= box.start + box.length; ++offset) {
+            box.caretX.append(line.cursorToX(offset));
+        }
+
+        y += box.height;
+        result.m_lines.append(box);
+    }
+    layout.endLayout();
+
+    // 取出每行每个格式区间的字形，平移到行框坐标，绘制时不再需要 QTextLayout
+    const QPointF glyphOffset(0.0, result.m_spaceBefore);
+    for (int i = 0; i < result.m_lines.size(); ++i) {
+        LineBox &box = result.m_lines[i];
+        const QTextLine line = layout.lineAt(i);
+        for (const QTextLayout::FormatRange &range : input.formats) {
+            const int from = qMax(range.start, box.start);
+            const int to = qMin(range.start + range.length, box.start + box.length);
+            if (from >= to)
+                continue;
+            const qreal x1 = line.cursorToX(from);
+            const qreal x2 = line.cursorToX(to);
+            QBrush background = range.format.background();
+            // 字形在本线程整形，QRawFont 不能带到绘制线程，只记录字族和字形数据
+            const QFont font = range.format.font().resolve(input.defaultFont);
+            for (const QGlyphRun &glyphRun : line.glyphRuns(from, to - from)) {
+                QVector<QPointF> positions = glyphRun.positions();
+                for (QPointF &position : positions) {
+                    position += glyphOffset;
+                }
+
+                GlyphSpan span;
+                span.font = font;
+                span.font.setFamilies(QStringList(glyphRun.rawFont().familyName()));
+                span.fontKey = span.font.key();
+                span.glyphIndexes = glyphRun.glyphIndexes();
+                span.positions = positions;
+                span.flags = glyphRun.flags();
+                span.color = range.format.foreground().color();
+                // 一个格式区间可能因字体回退拆成多段字形，背景只画一次
+                if (background.style() != Qt::NoBrush) {
+                    span.background = background.color();
+                    background = QBrush();
+                }
+                span.x = qMin(x1, x2);
+                span.width = qAbs(x2 - x1);
+                box.glyphs.append(span);
+            }
+        }
+    }
+
+    result.m_textHeight = y;
+    return result;
+}
+
+QVector<ParagraphLayoutPtr> ParagraphLayout::shapeParallel(const QVector<const ParagraphLayoutInput*> &inputs,
+                                                           qreal availableWidth)
+{
+    QVector<ParagraphLayoutPtr> results(inputs.size());
+    ParagraphLayoutPtr *out = results.data();
+    const int count = inputs.size();
+    QAtomicInt next(0);
+    auto work = [&]() {
+        for (int i = next.fetchAndAddRelaxed(1); i < count; i = next.fetchAndAddRelaxed(1)) {
+            out[i] = ParagraphLayoutPtr::create(shape(*inputs.at(i), availableWidth));
+        }
+    };
+
+    // 调用线程本身算一个，只等待实际启动了的辅助线程
+    QThreadPool *pool = QThreadPool::globalInstance();
+    const int helpers = qMin(pool->maxThreadCount(), count / MinParagraphsPerThread) - 1;
+    QSemaphore finished;
+    int started = 0;
+    for (int i = 0; i < helpers; ++i) {
+        if (!pool->tryStart([&]() { work(); finished.release(); }))
+            break;
+        ++started;
+    }
+    work();
+    finished.acquire(started);
+    return results;
+}
+
+void ParagraphLayout::draw(QPainter *painter, int firstLine, int lastLine, const QRectF &exposed,
+                           GlyphFontCache *fonts) const
+{
+    GlyphFontCache localFonts;
+    if (!fonts)
+        fonts = &localFonts;
+
+    firstLine = qMax(0, firstLine);
+    lastLine = qMin(lastLine, m_lines.size());
+    QGlyphRun glyphRun;
+    for (int i = firstLine; i < lastLine; ++i) {
+        const LineBox &line = m_lines.at(i);
+        if (line.y + line.height < exposed.top() || line.y > exposed.bottom())
+            continue;
+        for (const GlyphSpan &span : line.glyphs) {
+            if (span.background.isValid())
+                painter->fillRect(QRectF(span.x, line.y, span.width, line.height), span.background);
+        }
+        for (const GlyphSpan &span : line.glyphs) {
+            const QRawFont rawFont = fonts->rawFont(span);
+            if (!rawFont.isValid())
+                continue;
+            glyphRun.setRawFont(rawFont);
+            glyphRun.setGlyphIndexes(span.glyphIndexes);
+            glyphRun.setPositions(span.positions);
+            glyphRun.setFlags(span.flags);
+            painter->setPen(span.color);
+            painter->drawGlyphRun(QPointF(0, 0), glyphRun);
+        }
+    }
+}
+
+QRawFont GlyphFontCache::rawFont(const GlyphSpan &span)
+{
+    auto it = m_fonts.constFind(span.fontKey);
+    if (it == m_fonts.constEnd())
+        it = m_fonts.insert(span.fontKey, QRawFont::fromFont(span.font));
+    return it.value();
+}
+
+void GlyphFontCache::clear()
+{
+    m_fonts.clear();
+}
+
+const QVector<LineBox> &ParagraphLayout::lines() const
+{
+    return m_lines;
+}
+
+int ParagraphLayout::lineCount() const
+{
+    return m_lines.size();
+}
+
+int ParagraphLayout::lineForOffset(int offset) const
+{
+    if (m_lines.isEmpty())
+        return -1;
+    auto it = std::upper_bound(m_lines.constBegin(), m_lines.constEnd(), offset,
+                               [](int value, const LineBox &line) { return value < line.start; });
+    return qMax(0, int(it - m_lines.constBegin()) - 1);
+}
+
+qreal ParagraphLayout::availableWidth() const
+{
+    return m_availableWidth;
+}
+
+qreal ParagraphLayout::spaceBefore() const
+{
+    return m_spaceBefore;
+}
+
+qreal ParagraphLayout::spaceAfter() const
+{
+    return m_spaceAfter;
+}
+
+qreal ParagraphLayout::textHeight() const
+{
+    return m_textHeight;
+}
+
+qreal ParagraphLayout::height() const
+{
+    return m_spaceBefore + m_textHeight + m_spaceAfter;
+}
+
+} // namespace QtWordEditor
@@ -3,7 +3,6 @@
 #include "core/commands/SetCharacterStyleCommand.h"
 #include "core/commands/SetParagraphStyleCommand.h"
 #include <QDebug>
-#include <QSet>
 
 namespace QtWordEditor {
 
@@ -84,8 +83,11 @@ void StyleManager::setDocument(Document *document)
 {
     if (m_document == document)
         return;
+    if (m_document && m_document->styleManager() == this)
+        m_document->setStyleManager(nullptr);
     m_document = document;
-    // Load default styles?
+    if (m_document)
+        m_document->setStyleManager(this);
 }
 
 Document *StyleManager::document() const
@@ -99,6 +101,7 @@ void StyleManager::addCharacterStyle(const QString &name, const CharacterStyle &
     info.style = style;
     info.parentStyleName = parentStyleName;
     m_characterStyles.insert(name, info);
+    touchStyle(m_characterStyleGenerations, name);
     emit stylesChanged();
     emit characterStyleChanged(name);
 }
@@ -114,34 +117,7 @@ CharacterStyle StyleManager::characterStyle(const QString &name) const
 
 CharacterStyle StyleManager::getResolvedCharacterStyle(const QString &name) const
 {
-    CharacterStyle result;
-    QSet<QString> visited;  // 防止循环继承
-    QString currentStyleName = name;
-    
-    // 从当前样式开始，沿着继承链向上收集所有父样式
-    QList<CharacterStyle> styleChain;
-    
-    while (!currentStyleName.isEmpty() && !visited.contains(currentStyleName)) {
-        visited.insert(currentStyleName);
-        
-        auto it = m_characterStyles.find(currentStyleName);
-        if (it == m_characterStyles.end()) {
-            break;
-        }
-        
-        // 将当前样式添加到链中（最后合并时顺序：父样式在前，子样式在后）
-        styleChain.prepend(it->style);
-        
-        // 继续处理父样式
-        currentStyleName = it->parentStyleName;
-    }
-    
-    // 合并所有样式（子样式覆盖父样式）
-    for (const auto &style : styleChain) {
-        result = result.mergeWith(style);
-    }
-    
-    return result;
+    return resolveStyle(name, m_characterStyles, m_characterStyleGenerations, m_resolvedCharacterStyles);
 }
 
 bool StyleManager::hasCharacterStyle(const QString &name) const
@@ -159,6 +135,7 @@ void StyleManager::setCharacterStyleParent(const QString &styleName, const QStri
     auto it = m_characterStyles.find(styleName);
     if (it != m_characterStyles.end()) {
         it->parentStyleName = parentStyleName;
+        touchStyle(m_characterStyleGenerations, styleName);
         emit stylesChanged();
         emit characterStyleChanged(styleName);
     }
@@ -179,6 +156,7 @@ void StyleManager::addParagraphStyle(const QString &name, const ParagraphStyle &
     info.style = style;
     info.parentStyleName = parentStyleName;
     m_paragraphStyles.insert(name, info);
+    touchStyle(m_paragraphStyleGenerations, name);
     emit stylesChanged();
     emit paragraphStyleChanged(name);
 }
@@ -194,34 +172,7 @@ ParagraphStyle StyleManager::paragraphStyle(const QString &name) const
 
 ParagraphStyle StyleManager::getResolvedParagraphStyle(const QString &name) const
 {
-    ParagraphStyle result;
-    QSet<QString> visited;  // 防止循环继承
-    QString currentStyleName = name;
-    
-    // 从当前样式开始，沿着继承链向上收集所有父样式
-    QList<ParagraphStyle> styleChain;
-    
-    while (!currentStyleName.isEmpty() && !visited.contains(currentStyleName)) {
-        visited.insert(currentStyleName);
-        
-        auto it = m_paragraphStyles.find(currentStyleName);
-        if (it == m_paragraphStyles.end()) {
-            break;
-        }
-        
-        // 将当前样式添加到链中（最后合并时顺序：父样式在前，子样式在后）
-        styleChain.prepend(it->style);
-        
-        // 继续处理父样式
-        currentStyleName = it->parentStyleName;
-    }
-    
-    // 合并所有样式（子样式覆盖父样式）
-    for (const auto &style : styleChain) {
-        result = result.mergeWith(style);
-    }
-    
-    return result;
+    return resolveStyle(name, m_paragraphStyles, m_paragraphStyleGenerations, m_resolvedParagraphStyles);
 }
 
 bool StyleManager::hasParagraphStyle(const QString &name) const
@@ -239,6 +190,7 @@ void StyleManager::setParagraphStyleParent(const QString &styleName, const QStri
     auto it = m_paragraphStyles.find(styleName);
     if (it != m_paragraphStyles.end()) {
         it->parentStyleName = parentStyleName;
+        touchStyle(m_paragraphStyleGenerations, styleName);
         emit stylesChanged();
         emit paragraphStyleChanged(styleName);
     }
@@ -263,13 +215,10 @@ void StyleManager::applyCharacterStyle(const QString &styleName, int blockIndex,
     if (!m_document)
         return;
     
-    // 获取解析继承后的样式对象
-    CharacterStyle style = getResolvedCharacterStyle(styleName);
-    
-    // 创建命令并推入撤销栈
+    // 记录样式名称，渲染时再解析继承，样式修改后自动生效
     SetCharacterStyleCommand *cmd = new SetCharacterStyleCommand(
-        m_document, blockIndex, start, end, style);
-    m_document->undoStack()->push(cmd);
+        m_document, blockIndex, start, end, styleName);
+    m_document->pushCommand(cmd);
 }
 
 void StyleManager::applyParagraphStyle(const QString &styleName, const QList<int> &blockIndices)
@@ -286,13 +235,10 @@ void StyleManager::applyParagraphStyle(const QString &styleName, const QList<int
     if (blockIndices.isEmpty())
         return;
     
-    // 获取解析继承后的样式对象
-    ParagraphStyle style = getResolvedParagraphStyle(styleName);
-    
-    // 创建命令并推入撤销栈
+    // 记录样式名称，渲染时再解析继承，样式修改后自动生效
     SetParagraphStyleCommand *cmd = new SetParagraphStyleCommand(
-        m_document, blockIndices, style);
-    m_document->undoStack()->push(cmd);
+        m_document, blockIndices, styleName);
+    m_document->pushCommand(cmd);
 }
 
 void StyleManager::removeCharacterStyle(const QString &name)
@@ -301,6 +247,7 @@ void StyleManager::removeCharacterStyle(const QString &name)
         return;
     
     m_characterStyles.remove(name);
+    touchStyle(m_characterStyleGenerations, name);
     emit stylesChanged();
     emit characterStyleChanged(name);
 }
@@ -311,8 +258,143 @@ void StyleManager::removeParagraphStyle(const QString &name)
         return;
     
     m_paragraphStyles.remove(name);
+    touchStyle(m_paragraphStyleGenerations, name);
     emit stylesChanged();
     emit paragraphStyleChanged(name);
 }
 
-} // namespace QtWordEditor
\ No newline at end of file
+template <typename Style, typename Info>
+Style StyleManager::resolveStyle(const QString &name,
+                                 const QHash<QString, Info> &styles,
+                                 const QHash<QString, quint64> &generations,
+                                 ResolvedStyleCache<Style> &cache) const
+{
+    // 命中：继承链上每个名称的代数都未变化
+    auto cached = cache.constFind(name);
+    if (cached != cache.constEnd()) {
+        bool valid = true;
+        for (const auto &link : cached->chain) {
+            if (generations.value(link.first, 0) != link.second) {
+                valid = false;
+                break;
+            }
+        }
+        if (valid) {
+            ++m_cacheStats.hits;
+            return cached->style;
+        }
+    }
+    ++m_cacheStats.misses;
+
+    // 未命中：沿继承链向上收集样式，同时记录每个名称的代数
+    ResolvedStyleEntry<Style> entry;
+    QVector<const Style *> styleChain;
+    QString currentStyleName = name;
+    while (!currentStyleName.isEmpty()) {
+        // 防止循环继承（继承链通常只有几层，线性查找即可）
+        bool visited = false;
+        for (const auto &link : entry.chain) {
+            if (link.first == currentStyleName) {
+                visited = true;
+                break;
+            }
+        }
+        if (visited)
+            break;
+
+        entry.chain.append(qMakePair(currentStyleName, generations.value(currentStyleName, 0)));
+
+        auto it = styles.constFind(currentStyleName);
+        if (it == styles.constEnd()) {
+            // 记录缺失的父样式，之后添加它时条目会失效
+            break;
+        }
+        styleChain.append(&it->style);
+        currentStyleName = it->parentStyleName;
+    }
+
+    // 合并所有样式（父样式在前，子样式覆盖父样式）
+    for (int i = styleChain.size() - 1; i >= 0; --i) {
+        entry.style = entry.style.mergeWith(*styleChain.at(i));
+    }
+
+    Style result = entry.style;
+    cache.insert(name, entry);
+    return result;
+}
+
+QStringList StyleManager::dependentCharacterStyles(const QString &name) const
+{
+    return collectDependents(name, m_characterStyles);
+}
+
+QStringList StyleManager::dependentParagraphStyles(const QString &name) const
+{
+    return collectDependents(name, m_paragraphStyles);
+}
+
+template <typename Info>
+QStringList StyleManager::collectDependents(const QString &name, const QHash<QString, Info> &styles)
+{
+    // 样式数量很少，逐层扫描子样式即可
+    QStringList result;
+    result.append(name);
+    for (int i = 0; i < result.size(); ++i) {
+        const QString current = result.at(i);
+        for (auto it = styles.constBegin(); it != styles.constEnd(); ++it) {
+            if (it->parentStyleName == current && !result.contains(it.key()))
+                result.append(it.key());
+        }
+    }
+    return result;
+}
+
+void StyleManager::touchStyle(QHash<QString, quint64> &generations, const QString &name)
+{
+    generations.insert(name, ++m_generationCounter);
+}
+
+quint64 StyleManager::generation() const
+{
+    return m_generationCounter;
+}
+
+quint64 StyleManager::characterStyleGeneration(const QString &name) const
+{
+    return chainGeneration(name, m_characterStyles, m_characterStyleGenerations);
+}
+
+quint64 StyleManager::paragraphStyleGeneration(const QString &name) const
+{
+    return chainGeneration(name, m_paragraphStyles, m_paragraphStyleGenerations);
+}
+
+template <typename Info>
+quint64 StyleManager::chainGeneration(const QString &name,
+                                      const QHash<QString, Info> &styles,
+                                      const QHash<QString, quint64> &generations)
+{
+    // 代数来自同一个单调计数器，链上任一名称被修改后最大值必然变大
+    quint64 result = 0;
+    QString current = name;
+    for (int depth = 0; !current.isEmpty() && depth <= styles.size(); ++depth) {
+        result = qMax(result, generations.value(current, 0));
+        auto it = styles.constFind(current);
+        if (it == styles.constEnd())
+            break;
+        current = it->parentStyleName;
+    }
+    return result;
+}
+
+StyleCacheStats StyleManager::resolvedStyleCacheStats() const
+{
+    return m_cacheStats;
+}
+
+void StyleManager::resetResolvedStyleCacheStats()
+{
+    m_cacheStats = StyleCacheStats();
+}
+
+} // namespace QtWordEditor
@@ -0,0 +1,122 @@
+#include "core/styles/StylePool.h"
+#include <QMutexLocker>
+#include <QtAlgorithms>
+#include <QDebug>
+#include <limits>
+
+namespace QtWordEditor {
+
+StylePool *StylePool::instance()
+{
+    static StylePool pool;
+    return &pool;
+}
+
+StylePool::StylePool()
+{
+    // ID 0 预留给默认样式
+    intern(m_characterStyles, CharacterStyle());
+    intern(m_paragraphStyles, ParagraphStyle());
+}
+
+StylePool::~StylePool()
+{
+    release(m_characterStyles);
+    release(m_paragraphStyles);
+}
+
+template <typename Style>
+bool StylePool::identical(const Style &a, const Style &b)
+{
+    // operator==不比较属性设置标记，合并语义依赖标记，因此这里一并比较
+    return a.propertyFlags() == b.propertyFlags() && a == b;
+}
+
+int StylePool::chunkOf(int id, qsizetype *offset)
+{
+    // 分块k从 FirstChunkSize * (2^k - 1) 开始，所以 id / FirstChunkSize + 1 的最高位就是k
+    constexpr int FirstChunkBits = Table<CharacterStyle>::FirstChunkBits;
+    const quint32 slot = (quint32(id) >> FirstChunkBits) + 1;
+    const int chunk = 31 - qCountLeadingZeroBits(slot);
+    *offset = qsizetype(id) - ((qsizetype(1) << chunk) - 1) * (qsizetype(1) << FirstChunkBits);
+    return chunk;
+}
+
+template <typename Style>
+const Style &StylePool::entry(const Table<Style> &table, int id)
+{
+    // 读取计数的acquire保证其之前发布的分块指针和条目都已可见
+    if (id < 0 || id >= table.count.loadAcquire())
+        id = DefaultStyleId;
+    qsizetype offset = 0;
+    const int chunk = chunkOf(id, &offset);
+    return table.chunks[chunk].loadRelaxed()[offset];
+}
+
+template <typename Style>
+void StylePool::release(Table<Style> &table)
+{
+    for (QAtomicPointer<Style> &chunk : table.chunks)
+        delete[] chunk.fetchAndStoreRelaxed(nullptr);
+}
+
+template <typename Style>
+int StylePool::intern(Table<Style> &table, const Style &style)
+{
+    const size_t hash = style.hash();
+
+    QMutexLocker locker(&m_internMutex);
+    for (auto it = table.index.constFind(hash); it != table.index.constEnd() && it.key() == hash; ++it) {
+        if (identical(entry(table, it.value()), style))
+            return it.value();
+    }
+
+    const int id = table.count.loadRelaxed();
+    if (id == std::numeric_limits<int>::max())
+        qFatal("StylePool: style IDs exhausted");
+    qsizetype offset = 0;
+    const int chunkIndex = chunkOf(id, &offset);
+    Style *chunk = table.chunks[chunkIndex].loadRelaxed();
+    if (!chunk) {
+        // 新分块在计数发布前写入目录，读取方看到新计数时分块指针已可见
+        chunk = new Style[qsizetype(Table<Style>::FirstChunkSize) << chunkIndex];
+        table.chunks[chunkIndex].storeRelaxed(chunk);
+    }
+    chunk[offset] = style;
+    table.index.insert(hash, id);
+    // 条目写完后再发布，读取方看到新计数时条目已完整
+    table.count.storeRelease(id + 1);
+    return id;
+}
+
+int StylePool::internCharacterStyle(const CharacterStyle &style)
+{
+    return intern(m_characterStyles, style);
+}
+
+CharacterStyle StylePool::characterStyle(int id) const
+{
+    return entry(m_characterStyles, id);
+}
+
+int StylePool::characterStyleCount() const
+{
+    return m_characterStyles.count.loadAcquire();
+}
+
+int StylePool::internParagraphStyle(const ParagraphStyle &style)
+{
+    return intern(m_paragraphStyles, style);
+}
+
+ParagraphStyle StylePool::paragraphStyle(int id) const
+{
+    return entry(m_paragraphStyles, id);
+}
+
+int StylePool::paragraphStyleCount() const
+{
+    return m_paragraphStyles.count.loadAcquire();
+}
+
+} // namespace QtWordEditor
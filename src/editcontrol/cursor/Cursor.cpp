@@ -132,15 +132,12 @@ void Cursor::insertText(const QString &text, const CharacterStyle &style)
 {
     if (!m_document || text.isEmpty())
         return;
-    QUndoStack *stack = m_document->undoStack();
-    if (stack) {
-        InsertTextCommand *cmd = new InsertTextCommand(m_document, m_position.blockIndex,
-                                                       m_position.offset, text, style);
-        stack->push(cmd);
-        // Update cursor position after insertion
-        m_position.offset += text.length();
-        emit positionChanged(m_position);
-    }
+    InsertTextCommand *cmd = new InsertTextCommand(m_document, m_position.blockIndex,
+                                                   m_position.offset, text, style);
+    m_document->pushCommand(cmd);
+    // Update cursor position after insertion
+    m_position.offset += text.length();
+    emit positionChanged(m_position);
 }
 
 void Cursor::deletePreviousChar()
@@ -148,14 +145,11 @@ void Cursor::deletePreviousChar()
     if (!m_document || m_position.offset <= 0)
         return;
     // Remove one character before cursor
-    QUndoStack *stack = m_document->undoStack();
-    if (stack) {
-        RemoveTextCommand *cmd = new RemoveTextCommand(m_document, m_position.blockIndex,
-                                                        m_position.offset - 1, 1);
-        stack->push(cmd);
-        m_position.offset--;
-        emit positionChanged(m_position);
-    }
+    RemoveTextCommand *cmd = new RemoveTextCommand(m_document, m_position.blockIndex,
+                                                    m_position.offset - 1, 1);
+    m_document->pushCommand(cmd);
+    m_position.offset--;
+    emit positionChanged(m_position);
 }
 
 void Cursor::deleteNextChar()
@@ -165,13 +159,10 @@ void Cursor::deleteNextChar()
     Block *block = m_document->block(m_position.blockIndex);
     if (!block || m_position.offset >= block->length())
         return;
-    QUndoStack *stack = m_document->undoStack();
-    if (stack) {
-        RemoveTextCommand *cmd = new RemoveTextCommand(m_document, m_position.blockIndex,
-                                                        m_position.offset, 1);
-        stack->push(cmd);
-        // offset stays the same (character after cursor removed)
-    }
+    RemoveTextCommand *cmd = new RemoveTextCommand(m_document, m_position.blockIndex,
+                                                    m_position.offset, 1);
+    m_document->pushCommand(cmd);
+    // offset stays the same (character after cursor removed)
 }
 
 } // namespace QtWordEditor
\ No newline at end of file
@@ -4,7 +4,7 @@
 #include "core/document/Section.h"
 #include "editcontrol/selection/Selection.h"
 #include "editcontrol/cursor/Cursor.h"
-#include "core/commands/SetCharacterStyleCommand.h"
+#include "core/commands/SetCharacterStyleRangeCommand.h"
 #include "core/commands/SetParagraphStyleCommand.h"
 #include "core/styles/StyleManager.h"
 #include "core/utils/Logger.h"
@@ -47,33 +47,10 @@ void FormatController::applyCharacterStyle(const CharacterStyle &style)
     qDebug() << "    斜体:" << style.italic();
     qDebug() << "    下划线:" << style.underline();
     
-    // 遍历选择范围内的每个块
-    for (int blockIndex = range.startBlock; blockIndex <= range.endBlock; ++blockIndex) {
-        Block *block = m_document->block(blockIndex);
-        if (!block)
-            continue;
-        
-        ParagraphBlock *paraBlock = qobject_cast<ParagraphBlock*>(block);
-        if (!paraBlock)
-            continue;
-        
-        // 计算当前块的起始和结束偏移量
-        int startOffset = (blockIndex == range.startBlock) ? range.startOffset : 0;
-        int endOffset = (blockIndex == range.endBlock) ? range.endOffset : paraBlock->length();
-        
-        if (startOffset >= endOffset)
-            continue;
-        
-        qDebug() << "  处理块" << blockIndex << ": 偏移" << startOffset << "到" << endOffset;
-        
-        // 对于选择范围内的每个位置，获取原样式并合并
-        // 这里我们不再只获取起始位置，而是让 ParagraphBlock::setStyle 自己处理
-        
-        // 创建并推入命令
-        SetCharacterStyleCommand *cmd = new SetCharacterStyleCommand(
-            m_document, blockIndex, startOffset, endOffset, style);
-        m_document->undoStack()->push(cmd);
-    }
+    // 整个选择范围一个命令：一次撤销，场景和排版只收到一次批量变化通知
+    SetCharacterStyleRangeCommand *cmd = new SetCharacterStyleRangeCommand(
+        m_document, range.startBlock, range.startOffset, range.endBlock, range.endOffset, style);
+    m_document->pushCommand(cmd);
     
     qDebug() << "FormatController::applyCharacterStyle - 样式应用完成";
 }
@@ -83,9 +60,19 @@ void FormatController::applyNamedCharacterStyle(const QString &styleName)
     if (!m_styleManager || !m_styleManager->hasCharacterStyle(styleName))
         return;
     
-    // 获取解析继承后的样式
-    CharacterStyle style = m_styleManager->getResolvedCharacterStyle(styleName);
-    applyCharacterStyle(style);
+    if (!m_document || !m_selection)
+        return;
+
+    SelectionRange range = m_selection->range();
+    if (range.isEmpty())
+        return;
+
+    range.normalize();
+
+    // 游程只记录样式名称，渲染时解析继承；样式被修改后引用它的文本自动更新
+    SetCharacterStyleRangeCommand *cmd = new SetCharacterStyleRangeCommand(
+        m_document, range.startBlock, range.startOffset, range.endBlock, range.endOffset, styleName);
+    m_document->pushCommand(cmd);
 }
 
 void FormatController::setFont(const QFont &font)
@@ -173,7 +160,7 @@ CharacterStyle FormatController::getCurrentCharacterStyle() const
         return result;
     
     if (range.startOffset < paraBlock->length()) {
-        result = paraBlock->styleAt(range.startOffset);
+        result = paraBlock->effectiveStyleAt(range.startOffset);
     }
     
     return result;
@@ -213,7 +200,7 @@ void FormatController::applyParagraphStyle(const ParagraphStyle &style)
     // 这里我们先简化处理，直接应用样式
     SetParagraphStyleCommand *cmd = new SetParagraphStyleCommand(
         m_document, blockIndices, style);
-    m_document->undoStack()->push(cmd);
+    m_document->pushCommand(cmd);
 }
 
 void FormatController::applyNamedParagraphStyle(const QString &styleName)
@@ -221,9 +208,28 @@ void FormatController::applyNamedParagraphStyle(const QString &styleName)
     if (!m_styleManager || !m_styleManager->hasParagraphStyle(styleName))
         return;
     
-    // 获取解析继承后的样式
-    ParagraphStyle style = m_styleManager->getResolvedParagraphStyle(styleName);
-    applyParagraphStyle(style);
+    if (!m_document || !m_selection)
+        return;
+
+    SelectionRange range = m_selection->range();
+    if (range.isEmpty())
+        return;
+
+    range.normalize();
+
+    QList<int> blockIndices;
+    for (int blockIndex = range.startBlock; blockIndex <= range.endBlock; ++blockIndex) {
+        if (qobject_cast<ParagraphBlock*>(m_document->block(blockIndex)))
+            blockIndices.append(blockIndex);
+    }
+
+    if (blockIndices.isEmpty())
+        return;
+
+    // 段落只记录样式名称，渲染时解析继承
+    SetParagraphStyleCommand *cmd = new SetParagraphStyleCommand(
+        m_document, blockIndices, styleName);
+    m_document->pushCommand(cmd);
 }
 
 void FormatController::setAlignment(QtWordEditor::ParagraphAlignment align)
@@ -318,7 +324,7 @@ ParagraphStyle FormatController::getCurrentParagraphStyle() const
     if (!paraBlock)
         return result;
     
-    result = paraBlock->paragraphStyle();
+    result = paraBlock->effectiveParagraphStyle();
     
     return result;
 }
@@ -341,7 +347,7 @@ CharacterStyle FormatController::getStyleAtPosition(int blockIndex, int offset)
 
     // 验证偏移量的有效性
     if (offset >= 0 && offset < paraBlock->length()) {
-        result = paraBlock->styleAt(offset);
+        result = paraBlock->effectiveStyleAt(offset);
     }
 
     return result;
@@ -4,6 +4,7 @@
 #include "editcontrol/selection/Selection.h"
 #include "editcontrol/formatting/FormatController.h"
 #include "graphics/scene/DocumentScene.h"
+#include "graphics/scene/SceneUpdateScheduler.h"
 #include <QDebug>
 
 namespace QtWordEditor {
@@ -116,6 +117,9 @@ bool EditEventHandler::handleMousePress(const QPointF &scenePos)
 
   //  QDebug() << "EditEventHandler::handleMousePress at:" << scenePos;
 
+    // 命中测试需要最新的图形项，先刷新尚未处理的编辑
+    flushPendingSceneUpdates();
+
     // 获取光标位置
     CursorPosition cursorPos = m_scene->cursorPositionAt(scenePos);
 
@@ -143,6 +147,9 @@ bool EditEventHandler::handleMouseMove(const QPointF &scenePos)
 
     qDebug() << "EditEventHandler::handleMouseMove at:" << scenePos;
 
+    // 拖动选择期间可能有刚输入的编辑尚未刷新
+    flushPendingSceneUpdates();
+
     // 获取光标位置
     CursorPosition cursorPos = m_scene->cursorPositionAt(scenePos);
 
@@ -168,6 +175,14 @@ bool EditEventHandler::handleMouseMove(const QPointF &scenePos)
     return true;
 }
 
+void EditEventHandler::flushPendingSceneUpdates()
+{
+    // 没有待处理的编辑时不刷新，以免推迟调度器的下一帧
+    SceneUpdateScheduler *scheduler = m_scene->updateScheduler();
+    if (scheduler->hasPendingUpdates())
+        scheduler->flush();
+}
+
 bool EditEventHandler::handleMouseRelease(const QPointF &scenePos)
 {
     if (!m_scene || !m_cursor || !m_selection)
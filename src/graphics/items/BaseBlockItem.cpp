@@ -19,4 +19,39 @@ Block *BaseBlockItem::block() const
     return m_block;
 }
 
+qreal BaseBlockItem::spaceBefore() const
+{
+    return 0.0;
+}
+
+qreal BaseBlockItem::spaceAfter() const
+{
+    return 0.0;
+}
+
+bool BaseBlockItem::containsOffset(int offset) const
+{
+    Q_UNUSED(offset);
+    return true;
+}
+
+int BaseBlockItem::hitTest(const QPointF &pos) const
+{
+    Q_UNUSED(pos);
+    return 0;
+}
+
+QRectF BaseBlockItem::cursorRect(int offset) const
+{
+    Q_UNUSED(offset);
+    return QRectF();
+}
+
+QList<QRectF> BaseBlockItem::selectionRects(int start, int end) const
+{
+    Q_UNUSED(start);
+    Q_UNUSED(end);
+    return QList<QRectF>();
+}
+
 } // namespace QtWordEditor
\ No newline at end of file
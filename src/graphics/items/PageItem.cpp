@@ -1,16 +1,31 @@
 #include "graphics/items/PageItem.h"
 #include "core/document/Page.h"
+#include "graphics/scene/PageTileCache.h"
 #include <QBrush>
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+#include <QtMath>
 #include <QPen>
 #include <QGraphicsDropShadowEffect>
 #include <QDebug>
 
 namespace QtWordEditor {
 
+namespace {
+
+// Offset of the flat shadow drawn in tiled mode (matches the effect's offset)
+constexpr qreal ShadowOffset = 2.0;
+
+} // namespace
+
 PageItem::PageItem(Page *page, QGraphicsItem *parent)
     : QGraphicsRectItem(parent)
     , m_page(page)
+    , m_tileCache(nullptr)
+    , m_pageIndex(-1)
 {
+    // Keep pages below block items and overlays regardless of creation order
+    setZValue(-1);
     if (page) {
         setRect(page->pageRect());
         setBrush(QBrush(Qt::white));
@@ -39,4 +54,66 @@ void PageItem::updatePage()
     }
 }
 
-} // namespace QtWordEditor
\ No newline at end of file
+void PageItem::setTileCache(PageTileCache *cache, int pageIndex)
+{
+    prepareGeometryChange();
+    m_tileCache = cache;
+    m_pageIndex = pageIndex;
+    setFlag(QGraphicsItem::ItemUsesExtendedStyleOption, cache != nullptr);
+    if (cache) {
+        // The effect re-renders the page offscreen on every update, which would
+        // defeat the cache; a flat shadow is painted instead.
+        setGraphicsEffect(nullptr);
+    } else if (m_page && !graphicsEffect()) {
+        QGraphicsDropShadowEffect *shadow = new QGraphicsDropShadowEffect();
+        shadow->setBlurRadius(10);
+        shadow->setOffset(ShadowOffset, ShadowOffset);
+        setGraphicsEffect(shadow);
+    }
+}
+
+QRectF PageItem::boundingRect() const
+{
+    if (m_tileCache)
+        return rect().adjusted(0, 0, ShadowOffset, ShadowOffset);
+    return QGraphicsRectItem::boundingRect();
+}
+
+void PageItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+{
+    if (!m_tileCache) {
+        QGraphicsRectItem::paint(painter, option, widget);
+        return;
+    }
+
+    const QRectF pageRect = rect();
+    painter->fillRect(pageRect.translated(ShadowOffset, ShadowOffset), QColor(0, 0, 0, 60));
+
+    // Tiles are rasterized in device pixels for the current zoom
+    const qreal scale = QStyleOptionGraphicsItem::levelOfDetailFromTransform(painter->worldTransform())
+                        * painter->device()->devicePixelRatio();
+    const int scaleKey = PageTileCache::scaleKey(scale);
+    const qreal extent = PageTileCache::tileRect(scaleKey, 0, 0).width();
+    const QRectF exposed = option->exposedRect & pageRect;
+    if (exposed.isEmpty())
+        return;
+
+    const int firstX = qMax(0, qFloor(exposed.left() / extent));
+    const int lastX = qCeil(exposed.right() / extent);
+    const int firstY = qMax(0, qFloor(exposed.top() / extent));
+    const int lastY = qCeil(exposed.bottom() / extent);
+    for (int y = firstY; y < lastY; ++y) {
+        for (int x = firstX; x < lastX; ++x) {
+            // Tiles are rasterized off the UI thread; until one arrives the
+            // page background and greeked lines stand in for it
+            const QRectF target = PageTileCache::tileRect(scaleKey, x, y);
+            const QImage tile = m_tileCache->tile(m_pageIndex, scale, x, y);
+            if (!tile.isNull())
+                painter->drawImage(target, tile);
+            else
+                m_tileCache->drawPlaceholder(painter, m_pageIndex, target & exposed);
+        }
+    }
+}
+
+} // namespace QtWordEditor
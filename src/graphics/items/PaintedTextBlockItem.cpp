@@ -0,0 +1,176 @@
+#include "graphics/items/PaintedTextBlockItem.h"
+#include "core/document/ParagraphBlock.h"
+#include "core/layout/LayoutEngine.h"
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+#include <algorithm>
+
+namespace QtWordEditor {
+
+PaintedTextBlockItem::PaintedTextBlockItem(ParagraphBlock *block, LayoutEngine *layoutEngine,
+                                           int startLine, int endLine, QGraphicsItem *parent)
+    : BaseBlockItem(block, parent)
+    , m_layoutEngine(layoutEngine)
+    , m_startLine(startLine)
+    , m_endLine(endLine)
+{
+    setFlag(QGraphicsItem::ItemIsSelectable, false);
+    setFlag(QGraphicsItem::ItemIsFocusable, false);
+    setFlag(QGraphicsItem::ItemUsesExtendedStyleOption, true);
+    setPen(Qt::NoPen);
+
+    updateBlock();
+}
+
+PaintedTextBlockItem::~PaintedTextBlockItem()
+{
+}
+
+void PaintedTextBlockItem::setFragment(ParagraphBlock *block, int startLine, int endLine)
+{
+    m_block = block;
+    m_startLine = startLine;
+    m_endLine = endLine;
+    updateBlock();
+}
+
+void PaintedTextBlockItem::updateBlock()
+{
+    ParagraphBlock *para = qobject_cast<ParagraphBlock*>(m_block);
+    if (!para || !m_layoutEngine)
+        return;
+
+    // 通常在增量排版之后调用，此时命中缓存，不重新整形
+    m_layout = m_layoutEngine->paragraphLayout(para);
+    updateGeometry();
+    update();
+}
+
+int PaintedTextBlockItem::firstLine() const
+{
+    if (!m_layout)
+        return 0;
+    return qBound(0, m_startLine, m_layout->lineCount());
+}
+
+int PaintedTextBlockItem::lastLine() const
+{
+    if (!m_layout)
+        return 0;
+    if (m_endLine < 0)
+        return m_layout->lineCount();
+    return qBound(firstLine(), m_endLine, m_layout->lineCount());
+}
+
+qreal PaintedTextBlockItem::originY() const
+{
+    const int first = firstLine();
+    if (!m_layout || first >= m_layout->lineCount())
+        return m_layout ? m_layout->spaceBefore() : 0.0;
+    return m_layout->lines().at(first).y;
+}
+
+void PaintedTextBlockItem::updateGeometry()
+{
+    qreal height = 0.0;
+    if (m_layout) {
+        const QVector<LineBox> &lines = m_layout->lines();
+        for (int i = firstLine(); i < lastLine(); ++i) {
+            height += lines.at(i).height;
+        }
+    }
+    setRect(0, 0, m_layout ? m_layout->availableWidth() : 0.0, height);
+}
+
+void PaintedTextBlockItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+{
+    Q_UNUSED(widget);
+    if (!m_layout)
+        return;
+
+    const qreal origin = originY();
+    painter->save();
+    painter->translate(0, -origin);
+    m_layout->draw(painter, firstLine(), lastLine(), option->exposedRect.translated(0, origin), &m_fonts);
+    painter->restore();
+}
+
+qreal PaintedTextBlockItem::spaceBefore() const
+{
+    return m_layout ? m_layout->spaceBefore() : 0.0;
+}
+
+qreal PaintedTextBlockItem::spaceAfter() const
+{
+    return m_layout ? m_layout->spaceAfter() : 0.0;
+}
+
+bool PaintedTextBlockItem::containsOffset(int offset) const
+{
+    if (!m_layout)
+        return false;
+    const int line = m_layout->lineForOffset(offset);
+    return line >= firstLine() && line < lastLine();
+}
+
+int PaintedTextBlockItem::hitTest(const QPointF &pos) const
+{
+    const int first = firstLine();
+    const int last = lastLine();
+    if (!m_layout || first >= last)
+        return 0;
+
+    // 行按纵向排列，二分查找包含该 y 的行，超出范围时取最近的行
+    const QVector<LineBox> &lines = m_layout->lines();
+    const qreal y = pos.y() + originY();
+    auto lineIt = std::upper_bound(lines.constBegin() + first, lines.constBegin() + last, y,
+                                   [](qreal value, const LineBox &line) { return value < line.y + line.height; });
+    const int lineIndex = qMin(int(lineIt - lines.constBegin()), last - 1);
+
+    // 在该行的光标位置表中找最近的光标位置
+    const LineBox &line = lines.at(lineIndex);
+    if (line.caretX.isEmpty())
+        return line.start;
+    auto caretIt = std::lower_bound(line.caretX.constBegin(), line.caretX.constEnd(), pos.x());
+    int index = int(caretIt - line.caretX.constBegin());
+    if (index >= line.caretX.size()) {
+        index = line.caretX.size() - 1;
+    } else if (index > 0 && pos.x() - line.caretX.at(index - 1) < line.caretX.at(index) - pos.x()) {
+        --index;
+    }
+    return line.start + index;
+}
+
+QRectF PaintedTextBlockItem::cursorRect(int offset) const
+{
+    if (!m_layout || m_layout->lineCount() == 0)
+        return QRectF();
+
+    const LineBox &line = m_layout->lines().at(m_layout->lineForOffset(offset));
+    const int index = qBound(0, offset - line.start, line.caretX.size() - 1);
+    const qreal x = line.caretX.isEmpty() ? line.x : line.caretX.at(index);
+    return QRectF(x, line.y - originY(), 0.0, line.height);
+}
+
+QList<QRectF> PaintedTextBlockItem::selectionRects(int start, int end) const
+{
+    QList<QRectF> rects;
+    if (!m_layout)
+        return rects;
+
+    const qreal origin = originY();
+    const QVector<LineBox> &lines = m_layout->lines();
+    for (int i = firstLine(); i < lastLine(); ++i) {
+        const LineBox &line = lines.at(i);
+        const int selStart = qMax(start, line.start);
+        const int selEnd = qMin(end, line.start + line.length);
+        if (selStart >= selEnd || line.caretX.isEmpty())
+            continue;
+        const qreal x1 = line.caretX.at(selStart - line.start);
+        const qreal x2 = line.caretX.at(selEnd - line.start);
+        rects.append(QRectF(qMin(x1, x2), line.y - origin, qAbs(x2 - x1), line.height));
+    }
+    return rects;
+}
+
+} // namespace QtWordEditor
@@ -1,6 +1,8 @@
 #include "graphics/items/SelectionItem.h"
 #include <QPainter>
+#include <QStyleOptionGraphicsItem>
 #include <QDebug>
+#include <utility>
 
 namespace QtWordEditor {
 
@@ -9,51 +11,82 @@ SelectionItem::SelectionItem(QGraphicsItem *parent)
 {
     setFlag(QGraphicsItem::ItemIsSelectable, false);
     setFlag(QGraphicsItem::ItemIsFocusable, false);
+    setFlag(QGraphicsItem::ItemUsesExtendedStyleOption, true);
 }
 
 SelectionItem::~SelectionItem()
 {
 }
 
-void SelectionItem::setRects(const QList<QRectF> &rects)
+void SelectionItem::setPagePath(int pageIndex, const QPainterPath &path)
 {
-    prepareGeometryChange();
-    m_rects = rects;
-    update();
+    if (path.isEmpty()) {
+        removePage(pageIndex);
+        return;
+    }
+    const QRectF oldRect = m_paths.value(pageIndex).boundingRect();
+    if (m_paths.value(pageIndex) == path)
+        return;
+    m_paths.insert(pageIndex, path);
+    updateBounds();
+    // Only the area covered by the old and new path of this page needs repainting
+    update(oldRect.united(path.boundingRect()).adjusted(-1, -1, 1, 1));
+}
+
+void SelectionItem::removePage(int pageIndex)
+{
+    auto it = m_paths.find(pageIndex);
+    if (it == m_paths.end())
+        return;
+    const QRectF oldRect = it->boundingRect();
+    m_paths.erase(it);
+    update(oldRect.adjusted(-1, -1, 1, 1));
+    updateBounds();
 }
 
 void SelectionItem::clear()
 {
+    if (m_paths.isEmpty())
+        return;
     prepareGeometryChange();
-    m_rects.clear();
-    update();
+    m_paths.clear();
+    m_bounds = QRectF();
 }
 
-QRectF SelectionItem::boundingRect() const
+void SelectionItem::updateBounds()
 {
-    if (m_rects.isEmpty())
-        return QRectF();
     QRectF bounds;
-    for (const QRectF &rect : m_rects) {
-        bounds = bounds.united(rect);
+    for (const QPainterPath &path : std::as_const(m_paths)) {
+        bounds = bounds.united(path.boundingRect());
     }
-    return bounds;
+    // Leave room for the outline pen
+    if (!bounds.isNull())
+        bounds.adjust(-1, -1, 1, 1);
+    if (bounds != m_bounds) {
+        prepareGeometryChange();
+        m_bounds = bounds;
+    }
+}
+
+QRectF SelectionItem::boundingRect() const
+{
+    return m_bounds;
 }
 
 void SelectionItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
                           QWidget *widget)
 {
-    Q_UNUSED(option);
     Q_UNUSED(widget);
     painter->save();
     QBrush brush(QColor(0, 120, 215, 80)); // semi‑transparent blue
     QPen pen(QColor(0, 90, 180, 160), 1);
     painter->setBrush(brush);
     painter->setPen(pen);
-    for (const QRectF &rect : m_rects) {
-        painter->drawRect(rect);
+    for (const QPainterPath &path : std::as_const(m_paths)) {
+        if (path.boundingRect().intersects(option->exposedRect))
+            painter->drawPath(path);
     }
     painter->restore();
 }
 
-} // namespace QtWordEditor
\ No newline at end of file
+} // namespace QtWordEditor
@@ -2,6 +2,9 @@
 #include "core/document/ParagraphBlock.h"
 #include "core/document/ParagraphStyle.h"
 #include "core/document/CharacterStyle.h"
+#include "core/document/Document.h"
+#include "core/styles/StyleManager.h"
+#include "core/layout/ParagraphLayout.h"
 #include "core/utils/Constants.h"
 #include <QDebug>
 #include <QFont>
@@ -10,6 +13,10 @@
 #include <QTextOption>
 #include <QTextCursor>
 #include <QTextCharFormat>
+#include <QTextBlockFormat>
+#include <QTextBlock>
+#include <QAbstractTextDocumentLayout>
+#include <algorithm>
 
 namespace QtWordEditor {
 
@@ -17,6 +24,10 @@ TextBlockItem::TextBlockItem(ParagraphBlock *block, QGraphicsItem *parent)
     : BaseBlockItem(block, parent)
     , m_textItem(new QGraphicsTextItem(this))
     , m_textWidth(Constants::PAGE_WIDTH - 2 * Constants::PAGE_MARGIN)
+    , m_clipped(false)
+    , m_clipTop(0.0)
+    , m_clipHeight(0.0)
+    , m_lineTableValid(false)
 {
     setFlag(QGraphicsItem::ItemIsSelectable, false);
     setFlag(QGraphicsItem::ItemIsFocusable, false);
@@ -74,6 +85,7 @@ void TextBlockItem::setTextWidth(qreal width)
     if (m_textWidth != width) {
         m_textWidth = width;
         m_textItem->setTextWidth(width);
+        invalidateLineTable();
         updateBoundingRect();
     }
 }
@@ -86,6 +98,7 @@ qreal TextBlockItem::textWidth() const
 void TextBlockItem::setFont(const QFont &font)
 {
     m_textItem->setFont(font);
+    invalidateLineTable();
     updateBoundingRect();
 }
 
@@ -97,6 +110,10 @@ QFont TextBlockItem::font() const
 void TextBlockItem::setPlainText(const QString &text)
 {
     m_textItem->setPlainText(text);
+    // 文档内容被整体替换，下次从块数据渲染时全部重写
+    m_renderedText.clear();
+    m_renderedRuns.clear();
+    invalidateLineTable();
     updateBoundingRect();
 }
 
@@ -110,6 +127,17 @@ QRectF TextBlockItem::boundingRect() const
     return QGraphicsRectItem::boundingRect();
 }
 
+void TextBlockItem::setTextClip(qreal top, qreal height)
+{
+    m_clipped = true;
+    m_clipTop = top;
+    m_clipHeight = height;
+    // 裁剪到自身矩形，文本项上移使本页的第一行对齐到顶部
+    setFlag(QGraphicsItem::ItemClipsChildrenToShape, true);
+    applyParagraphIndent();
+    updateBoundingRect();
+}
+
 void TextBlockItem::updateGeometry()
 {
     updateBoundingRect();
@@ -123,7 +151,7 @@ void TextBlockItem::updateBoundingRect()
     
     // 如果有段落块，获取缩进值
     if (para) {
-        ParagraphStyle style = para->paragraphStyle();
+        ParagraphStyle style = para->effectiveParagraphStyle();
         leftIndent = style.leftIndent();
         rightIndent = style.rightIndent();
     }
@@ -133,7 +161,7 @@ void TextBlockItem::updateBoundingRect()
     // 整体宽度 = 左缩进 + 文本宽度 + 右缩进
     qreal totalWidth = leftIndent + textRect.width() + rightIndent;
     
-    setRect(0, 0, totalWidth, textRect.height());
+    setRect(0, 0, totalWidth, m_clipped ? m_clipHeight : textRect.height());
 }
 
 void TextBlockItem::updateBlock()
@@ -144,6 +172,7 @@ void TextBlockItem::updateBlock()
     
     applyRichTextFromBlock();
     applyParagraphIndent();  // 应用段落缩进
+    invalidateLineTable();
     updateBoundingRect();
 }
 
@@ -153,119 +182,90 @@ void TextBlockItem::applyRichTextFromBlock()
     if (!para)
         return;
     
-    qDebug() << "TextBlockItem::applyRichTextFromBlock - 开始应用，块ID:" << para->blockId();
-    qDebug() << "  spanCount:" << para->spanCount();
-    
-    // 获取段落样式
-    ParagraphStyle paraStyle = para->paragraphStyle();
-    qreal firstLineIndent = paraStyle.firstLineIndent();
-    ParagraphAlignment alignment = paraStyle.alignment();
-    
-    // 构建 HTML 字符串，给每个 Span 添加边框
-    QString html;
-    QList<QString> borderColors = {
-        "#ff6666",  // 浅红色
-        "#66ff66",  // 浅绿色
-        "#e6e89c"   // 浅蓝色
-    };
-    
-    // 添加外层 div，应用首行缩进和对齐方式
-    QString divStyleString;
-    QStringList styleList;
-    
-    // 应用首行缩进
-    if (!qFuzzyIsNull(firstLineIndent)) {
-        styleList << QString("text-indent: %1pt").arg(firstLineIndent);
-    }
-    
-    // 应用对齐方式
-    switch (alignment) {
-        case ParagraphAlignment::AlignLeft:
-            styleList << "text-align: left";
-            break;
-        case ParagraphAlignment::AlignCenter:
-            styleList << "text-align: center";
-            break;
-        case ParagraphAlignment::AlignRight:
-            styleList << "text-align: right";
-            break;
-        case ParagraphAlignment::AlignJustify:
-            styleList << "text-align: justify";
-            break;
-        case ParagraphAlignment::AlignDistributed:
-            // 分散对齐在 CSS 中使用 text-align: justify 并配合 text-justify: distribute
-            styleList << "text-align: justify";
-            styleList << "text-justify: distribute";
-            break;
+    // 命名样式在渲染时解析（命名样式 + 直接样式），每个样式游程一个字符格式
+    const QString text = para->text();
+    QVector<RenderedRun> runs;
+    runs.reserve(para->spanCount());
+    for (int i = 0; i < para->spanCount(); ++i) {
+        const int start = para->spanStart(i);
+        const int length = para->spanStart(i + 1) - start;
+        if (length > 0)
+            runs.append(RenderedRun{length, ParagraphLayout::charFormat(para->effectiveStyleAt(start))});
     }
     
-    divStyleString = styleList.join("; ");
-    html += QString("<div style=\"%1\">").arg(divStyleString);
-    
-    for (int i = 0; i < para->spanCount(); ++i) {
-        Span span = para->span(i);
-        CharacterStyle style = span.style();
-        
-        qDebug() << "  处理 span " << i << ": text=[" << span.text() << "], 加粗:" << style.bold();
-        
-        QString escapedText = span.text().toHtmlEscaped();
-        QString color = borderColors[i % borderColors.size()];
-        
-        // 构建带边框的 span，同时添加字体和字号样式
-        QString styleString = QString("border: 2px solid %1; background-color: %1; padding: 0px 2px;").arg(color);
-        
-        // 添加字体族
-        if (!style.fontFamily().isEmpty()) {
-            styleString += QString(" font-family: '%1';").arg(style.fontFamily());
-        }
-        
-        // 添加字号
-        if (style.fontSize() > 0) {
-            styleString += QString(" font-size: %1pt;").arg(style.fontSize());
-        }
-        
-        html += QString("<span style=\"%1\">").arg(styleString);
-        
-        // 添加粗体标记
-        if (style.bold()) {
-            html += "<b>";
+    // 找出与上次渲染相比文本或格式变化的字符范围 [prefix, 长度 - suffix)
+    const QVector<int> oldRunOf = runIndexes(m_renderedRuns);
+    const QVector<int> newRunOf = runIndexes(runs);
+    const int oldLength = m_renderedText.size();
+    const int newLength = text.size();
+    int comparedOld = -1;
+    int comparedNew = -1;
+    bool sameFormat = false;
+    auto sameAt = [&](int oldPos, int newPos) {
+        if (m_renderedText.at(oldPos) != text.at(newPos))
+            return false;
+        // 同一对游程只比较一次格式
+        if (oldRunOf.at(oldPos) != comparedOld || newRunOf.at(newPos) != comparedNew) {
+            comparedOld = oldRunOf.at(oldPos);
+            comparedNew = newRunOf.at(newPos);
+            sameFormat = m_renderedRuns.at(comparedOld).format == runs.at(comparedNew).format;
         }
-        
-        // 添加斜体标记
-        if (style.italic()) {
-            html += "<i>";
-        }
-        
-        // 添加下划线标记
-        if (style.underline()) {
-            html += "<u>";
-        }
-        
-        html += escapedText;
-        
-        // 关闭标记
-        if (style.underline()) {
-            html += "</u>";
-        }
-        if (style.italic()) {
-            html += "</i>";
+        return sameFormat;
+    };
+    const int common = qMin(oldLength, newLength);
+    int prefix = 0;
+    while (prefix < common && sameAt(prefix, prefix))
+        ++prefix;
+    int suffix = 0;
+    while (suffix < common - prefix && sameAt(oldLength - 1 - suffix, newLength - 1 - suffix))
+        ++suffix;
+    
+    // 复用已有的文档，只替换变化的范围
+    QTextDocument *doc = m_textItem->document();
+    QTextCursor cursor(doc);
+    cursor.beginEditBlock();
+    // 没有渲染记录时（首次渲染或 setPlainText() 之后）文档中可能还有其他文本，整体替换
+    const bool replaceAll = m_renderedText.isEmpty() && !doc->isEmpty();
+    if (replaceAll || prefix < oldLength - suffix || prefix < newLength - suffix) {
+        if (replaceAll) {
+            cursor.select(QTextCursor::Document);
+        } else {
+            cursor.setPosition(prefix);
+            cursor.setPosition(oldLength - suffix, QTextCursor::KeepAnchor);
         }
-        if (style.bold()) {
-            html += "</b>";
+        cursor.removeSelectedText();
+        int runStart = 0;
+        for (const RenderedRun &run : runs) {
+            const int from = qMax(runStart, prefix);
+            const int to = qMin(runStart + run.length, newLength - suffix);
+            if (from < to)
+                cursor.insertText(text.mid(from, to - from), run.format);
+            runStart += run.length;
         }
-        
-        html += "</span>";
     }
     
-    // 关闭外层 div
-    html += "</div>";
-    
-    qDebug() << "  生成的 HTML:" << html;
-    
-    // 使用 HTML 设置文本
-    m_textItem->setHtml(html);
+    // 段落格式：首行缩进和对齐方式
+    const ParagraphStyle paraStyle = para->effectiveParagraphStyle();
+    QTextBlockFormat blockFormat;
+    blockFormat.setTextIndent(paraStyle.firstLineIndent());
+    blockFormat.setAlignment(ParagraphLayout::qtAlignment(paraStyle.alignment()));
+    if (blockFormat != cursor.blockFormat()) {
+        cursor.select(QTextCursor::Document);
+        cursor.setBlockFormat(blockFormat);
+    }
+    cursor.endEditBlock();
     
-    qDebug() << "TextBlockItem::applyRichTextFromBlock - 完成";
+    m_renderedText = text;
+    m_renderedRuns = runs;
+}
+
+QVector<int> TextBlockItem::runIndexes(const QVector<RenderedRun> &runs)
+{
+    QVector<int> indexes;
+    for (int i = 0; i < runs.size(); ++i) {
+        indexes.insert(indexes.size(), runs.at(i).length, i);
+    }
+    return indexes;
 }
 
 void TextBlockItem::applyParagraphIndent()
@@ -276,7 +276,7 @@ void TextBlockItem::applyParagraphIndent()
     }
     
     // 获取段落样式中的缩进值
-    ParagraphStyle style = para->paragraphStyle();
+    ParagraphStyle style = para->effectiveParagraphStyle();
     qreal leftIndent = style.leftIndent();
     qreal rightIndent = style.rightIndent();
     
@@ -291,8 +291,126 @@ void TextBlockItem::applyParagraphIndent()
     // 2. 设置文本宽度
     m_textItem->setTextWidth(availableWidth);
     
-    // 3. 调整文本项位置（向右偏移左缩进值）
-    m_textItem->setPos(leftIndent, 0);
+    // 3. 调整文本项位置（向右偏移左缩进值；只显示部分行时向上偏移）
+    m_textItem->setPos(leftIndent, m_clipped ? -m_clipTop : 0.0);
+    invalidateLineTable();
+}
+
+QTextLayout *TextBlockItem::textLayout() const
+{
+    return m_textItem->document()->firstBlock().layout();
+}
+
+qreal TextBlockItem::spaceBefore() const
+{
+    ParagraphBlock *para = qobject_cast<ParagraphBlock*>(m_block);
+    return para ? para->effectiveParagraphStyle().spaceBefore() : 0.0;
+}
+
+qreal TextBlockItem::spaceAfter() const
+{
+    ParagraphBlock *para = qobject_cast<ParagraphBlock*>(m_block);
+    return para ? para->effectiveParagraphStyle().spaceAfter() : 0.0;
+}
+
+const QVector<TextBlockItem::CachedLine> &TextBlockItem::lineTable() const
+{
+    if (m_lineTableValid)
+        return m_lineTable;
+    m_lineTable.clear();
+    if (QTextLayout *layout = textLayout()) {
+        const qreal originY = m_textItem->pos().y() + layout->position().y();
+        m_lineTable.reserve(layout->lineCount());
+        for (int i = 0; i < layout->lineCount(); ++i) {
+            const QTextLine line = layout->lineAt(i);
+            m_lineTable.append(CachedLine{line.textStart(), originY + line.y(), line.height()});
+        }
+    }
+    m_lineTableValid = true;
+    return m_lineTable;
+}
+
+int TextBlockItem::lineIndexForOffset(int offset) const
+{
+    const QVector<CachedLine> &lines = lineTable();
+    if (lines.isEmpty())
+        return -1;
+    auto it = std::upper_bound(lines.constBegin(), lines.constEnd(), offset,
+                               [](int value, const CachedLine &line) { return value < line.start; });
+    return qMax(0, int(it - lines.constBegin()) - 1);
+}
+
+void TextBlockItem::invalidateLineTable()
+{
+    m_lineTableValid = false;
+}
+
+bool TextBlockItem::containsOffset(int offset) const
+{
+    if (!m_clipped)
+        return true;
+    const int index = lineIndexForOffset(offset);
+    if (index < 0)
+        return false;
+    // 行顶落在本页显示范围内的行属于该图形项（行表已含裁剪偏移）
+    const qreal y = lineTable().at(index).y;
+    return y >= -0.5 && y < m_clipHeight - 0.5;
+}
+
+int TextBlockItem::hitTest(const QPointF &pos) const
+{
+    QTextDocument *doc = m_textItem->document();
+    const QPointF docPos = pos - m_textItem->pos();
+    int offset = doc->documentLayout()->hitTest(docPos, Qt::FuzzyHit);
+    if (offset >= 0 && offset < doc->characterCount())
+        return offset;
+
+    // 在文本外部时，取最近一行中与 x 最近的字符位置
+    const QVector<CachedLine> &lines = lineTable();
+    if (lines.isEmpty())
+        return 0;
+    auto it = std::upper_bound(lines.constBegin(), lines.constEnd(), pos.y(),
+                               [](qreal value, const CachedLine &line) { return value < line.y + line.height; });
+    const int index = qMin(int(it - lines.constBegin()), lines.size() - 1);
+    const QTextLine line = textLayout()->lineAt(index);
+    return qBound(0, line.xToCursor(docPos.x()), doc->characterCount() - 1);
+}
+
+QRectF TextBlockItem::cursorRect(int offset) const
+{
+    const int index = lineIndexForOffset(offset);
+    if (index < 0)
+        return QRectF();
+    const CachedLine &cached = lineTable().at(index);
+    QTextLayout *layout = textLayout();
+    const qreal x = m_textItem->pos().x() + layout->position().x() + layout->lineAt(index).cursorToX(offset);
+    return QRectF(x, cached.y, 0.0, cached.height);
+}
+
+QList<QRectF> TextBlockItem::selectionRects(int start, int end) const
+{
+    QList<QRectF> rects;
+    const int first = lineIndexForOffset(start);
+    if (first < 0)
+        return rects;
+    const QVector<CachedLine> &lines = lineTable();
+    QTextLayout *layout = textLayout();
+    const qreal originX = m_textItem->pos().x() + layout->position().x();
+    for (int i = first; i < lines.size() && lines.at(i).start < end; ++i) {
+        const CachedLine &cached = lines.at(i);
+        // 跨页段落只返回本页显示的行
+        if (m_clipped && (cached.y < -0.5 || cached.y >= m_clipHeight - 0.5))
+            continue;
+        const QTextLine line = layout->lineAt(i);
+        const int selStart = qMax(start, cached.start);
+        const int selEnd = qMin(end, cached.start + line.textLength());
+        if (selStart >= selEnd)
+            continue;
+        const qreal x1 = line.cursorToX(selStart);
+        const qreal x2 = line.cursorToX(selEnd);
+        rects.append(QRectF(originX + qMin(x1, x2), cached.y, qAbs(x2 - x1), cached.height));
+    }
+    return rects;
 }
 
 } // namespace QtWordEditor
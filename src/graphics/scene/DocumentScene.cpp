@@ -4,40 +4,52 @@
 #include "core/document/Block.h"
 #include "core/document/ParagraphBlock.h"
 #include "core/document/Page.h"
-#include "core/document/ParagraphStyle.h"
 #include "core/utils/Constants.h"
 #include "graphics/items/BaseBlockItem.h"
 #include "graphics/items/TextBlockItem.h"
+#include "graphics/items/PaintedTextBlockItem.h"
 #include "graphics/items/CursorItem.h"
 #include "graphics/items/SelectionItem.h"
 #include "graphics/items/PageItem.h"
+#include "graphics/scene/SceneUpdateScheduler.h"
 #include "editcontrol/cursor/Cursor.h"
 #include "editcontrol/selection/Selection.h"
 #include <QDebug>
 #include <QGraphicsItem>
-#include <QGraphicsTextItem>
-#include <QTextDocument>
-#include <QTextCursor>
-#include <QTextBlock>
-#include <QTextOption>
-#include <QAbstractTextDocumentLayout>
-#include <QFontMetrics>
-#include <QTextLayout>
-#include <QTextLine>
+#include <QPainterPath>
+#include <algorithm>
+#include <utility>
 
 namespace QtWordEditor {
 
 DocumentScene::DocumentScene(QObject *parent)
     : QGraphicsScene(parent)
     , m_document(nullptr)
+    , m_pagesWidth(0.0)
+    , m_virtualized(false)
+    , m_virtualizationMargin(Constants::SCENE_VIRTUALIZATION_MARGIN)
+    , m_layoutEngine(nullptr)
+    , m_tileCache(Constants::TILE_CACHE_BUDGET_BYTES)
+    , m_tileCacheEnabled(false)
     , m_cursorItem(nullptr)
     , m_selectionItem(nullptr)
+    , m_updateScheduler(new SceneUpdateScheduler(this))
 {
     setBackgroundBrush(QBrush(QColor(200, 200, 200)));
+    m_tileCache.setSnapshotProvider([this](int pageIndex) {
+        return pageSnapshot(pageIndex);
+    });
+    // 后台栅格化的图块就绪后重绘对应区域
+    connect(&m_tileCache, &PageTileCache::tileReady, this, [this](int pageIndex, const QRectF &rect) {
+        if (PageItem *pageItem = m_pageItems.value(pageIndex))
+            pageItem->update(rect);
+    });
 }
 
 DocumentScene::~DocumentScene()
 {
+    // 对象池中的图形项不在场景中，不会随场景删除
+    qDeleteAll(m_itemPool);
 }
 
 void DocumentScene::setDocument(Document *document)
@@ -53,6 +65,87 @@ Document *DocumentScene::document() const
     return m_document;
 }
 
+void DocumentScene::setLayoutEngine(LayoutEngine *engine)
+{
+    if (m_layoutEngine == engine)
+        return;
+    m_layoutEngine = engine;
+    m_updateScheduler->setLayoutEngine(engine);
+    rebuildFromDocument();
+}
+
+SceneUpdateScheduler *DocumentScene::updateScheduler() const
+{
+    return m_updateScheduler;
+}
+
+void DocumentScene::setVirtualized(bool enabled)
+{
+    if (m_virtualized == enabled)
+        return;
+    m_virtualized = enabled;
+    rebuildFromDocument();
+}
+
+bool DocumentScene::isVirtualized() const
+{
+    return m_virtualized;
+}
+
+void DocumentScene::setVirtualizationMargin(qreal margin)
+{
+    m_virtualizationMargin = qMax<qreal>(0.0, margin);
+    updateRealizedPages();
+}
+
+qreal DocumentScene::virtualizationMargin() const
+{
+    return m_virtualizationMargin;
+}
+
+void DocumentScene::setViewportRect(const QRectF &rect)
+{
+    m_viewportRect = rect;
+    updateRealizedPages();
+}
+
+int DocumentScene::realizedPageCount() const
+{
+    return m_realizedPages.size();
+}
+
+void DocumentScene::setTileCacheEnabled(bool enabled)
+{
+    if (m_tileCacheEnabled == enabled)
+        return;
+    m_tileCacheEnabled = enabled;
+    rebuildFromDocument();
+}
+
+bool DocumentScene::isTileCacheEnabled() const
+{
+    return m_tileCacheEnabled;
+}
+
+void DocumentScene::setTileCacheBudget(qint64 bytes)
+{
+    m_tileCache.setMaxBytes(bytes);
+}
+
+void DocumentScene::prefetchTiles(const QRectF &sceneRect, qreal scale)
+{
+    if (!m_tileCacheEnabled || !m_layoutEngine || m_pages.isEmpty())
+        return;
+    const int first = pageIndexAtY(sceneRect.top());
+    const int last = qMin(pageIndexAtY(sceneRect.bottom()) + 1, m_pages.size());
+    for (int pageIndex = first; pageIndex < last; ++pageIndex) {
+        const QRectF pageRect = pageSceneRect(pageIndex);
+        const QRectF area = sceneRect & pageRect;
+        if (!area.isEmpty())
+            m_tileCache.prefetch(pageIndex, area.translated(-pageRect.topLeft()), scale);
+    }
+}
+
 void DocumentScene::rebuildFromDocument()
 {
     // 先临时保存光标和选择项，避免被 clear() 删除
@@ -63,10 +156,13 @@ void DocumentScene::rebuildFromDocument()
     if (tempCursor) removeItem(tempCursor);
     if (tempSelection) removeItem(tempSelection);
     
+    // 已创建的段落图形项先回收到对象池，重建后直接复用；页序号对应的页面已变化，图块全部失效
+    clearPages();
+    m_tileCache.clear();
+    m_pageSnapshots.clear();
     clear();
     m_blockItems.clear();
-    m_pageItems.clear();
-    m_pageTextItems.clear();
+    m_fragmentItems.clear();
   //  QDebug() << "DocumentScene::rebuildFromDocument() - 开始重建场景";
   //  QDebug() << "  文档指针:" << m_document;
 
@@ -88,66 +184,6 @@ void DocumentScene::rebuildFromDocument()
                     continue;
 
                 addPage(page);
-                
-                // 初始化当前页的文本项列表
-                QVector<QGraphicsTextItem*> pageTextItems;
-                
-                // 记录当前页的所有文本块项，用于后续计算位置
-                QVector<TextBlockItem*> pageBlockItems;
-                
-                for (int blockIdx = 0; blockIdx < page->blockCount(); ++blockIdx) {
-                    Block *block = page->block(blockIdx);
-                  //  QDebug() << "    块" << blockIdx << "指针:" << block;
-                    if (!block)
-                        continue;
-
-                    ParagraphBlock *paraBlock = qobject_cast<ParagraphBlock*>(block);
-                    if (paraBlock) {
-                      //  QDebug() << ">>>>>>>>>> 添加文本块项，文本内容:" << paraBlock->text();
-                        
-                        // 创建 TextBlockItem
-                        TextBlockItem *textBlockItem = new TextBlockItem(paraBlock);
-                        
-                        // 添加到场景
-                        addItem(textBlockItem);
-                        
-                        // 添加到 m_blockItems、m_pageTextItems 和 pageBlockItems
-                        m_blockItems.insert(block, textBlockItem);
-                        pageTextItems.append(textBlockItem->textItem());
-                        pageBlockItems.append(textBlockItem);
-                        
-                      //  QDebug() << ">>>>>>>>>>      文本项边界矩形:" << textBlockItem->textItem()->boundingRect();
-                    }
-                }
-                
-                // 根据每个块的实际高度计算位置，考虑段前和段后间距
-                qreal currentY = Constants::PAGE_MARGIN;
-                for (int i = 0; i < pageBlockItems.size(); ++i) {
-                    TextBlockItem *textBlockItem = pageBlockItems[i];
-                    ParagraphBlock *paraBlock = qobject_cast<ParagraphBlock*>(textBlockItem->block());
-                    
-                    qreal textX = Constants::PAGE_MARGIN;
-                    qreal spaceBefore = 0.0;
-                    
-                    // 只有第一个块之后的块才添加段前间距
-                    if (i > 0 && paraBlock) {
-                        spaceBefore = paraBlock->paragraphStyle().spaceBefore();
-                    }
-                    
-                    // 应用段前间距
-                    currentY += spaceBefore;
-                    
-                    // 设置块的位置
-                    textBlockItem->setPos(textX, currentY);
-                    
-                    // 下一个块从当前块的底部开始，加上段后间距
-                    qreal blockHeight = textBlockItem->boundingRect().height();
-                    qreal spaceAfter = paraBlock ? paraBlock->paragraphStyle().spaceAfter() : 0.0;
-                    currentY += blockHeight + spaceAfter;
-                }
-                
-                // 将当前页的文本项列表添加到全局列表
-                m_pageTextItems.append(pageTextItems);
             }
         }
     }
@@ -167,99 +203,631 @@ void DocumentScene::rebuildFromDocument()
   //  QDebug() << "DocumentScene::rebuildFromDocument() - 场景重建完成！";
 }
 
-void DocumentScene::updateAllTextItems()
+void DocumentScene::appendPages(int firstPage, int count)
 {
-  //  QDebug() << "DocumentScene::updateAllTextItems() - 更新所有文本项";
-    for (BaseBlockItem *item : m_blockItems) {
-        if (item) {
-            item->updateBlock();
+    if (!m_document || count <= 0)
+        return;
+    // 页面项按顺序纵向排列，只有新页面紧接在已有页面之后时才能直接追加
+    if (firstPage != m_pages.size()) {
+        rebuildFromDocument();
+        return;
+    }
+
+    int pageIndex = 0;
+    for (int sectionIdx = 0; sectionIdx < m_document->sectionCount(); ++sectionIdx) {
+        Section *section = m_document->section(sectionIdx);
+        if (!section)
+            continue;
+        for (int pageIdx = 0; pageIdx < section->pageCount(); ++pageIdx, ++pageIndex) {
+            if (pageIndex < firstPage)
+                continue;
+            if (pageIndex >= firstPage + count)
+                return;
+            Page *page = section->page(pageIdx);
+            if (page)
+                addPage(page);
         }
     }
-    // 更新所有块的位置
-    updateBlockPositions();
 }
 
-void DocumentScene::updateBlockPositions()
+void DocumentScene::replacePages(int firstPage, int removedCount, int addedCount)
 {
-    if (!m_document) {
+    if (!m_document)
+        return;
+    if (firstPage < 0 || removedCount < 0 || addedCount < 0 || firstPage + removedCount > m_pages.size()) {
+        rebuildFromDocument();
         return;
     }
 
-    // 遍历文档中的所有节
-    for (int sectionIdx = 0; sectionIdx < m_document->sectionCount(); ++sectionIdx) {
+    // 文档中替换进来的页面
+    QVector<Page*> addedPages;
+    addedPages.reserve(addedCount);
+    int pageIndex = 0;
+    for (int sectionIdx = 0; sectionIdx < m_document->sectionCount() && addedPages.size() < addedCount; ++sectionIdx) {
         Section *section = m_document->section(sectionIdx);
-        if (!section) {
-            continue;
+        const int count = section ? section->pageCount() : 0;
+        for (int pageIdx = qMax(0, firstPage - pageIndex); pageIdx < count && addedPages.size() < addedCount; ++pageIdx)
+            addedPages.append(section->page(pageIdx));
+        pageIndex += count;
+    }
+    if (addedPages.size() != addedCount || addedPages.contains(nullptr)) {
+        rebuildFromDocument();
+        return;
+    }
+
+    const int removedEnd = firstPage + removedCount;
+    const int delta = addedCount - removedCount;
+    bool changed = false;
+    for (int i = firstPage; i < removedEnd; ++i) {
+        changed |= m_realizedPages.contains(i);
+        releasePage(i);
+    }
+
+    // 后面已创建图形项的页面整体平移：选择路径按页序号保存，先取下，平移后重新计算
+    QVector<int> shiftedPages;
+    for (int realized : std::as_const(m_realizedPages)) {
+        if (realized >= removedEnd)
+            shiftedPages.append(realized);
+    }
+    const bool hasSelection = m_selectionItem && !m_selectionRange.isEmpty();
+    if (hasSelection) {
+        for (int shifted : std::as_const(shiftedPages))
+            m_selectionItem->removePage(shifted);
+    }
+    const qreal oldTop = removedEnd < m_pages.size() ? m_pageTops.at(removedEnd) : 0.0;
+
+    m_pages.remove(firstPage, removedCount);
+    m_pageTops.remove(firstPage, removedCount);
+    m_pageItems.remove(firstPage, removedCount);
+    m_pageBlockItems.remove(firstPage, removedCount);
+    m_pageHitTables.remove(firstPage, removedCount);
+    for (int i = 0; i < addedCount; ++i) {
+        m_pages.insert(firstPage + i, addedPages.at(i));
+        m_pageTops.insert(firstPage + i, 0.0);
+        m_pageItems.insert(firstPage + i, nullptr);
+        m_pageBlockItems.insert(firstPage + i, QVector<BaseBlockItem*>());
+        m_pageHitTables.insert(firstPage + i, QVector<HitInterval>());
+        m_pagesWidth = qMax(m_pagesWidth, addedPages.at(i)->pageRect().width());
+    }
+
+    // 页序号平移：已创建的页面、图形项所在页、页面快照和图块缓存
+    if (delta != 0) {
+        QSet<int> realizedPages;
+        for (int realized : std::as_const(m_realizedPages))
+            realizedPages.insert(realized >= removedEnd ? realized + delta : realized);
+        m_realizedPages = realizedPages;
+        for (auto it = m_itemPages.begin(); it != m_itemPages.end(); ++it) {
+            if (it.value() >= removedEnd)
+                it.value() += delta;
         }
+        for (int &shifted : shiftedPages)
+            shifted += delta;
+    }
+    QHash<int, PageSnapshotPtr> snapshots;
+    for (auto it = m_pageSnapshots.constBegin(); it != m_pageSnapshots.constEnd(); ++it) {
+        if (it.key() < firstPage)
+            snapshots.insert(it.key(), it.value());
+        else if (it.key() >= removedEnd)
+            snapshots.insert(it.key() + delta, it.value());
+    }
+    m_pageSnapshots = snapshots;
+    m_tileCache.replacePages(firstPage, removedCount, addedCount);
 
-        // 遍历节中的所有页面
-        for (int pageIdx = 0; pageIdx < section->pageCount(); ++pageIdx) {
-            Page *page = section->page(pageIdx);
-            if (!page) {
-                continue;
-            }
+    // 重新计算页面顶部的前缀和，遇到顶部未变的后续页面即停止（其后的页面也不变）
+    for (int i = firstPage; i < m_pages.size(); ++i) {
+        const qreal top = i == 0 ? 0.0 : pageSceneRect(i - 1).bottom() + Constants::PAGE_SPACING;
+        if (i >= firstPage + addedCount && top == m_pageTops.at(i))
+            break;
+        m_pageTops[i] = top;
+    }
+    const int shiftedStart = firstPage + addedCount;
+    const qreal dy = shiftedStart < m_pages.size() ? m_pageTops.at(shiftedStart) - oldTop : 0.0;
 
-            // 收集当前页面的所有文本块项
-            QVector<TextBlockItem*> pageBlockItems;
-            for (int blockIdx = 0; blockIdx < page->blockCount(); ++blockIdx) {
-                Block *block = page->block(blockIdx);
-                if (!block) {
-                    continue;
-                }
-                auto it = m_blockItems.find(block);
-                if (it != m_blockItems.end()) {
-                    TextBlockItem *textBlockItem = dynamic_cast<TextBlockItem*>(it.value());
-                    if (textBlockItem) {
-                        pageBlockItems.append(textBlockItem);
-                    }
-                }
+    // 后续页面的内容不变，图形项和命中区间直接平移，不重新排列
+    const bool tiled = m_tileCacheEnabled && m_layoutEngine;
+    for (int shifted : std::as_const(shiftedPages)) {
+        PageItem *pageItem = m_pageItems.at(shifted);
+        if (tiled && delta != 0 && pageItem)
+            pageItem->setTileCache(&m_tileCache, shifted);
+        if (dy != 0.0) {
+            if (pageItem)
+                pageItem->moveBy(0, dy);
+            for (BaseBlockItem *item : m_pageBlockItems.at(shifted)) {
+                if (item)
+                    item->moveBy(0, dy);
             }
-
-            // 根据每个块的实际高度重新计算位置，考虑段前和段后间距
-            qreal currentY = Constants::PAGE_MARGIN;
-            for (int i = 0; i < pageBlockItems.size(); ++i) {
-                TextBlockItem *textBlockItem = pageBlockItems[i];
-                ParagraphBlock *paraBlock = qobject_cast<ParagraphBlock*>(textBlockItem->block());
-                
-                qreal textX = Constants::PAGE_MARGIN;
-                qreal spaceBefore = 0.0;
-                
-                // 只有第一个块之后的块才添加段前间距
-                if (i > 0 && paraBlock) {
-                    spaceBefore = paraBlock->paragraphStyle().spaceBefore();
-                }
-                
-                // 应用段前间距
-                currentY += spaceBefore;
-                
-                // 设置块的位置
-                textBlockItem->setPos(textX, currentY);
-                
-                // 下一个块从当前块的底部开始，加上段后间距
-                qreal blockHeight = textBlockItem->boundingRect().height();
-                qreal spaceAfter = paraBlock ? paraBlock->paragraphStyle().spaceAfter() : 0.0;
-                currentY += blockHeight + spaceAfter;
+            for (HitInterval &interval : m_pageHitTables[shifted]) {
+                interval.top += dy;
+                interval.bottom += dy;
             }
         }
+        if (hasSelection)
+            refreshPageSelection(shifted);
+    }
+
+    if (!m_pages.isEmpty()) {
+        const qreal totalHeight = pageSceneRect(m_pages.size() - 1).bottom() + 50.0;
+        setSceneRect(-50, -50, m_pagesWidth + 100, totalHeight + 100);
     }
+
+    // 新页面按视口创建图形项
+    for (int i = firstPage; i < firstPage + addedCount; ++i) {
+        if (!m_virtualized || realizeArea().intersects(pageSceneRect(i))) {
+            realizePage(i);
+            changed = true;
+        }
+    }
+    if (changed)
+        emit visiblePagesChanged();
+    // 页面高度变化可能使其他页面进入或离开视口
+    updateRealizedPages();
 }
 
-void DocumentScene::updateSingleTextItem(Block *block)
+void DocumentScene::realizePage(int pageIndex)
 {
-    if (!block)
+    Page *page = m_pages.value(pageIndex);
+    if (!page || m_pageItems.value(pageIndex))
+        return;
+    
+    PageItem *pageItem = new PageItem(page);
+    pageItem->setPos(0, pageSceneRect(pageIndex).top());
+    const bool tiled = m_tileCacheEnabled && m_layoutEngine;
+    if (tiled)
+        pageItem->setTileCache(&m_tileCache, pageIndex);
+    addItem(pageItem);
+    m_pageItems[pageIndex] = pageItem;
+    
+    // 每个块片段对应的图形项（非段落块为空），用于后续计算位置
+    QVector<BaseBlockItem*> pageBlockItems(page->blockCount(), nullptr);
+    
+    for (int blockIdx = 0; blockIdx < page->blockCount(); ++blockIdx) {
+        const BlockFragment fragment = page->fragment(blockIdx);
+        ParagraphBlock *paraBlock = qobject_cast<ParagraphBlock*>(fragment.block);
+        if (!paraBlock)
+            continue;
+
+        BaseBlockItem *item = createParagraphItem(paraBlock, fragment);
+        // 使用图块缓存时块图形项只提供几何信息，内容由页面图块绘制
+        item->setFlag(QGraphicsItem::ItemHasNoContents, tiled);
+        addItem(item);
+        m_itemPages.insert(item, pageIndex);
+        
+        // 段落的第一个片段是它的主图形项，后续片段另行记录
+        if (fragment.isFirst())
+            m_blockItems.insert(paraBlock, item);
+        else
+            m_fragmentItems.insert(paraBlock, item);
+        pageBlockItems[blockIdx] = item;
+    }
+    
+    m_pageBlockItems[pageIndex] = pageBlockItems;
+    m_realizedPages.insert(pageIndex);
+    positionPageItems(pageIndex);
+}
+
+void DocumentScene::releasePage(int pageIndex)
+{
+    if (!m_realizedPages.contains(pageIndex))
+        return;
+    
+    // 增量分页替换页面时页面对象已被删除，只能从图形项判断它是主图形项还是后续片段
+    const QVector<BaseBlockItem*> pageBlockItems = m_pageBlockItems.value(pageIndex);
+    for (BaseBlockItem *item : pageBlockItems) {
+        if (!item)
+            continue;
+        Block *block = item->block();
+        if (m_blockItems.value(block) == item)
+            m_blockItems.remove(block);
+        else
+            m_fragmentItems.remove(block, item);
+        m_itemPages.remove(item);
+        m_itemSelectionRects.remove(item);
+        recycleItem(item);
+    }
+    m_pageBlockItems[pageIndex].clear();
+    m_pageHitTables[pageIndex].clear();
+    if (m_selectionItem)
+        m_selectionItem->removePage(pageIndex);
+    
+    delete m_pageItems[pageIndex];
+    m_pageItems[pageIndex] = nullptr;
+    m_realizedPages.remove(pageIndex);
+}
+
+void DocumentScene::recycleItem(BaseBlockItem *item)
+{
+    PaintedTextBlockItem *painted = dynamic_cast<PaintedTextBlockItem*>(item);
+    if (painted && m_itemPool.size() < Constants::SCENE_ITEM_POOL_SIZE) {
+        removeItem(painted);
+        m_itemPool.append(painted);
+        return;
+    }
+    delete item;
+}
+
+void DocumentScene::updateRealizedPages()
+{
+    if (!m_virtualized || m_pages.isEmpty())
         return;
-    auto it = m_blockItems.find(block);
-    if (it != m_blockItems.end() && it.value()) {
-        it.value()->updateBlock();
+    
+    // 页面纵向排列，二分查找与需要创建的区域相交的页面范围 [first, last)
+    const QRectF area = realizeArea();
+    const int first = pageIndexAtY(area.top());
+    const int last = qMin(pageIndexAtY(area.bottom()) + 1, m_pages.size());
+    
+    bool changed = false;
+    const QList<int> realized = m_realizedPages.values();
+    for (int pageIndex : realized) {
+        if (pageIndex < first || pageIndex >= last) {
+            releasePage(pageIndex);
+            changed = true;
+        }
+    }
+    for (int pageIndex = first; pageIndex < last; ++pageIndex) {
+        if (!m_realizedPages.contains(pageIndex)) {
+            realizePage(pageIndex);
+            changed = true;
+        }
+    }
+    if (changed)
+        emit visiblePagesChanged();
+}
+
+void DocumentScene::ensureBlockRealized(Block *block)
+{
+    if (!m_virtualized || !block || !m_document)
+        return;
+    const int blockIndex = m_document->indexOfBlock(block);
+    if (blockIndex < 0)
+        return;
+    // 块所在的页面是连续的，从二分查找到的第一页开始，直到页面从后面的块开始
+    for (int pageIndex = firstPageOfBlock(blockIndex); pageIndex < m_pages.size(); ++pageIndex) {
+        if (firstBlockOfPage(pageIndex) > blockIndex)
+            break;
+        if (m_pages[pageIndex]->containsBlock(block))
+            realizePage(pageIndex);
+    }
+}
+
+PageSnapshotPtr DocumentScene::pageSnapshot(int pageIndex)
+{
+    auto cached = m_pageSnapshots.constFind(pageIndex);
+    if (cached != m_pageSnapshots.constEnd())
+        return cached.value();
+    Page *page = m_pages.value(pageIndex);
+    if (!page || !m_layoutEngine)
+        return PageSnapshotPtr();
+
+    QSharedPointer<PageSnapshot> snapshot(new PageSnapshot);
+    snapshot->pageRect = page->pageRect();
+    snapshot->background = Qt::white;
+
+    // 与 positionPageItems() 相同的排列规则，页面未创建图形项时也能生成快照（用于预取）
+    qreal currentY = Constants::PAGE_MARGIN;
+    bool firstItem = true;
+    for (int i = 0; i < page->blockCount(); ++i) {
+        const BlockFragment fragment = page->fragment(i);
+        ParagraphBlock *paraBlock = qobject_cast<ParagraphBlock*>(fragment.block);
+        if (!paraBlock)
+            continue;
+        PageSnapshot::Fragment entry;
+        entry.layout = m_layoutEngine->paragraphLayout(paraBlock);
+        if (!entry.layout)
+            continue;
+        entry.firstLine = qBound(0, fragment.startLine, entry.layout->lineCount());
+        entry.lastLine = fragment.isLast() ? entry.layout->lineCount()
+                                           : qBound(entry.firstLine, fragment.endLine, entry.layout->lineCount());
+        qreal height = 0.0;
+        for (int line = entry.firstLine; line < entry.lastLine; ++line) {
+            height += entry.layout->lines().at(line).height;
+        }
+
+        if (!firstItem && fragment.isFirst())
+            currentY += entry.layout->spaceBefore();
+        firstItem = false;
+        entry.rect = QRectF(Constants::PAGE_MARGIN, currentY, entry.layout->availableWidth(), height);
+        currentY += height;
+        if (fragment.isLast())
+            currentY += entry.layout->spaceAfter();
+        snapshot->fragments.append(entry);
+    }
+
+    m_pageSnapshots.insert(pageIndex, snapshot);
+    return snapshot;
+}
+
+void DocumentScene::invalidateUnrealizedBlockPages(Block *block, int aroundPage)
+{
+    auto invalidatePage = [this](int pageIndex) {
+        if (m_realizedPages.contains(pageIndex))
+            return;
+        m_tileCache.invalidate(pageIndex, QRectF(QPointF(0, 0), pageSceneRect(pageIndex).size()));
+        m_pageSnapshots.remove(pageIndex);
+    };
+
+    if (aroundPage < 0) {
+        const int blockIndex = m_document ? m_document->indexOfBlock(block) : -1;
+        if (blockIndex < 0)
+            return;
+        for (int pageIndex = firstPageOfBlock(blockIndex); pageIndex < m_pages.size(); ++pageIndex) {
+            if (firstBlockOfPage(pageIndex) > blockIndex)
+                break;
+            if (m_pages[pageIndex]->containsBlock(block))
+                invalidatePage(pageIndex);
+        }
+        return;
+    }
+    // 块所在的页面是连续的，从已知的页面向两侧查找
+    for (int pageIndex = aroundPage - 1; pageIndex >= 0 && m_pages[pageIndex]->containsBlock(block); --pageIndex)
+        invalidatePage(pageIndex);
+    for (int pageIndex = aroundPage + 1; pageIndex < m_pages.size() && m_pages[pageIndex]->containsBlock(block); ++pageIndex)
+        invalidatePage(pageIndex);
+}
+
+void DocumentScene::invalidateTiles(int pageIndex, const QRectF &sceneRect)
+{
+    PageItem *pageItem = m_pageItems.value(pageIndex);
+    if (!pageItem || !m_tileCacheEnabled)
+        return;
+    m_pageSnapshots.remove(pageIndex);
+    // 抗锯齿的字形边缘可能略超出块的矩形
+    const QRectF dirty = pageItem->mapRectFromScene(sceneRect).adjusted(-2, -2, 2, 2);
+    m_tileCache.invalidate(pageIndex, dirty);
+    pageItem->update(dirty);
+}
+
+QRectF DocumentScene::pageSceneRect(int pageIndex) const
+{
+    Page *page = m_pages.value(pageIndex);
+    if (!page)
+        return QRectF();
+    const QRectF pageRect = page->pageRect();
+    return QRectF(0, m_pageTops.at(pageIndex), pageRect.width(), pageRect.height());
+}
+
+int DocumentScene::pageIndexAtY(qreal y) const
+{
+    if (m_pages.isEmpty())
+        return 0;
+    // 页面 i 连同其下方的页间距占据 [m_pageTops[i], m_pageTops[i + 1])
+    auto it = std::upper_bound(m_pageTops.constBegin(), m_pageTops.constEnd(), y);
+    const int pageIndex = qMax(0, int(it - m_pageTops.constBegin()) - 1);
+    if (pageIndex == m_pages.size() - 1 && y >= pageSceneRect(pageIndex).bottom() + Constants::PAGE_SPACING)
+        return m_pages.size();
+    return pageIndex;
+}
+
+int DocumentScene::firstPageOfBlock(int blockIndex) const
+{
+    if (!m_document)
+        return m_pages.size();
+    // 页面按块的顺序排列：二分查找最后一个块不在 blockIndex 之前的第一页
+    int low = 0;
+    int high = m_pages.size();
+    while (low < high) {
+        const int mid = (low + high) / 2;
+        const Page *page = m_pages.at(mid);
+        const int count = page->blockCount();
+        if (count > 0 && m_document->indexOfBlock(page->fragment(count - 1).block) < blockIndex)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low;
+}
+
+int DocumentScene::firstBlockOfPage(int pageIndex) const
+{
+    const Page *page = m_pages.value(pageIndex);
+    if (!page || page->blockCount() == 0 || !m_document)
+        return -1;
+    return m_document->indexOfBlock(page->fragment(0).block);
+}
+
+QRectF DocumentScene::realizeArea() const
+{
+    // 视图尚未报告视口时按第一页处理
+    QRectF area = m_viewportRect;
+    if (area.isNull())
+        area = pageSceneRect(0);
+    return area.adjusted(0, -m_virtualizationMargin, 0, m_virtualizationMargin);
+}
+
+BaseBlockItem *DocumentScene::createParagraphItem(ParagraphBlock *block, const BlockFragment &fragment)
+{
+    // 有排版引擎时直接绘制缓存的字形，跨页段落只显示本页的行；优先复用回收的图形项
+    if (m_layoutEngine) {
+        if (!m_itemPool.isEmpty()) {
+            PaintedTextBlockItem *item = m_itemPool.takeLast();
+            item->setFragment(block, fragment.startLine, fragment.endLine);
+            return item;
+        }
+        return new PaintedTextBlockItem(block, m_layoutEngine, fragment.startLine, fragment.endLine);
+    }
+
+    TextBlockItem *textBlockItem = new TextBlockItem(block);
+    if (!fragment.isWhole())
+        textBlockItem->setTextClip(fragment.offset, fragment.textHeight);
+    return textBlockItem;
+}
+
+void DocumentScene::positionPageItems(int pageIndex, int fromFragment, bool stopWhenSettled)
+{
+    Page *page = m_pages.value(pageIndex);
+    const QVector<BaseBlockItem*> pageBlockItems = m_pageBlockItems.value(pageIndex);
+    if (!page || pageBlockItems.size() != page->blockCount())
+        return;
+    fromFragment = qBound(0, fromFragment, pageBlockItems.size());
+
+    // 从前一个块的底部（含段后间距）继续排列，前面没有块时从内容区顶部开始（相对于所在页面的顶部）
+    qreal currentY = pageSceneRect(pageIndex).top() + Constants::PAGE_MARGIN;
+    bool firstItem = true;
+    for (int i = fromFragment - 1; i >= 0; --i) {
+        BaseBlockItem *previous = pageBlockItems[i];
+        if (!previous)
+            continue;
+        currentY = previous->pos().y() + previous->rect().height();
+        if (page->fragment(i).isLast())
+            currentY += previous->spaceAfter();
+        firstItem = false;
+        break;
+    }
+
+    for (int i = fromFragment; i < pageBlockItems.size(); ++i) {
+        BaseBlockItem *blockItem = pageBlockItems[i];
+        if (!blockItem)
+            continue;
+        const BlockFragment fragment = page->fragment(i);
+        
+        qreal textX = Constants::PAGE_MARGIN;
+        
+        // 段前间距只加在段落开头，且页面第一个块不加；段后间距只加在段落末尾
+        if (!firstItem && fragment.isFirst())
+            currentY += blockItem->spaceBefore();
+        firstItem = false;
+        
+        // 设置块的位置，移动了的块使新旧位置的图块失效
+        const QPointF newPos(textX, currentY);
+        if (blockItem->pos() != newPos) {
+            invalidateTiles(pageIndex, blockItem->sceneBoundingRect());
+            blockItem->setPos(newPos);
+            invalidateTiles(pageIndex, blockItem->sceneBoundingRect());
+        } else if (stopWhenSettled && i > fromFragment) {
+            // 只有起始块的高度可能变化：后面的块位置没变，再往后的也不会变
+            break;
+        }
+        
+        // 下一个块从当前块的底部开始
+        currentY += blockItem->rect().height();
+        if (fragment.isLast())
+            currentY += blockItem->spaceAfter();
+    }
+
+    // 按纵向顺序重建该页的命中测试区间表（只与本页的块数有关）
+    QVector<HitInterval> &hitTable = m_pageHitTables[pageIndex];
+    hitTable.clear();
+    for (BaseBlockItem *blockItem : pageBlockItems) {
+        if (blockItem)
+            hitTable.append(HitInterval{blockItem->pos().y(), blockItem->pos().y() + blockItem->rect().height(), blockItem});
+    }
+
+    // 块的位置或内容变化后，该页的选择区域跟着重新计算
+    refreshPageSelection(pageIndex);
+}
+
+void DocumentScene::updateAllTextItems()
+{
+  //  QDebug() << "DocumentScene::updateAllTextItems() - 更新所有文本项";
+    // 未创建图形项的页面没有脏矩形可用，图块全部失效
+    m_tileCache.clear();
+    m_pageSnapshots.clear();
+    for (BaseBlockItem *item : m_blockItems) {
+        if (item) {
+            item->updateBlock();
+        }
+    }
+    for (BaseBlockItem *item : m_fragmentItems) {
+        item->updateBlock();
     }
     // 更新所有块的位置
     updateBlockPositions();
 }
 
+void DocumentScene::updateBlockPositions()
+{
+    // 只有已创建图形项的页面需要排列，其余页面在创建时排列
+    for (int pageIndex : std::as_const(m_realizedPages)) {
+        positionPageItems(pageIndex);
+    }
+}
+
+void DocumentScene::updateSingleTextItem(Block *block)
+{
+    if (!block)
+        return;
+    updateBlockItems(block);
+    const QList<BaseBlockItem*> items = itemsForBlock(block);
+    // 块在未创建图形项的页面上的部分（整块不可见，或跨页段落的其他页）没有图形项可比较，整页失效
+    if (m_tileCacheEnabled)
+        invalidateUnrealizedBlockPages(block, items.isEmpty() ? -1 : m_itemPages.value(items.first(), -1));
+    // 只有该块之后、同一页上的块可能移动；页面放不下时由排版引擎重新分页（pagesChanged）
+    for (BaseBlockItem *item : items) {
+        const int pageIndex = m_itemPages.value(item, -1);
+        if (pageIndex >= 0)
+            positionPageItems(pageIndex, m_pageBlockItems.at(pageIndex).indexOf(item), true);
+    }
+}
+
+void DocumentScene::updateBlockItems(Block *block)
+{
+    // 包括跨页段落在后续页面上的片段；内容变化前后的矩形都需要重绘
+    for (BaseBlockItem *item : itemsForBlock(block)) {
+        const int pageIndex = m_itemPages.value(item, -1);
+        invalidateTiles(pageIndex, item->sceneBoundingRect());
+        item->updateBlock();
+        invalidateTiles(pageIndex, item->sceneBoundingRect());
+    }
+}
+
+void DocumentScene::updateTextItems(const QList<Block*> &blocks)
+{
+    if (blocks.isEmpty() || !m_document)
+        return;
+    // 按文档顺序合并为连续区间，每个区间只访问包含它的页面，其余页面的图块保留
+    for (const QPair<int, int> &range : m_document->blockIndexRanges(blocks))
+        updateBlockRange(range.first, range.second);
+}
+
+void DocumentScene::updateBlockRange(int firstBlock, int lastBlock)
+{
+    if (!m_document || m_pages.isEmpty() || firstBlock > lastBlock)
+        return;
+    
+    for (int pageIndex = firstPageOfBlock(firstBlock); pageIndex < m_pages.size(); ++pageIndex) {
+        if (firstBlockOfPage(pageIndex) > lastBlock)
+            break;
+        
+        // 未创建图形项的页面没有脏矩形可用，整页失效
+        if (!m_realizedPages.contains(pageIndex)) {
+            if (m_tileCacheEnabled) {
+                m_tileCache.invalidate(pageIndex, QRectF(QPointF(0, 0), pageSceneRect(pageIndex).size()));
+                m_pageSnapshots.remove(pageIndex);
+            }
+            continue;
+        }
+        
+        const QVector<BaseBlockItem*> pageBlockItems = m_pageBlockItems.at(pageIndex);
+        int firstChanged = -1;
+        for (int i = 0; i < pageBlockItems.size(); ++i) {
+            BaseBlockItem *item = pageBlockItems.at(i);
+            if (!item)
+                continue;
+            const int blockIndex = m_document->indexOfBlock(item->block());
+            if (blockIndex < firstBlock || blockIndex > lastBlock)
+                continue;
+            invalidateTiles(pageIndex, item->sceneBoundingRect());
+            item->updateBlock();
+            invalidateTiles(pageIndex, item->sceneBoundingRect());
+            if (firstChanged < 0)
+                firstChanged = i;
+        }
+        if (firstChanged >= 0)
+            positionPageItems(pageIndex, firstChanged);
+    }
+}
+
 void DocumentScene::clearPages()
 {
-    qDeleteAll(m_pageItems);
+    const QList<int> realized = m_realizedPages.values();
+    for (int pageIndex : realized) {
+        releasePage(pageIndex);
+    }
+    m_pages.clear();
+    m_pageTops.clear();
+    m_pagesWidth = 0.0;
     m_pageItems.clear();
+    m_pageBlockItems.clear();
+    m_pageHitTables.clear();
 }
 
 void DocumentScene::addPage(Page *page)
@@ -267,20 +835,23 @@ void DocumentScene::addPage(Page *page)
     if (!page)
         return;
     
-    PageItem *pageItem = new PageItem(page);
-    
-    qreal pageSpacing = 30.0;
-    qreal yOffset = m_pageItems.size() * (page->pageRect().height() + pageSpacing);
+    // 页面顶部的前缀和：每页紧接上一页底部加页间距，各页尺寸可以不同
+    const int pageIndex = m_pages.size();
+    const qreal top = pageIndex == 0 ? 0.0 : pageSceneRect(pageIndex - 1).bottom() + Constants::PAGE_SPACING;
+    m_pages.append(page);
+    m_pageTops.append(top);
+    m_pageItems.append(nullptr);
+    m_pageBlockItems.append(QVector<BaseBlockItem*>());
+    m_pageHitTables.append(QVector<HitInterval>());
     
-    pageItem->setPos(0, yOffset);
-    addItem(pageItem);
-    m_pageItems.append(pageItem);
+    const QRectF rect = pageSceneRect(pageIndex);
+    m_pagesWidth = qMax(m_pagesWidth, rect.width());
+    qreal totalHeight = rect.bottom() + 50.0;
+    setSceneRect(-50, -50, m_pagesWidth + 100, totalHeight + 100);
     
-    qreal totalWidth = page->pageRect().width();
-    qreal totalHeight = yOffset + page->pageRect().height() + 50.0;
-    setSceneRect(-50, -50, totalWidth + 100, totalHeight + 100);
-    
-  //  QDebug() << "添加页面" << page->pageNumber() << "，Y坐标:" << yOffset;
+    // 虚拟化时视口附近之外的页面只保留几何信息
+    if (!m_virtualized || realizeArea().intersects(rect))
+        realizePage(pageIndex);
 }
 
 void DocumentScene::updateCursor(const QPointF &pos, qreal height)
@@ -302,22 +873,121 @@ void DocumentScene::setCursorVisible(bool visible)
     }
 }
 
-void DocumentScene::updateSelection(const QList<QRectF> &rects)
+void DocumentScene::setSelectionRange(const SelectionRange &range)
 {
+    if (!m_document || range.isEmpty()) {
+        clearSelection();
+        return;
+    }
+    
+    SelectionRange next = range;
+    next.normalize();
+    const SelectionRange previous = m_selectionRange;
+    if (!previous.isEmpty() && previous.startBlock == next.startBlock && previous.startOffset == next.startOffset
+        && previous.endBlock == next.endBlock && previous.endOffset == next.endOffset)
+        return;
+    m_selectionRange = next;
+    
     if (!m_selectionItem) {
         m_selectionItem = new SelectionItem();
         addItem(m_selectionItem);
     }
-    m_selectionItem->setRects(rects);
+    
+    // 只有起点或终点新旧位置之间（含两端）的块的选中部分会变化；之前没有选区时全部计算
+    const bool full = previous.isEmpty();
+    auto changed = [&](int blockIndex) {
+        if (full)
+            return true;
+        return (blockIndex >= qMin(previous.startBlock, next.startBlock) && blockIndex <= qMax(previous.startBlock, next.startBlock))
+            || (blockIndex >= qMin(previous.endBlock, next.endBlock) && blockIndex <= qMax(previous.endBlock, next.endBlock));
+    };
+    
+    for (int pageIndex : std::as_const(m_realizedPages)) {
+        bool dirty = false;
+        for (BaseBlockItem *item : m_pageBlockItems.at(pageIndex)) {
+            if (!item || !changed(m_document->indexOfBlock(item->block())))
+                continue;
+            const QVector<QRectF> rects = itemSelectionRects(item, next);
+            if (rects == m_itemSelectionRects.value(item))
+                continue;
+            if (rects.isEmpty())
+                m_itemSelectionRects.remove(item);
+            else
+                m_itemSelectionRects.insert(item, rects);
+            dirty = true;
+        }
+        if (dirty)
+            rebuildPageSelectionPath(pageIndex);
+    }
 }
 
 void DocumentScene::clearSelection()
 {
+    m_selectionRange = SelectionRange();
+    m_itemSelectionRects.clear();
     if (m_selectionItem) {
         m_selectionItem->clear();
     }
 }
 
+QVector<QRectF> DocumentScene::itemSelectionRects(BaseBlockItem *item, const SelectionRange &range) const
+{
+    QVector<QRectF> rects;
+    ParagraphBlock *paraBlock = qobject_cast<ParagraphBlock*>(item->block());
+    if (!paraBlock || range.isEmpty())
+        return rects;
+    
+    const int blockIdx = m_document->indexOfBlock(paraBlock);
+    if (blockIdx < range.startBlock || blockIdx > range.endBlock)
+        return rects;
+    
+    // 确定当前块的选择起始和结束偏移
+    const int length = paraBlock->length();
+    const int startOffset = blockIdx == range.startBlock ? qMin(range.startOffset, length) : 0;
+    const int endOffset = blockIdx == range.endBlock ? qMin(range.endOffset, length) : length;
+    if (startOffset >= endOffset)
+        return rects;
+    
+    // 跨页段落的每个图形项各自返回本页显示的行
+    for (const QRectF &rect : item->selectionRects(startOffset, endOffset)) {
+        rects.append(item->mapRectToScene(rect));
+    }
+    return rects;
+}
+
+void DocumentScene::refreshPageSelection(int pageIndex)
+{
+    if (!m_selectionItem || m_selectionRange.isEmpty())
+        return;
+    for (BaseBlockItem *item : m_pageBlockItems.value(pageIndex)) {
+        if (!item)
+            continue;
+        const QVector<QRectF> rects = itemSelectionRects(item, m_selectionRange);
+        if (rects.isEmpty())
+            m_itemSelectionRects.remove(item);
+        else
+            m_itemSelectionRects.insert(item, rects);
+    }
+    rebuildPageSelectionPath(pageIndex);
+}
+
+void DocumentScene::rebuildPageSelectionPath(int pageIndex)
+{
+    if (!m_selectionItem)
+        return;
+    // 同一页的矩形合并为一条路径，相邻行之间不画分隔线
+    QPainterPath path;
+    for (BaseBlockItem *item : m_pageBlockItems.value(pageIndex)) {
+        auto it = m_itemSelectionRects.constFind(item);
+        if (!item || it == m_itemSelectionRects.constEnd())
+            continue;
+        for (const QRectF &rect : it.value()) {
+            path.addRect(rect);
+        }
+    }
+    m_selectionItem->setPagePath(pageIndex, path.simplified());
+}
+
 void DocumentScene::onBlockAdded(int globalIndex)
 {
     Q_UNUSED(globalIndex);
@@ -334,17 +1004,9 @@ void DocumentScene::onLayoutChanged()
 
 Page *DocumentScene::pageAt(const QPointF &scenePos) const
 {
-    for (PageItem *pageItem : m_pageItems) {
-        if (pageItem && pageItem->page()) {
-            QRectF pageRect = pageItem->page()->pageRect();
-            QPointF itemPos = pageItem->pos();
-            QRectF totalRect(itemPos.x(), itemPos.y(), pageRect.width(), pageRect.height());
-            
-            if (totalRect.contains(scenePos)) {
-                return pageItem->page();
-            }
-        }
-    }
+    const int pageIndex = pageIndexAtY(scenePos.y());
+    if (pageSceneRect(pageIndex).contains(scenePos))
+        return m_pages.value(pageIndex);
     return nullptr;
 }
 
@@ -354,184 +1016,69 @@ CursorPosition DocumentScene::cursorPositionAt(const QPointF &scenePos) const
     pos.blockIndex = 0;
     pos.offset = 0;
     
-    if (!m_document) {
+    if (!m_document || m_pages.isEmpty()) {
         return pos;
     }
     
-    // 先找到所在的页
-    Page *page = pageAt(scenePos);
-    if (!page) {
-        return pos;
-    }
+    // 找到所在的页，在页面之间或之外时取最近的页
+    auto distance = [&scenePos](const QRectF &rect) {
+        if (scenePos.y() < rect.top())
+            return rect.top() - scenePos.y();
+        if (scenePos.y() > rect.bottom())
+            return scenePos.y() - rect.bottom();
+        return qreal(0.0);
+    };
+    int pageIndex = qMin(pageIndexAtY(scenePos.y()), m_pages.size() - 1);
+    if (pageIndex > 0 && distance(pageSceneRect(pageIndex - 1)) < distance(pageSceneRect(pageIndex)))
+        --pageIndex;
     
-    // 简单计算：根据Y坐标计算块索引
-    qreal pageSpacing = 30.0;
-    qreal pageHeight = Constants::PAGE_HEIGHT;
-    int pageIndex = page->pageNumber() - 1;
-    qreal yOffset = pageIndex * (pageHeight + pageSpacing);
-    
-    qreal relativeY = scenePos.y() - yOffset - Constants::PAGE_MARGIN;
-    int blockIndex = qBound(0, qFloor(relativeY / 30.0), page->blockCount() - 1);
-    pos.blockIndex = blockIndex;
-    
-    // 使用真实的 QGraphicsTextItem
-    if (pageIndex >= 0 && pageIndex < m_pageTextItems.size() &&
-        blockIndex >= 0 && blockIndex < m_pageTextItems[pageIndex].size()) {
-        QGraphicsTextItem *textItem = m_pageTextItems[pageIndex][blockIndex];
-        if (textItem) {
-            QTextDocument *doc = textItem->document();
-            if (doc) {
-                // 使用 mapFromScene 转换坐标到 textItem 的局部坐标
-                QPointF localPos = textItem->mapFromScene(scenePos);
-                
-                // 获取文本项的边界矩形
-                QRectF itemRect = textItem->boundingRect();
-                
-                // 首先尝试使用 hitTest 获取准确位置
-                int offset = doc->documentLayout()->hitTest(localPos, Qt::FuzzyHit);
-                
-                // 判断鼠标是否在文本项的下方（Y 坐标超出文本项高度）
-                // 或者 hitTest 返回 -1（表示在文本外部）
-                bool isBelowTextItem = localPos.y() > itemRect.height();
-                bool isOutsideText = (offset == -1 || offset > doc->characterCount());
-                
-                if (isBelowTextItem || isOutsideText) {
-                    // 遍历文档的所有块，找到合适的块
-                    QTextBlock block = doc->firstBlock();
-                    while (block.isValid()) {
-                        QTextLayout *layout = block.layout();
-                        if (layout && layout->lineCount() > 0) {
-                            // 获取该块的最后一行
-                            QTextLine lastLine = layout->lineAt(layout->lineCount() - 1);
-                            
-                            // 使用鼠标的 X 坐标（相对于 textItem）在最后一行查找最近的字符位置
-                            offset = lastLine.xToCursor(localPos.x());
-                            
-                            // 确保 offset 不超出文档范围
-                            offset = qBound(0, offset, doc->characterCount() - 1);
-                        }
-                        // 只处理第一个块（QGraphicsTextItem 通常只有一个块）
-                        break;
-                    }
-                }
-                
-                pos.offset = offset;
-            }
-        }
+    // 在该页的区间表中二分查找底部在该点之下的第一个块，落在块之间的空隙时取最近的
+    const QVector<HitInterval> &hitTable = m_pageHitTables.at(pageIndex);
+    if (hitTable.isEmpty()) {
+        return pos;
     }
+    auto it = std::upper_bound(hitTable.constBegin(), hitTable.constEnd(), scenePos.y(),
+                               [](qreal y, const HitInterval &interval) { return y < interval.bottom; });
+    int hitIndex = qMin(int(it - hitTable.constBegin()), hitTable.size() - 1);
+    if (hitIndex > 0 && scenePos.y() < hitTable[hitIndex].top
+        && scenePos.y() - hitTable[hitIndex - 1].bottom < hitTable[hitIndex].top - scenePos.y())
+        --hitIndex;
+    BaseBlockItem *hitItem = hitTable[hitIndex].item;
     
-  //  QDebug() << "DocumentScene::cursorPositionAt - 场景位置:" << scenePos
-  //           << "→ 块索引:" << pos.blockIndex << "，偏移:" << pos.offset;
-    
+    pos.blockIndex = m_document->indexOfBlock(hitItem->block());
+    pos.offset = hitItem->hitTest(hitItem->mapFromScene(scenePos));
     return pos;
 }
 
-QPointF DocumentScene::calculateCursorVisualPosition(const CursorPosition &pos) const
+QPointF DocumentScene::calculateCursorVisualPosition(const CursorPosition &pos)
+{
+    return calculateCursorRect(pos).topLeft();
+}
+
+QRectF DocumentScene::calculateCursorRect(const CursorPosition &pos)
 {
-    QPointF result(0, 0);
-  //  QDebug() << "DocumentScene::calculateCursorVisualPosition - 计算光标位置，块:" << pos.blockIndex << "，偏移:" << pos.offset;
-    
     if (!m_document) {
-      //  QDebug() << "  文档指针为空！";
-        return result;
-    }
-    
-    // 找到所在的页（简单假设：第0个section）
-    Section *section = m_document->section(0);
-    if (!section) {
-      //  QDebug() << "  节指针为空！";
-        return result;
-    }
-    
-    // 找到对应页的index：这里简化，假设每个section只有1页
-    int pageIndex = 0;
-    if (pageIndex < 0 || pageIndex >= section->pageCount()) {
-      //  QDebug() << "  页面索引超出范围！";
-        return result;
+        return QRectF();
     }
     
-    Page *page = section->page(pageIndex);
-    if (!page) {
-      //  QDebug() << "  页面指针为空！";
-        return result;
+    // 光标可能在视口之外（例如键盘移动后），先为它所在的页面创建图形项
+    Block *block = m_document->block(pos.blockIndex);
+    BaseBlockItem *item = itemForOffset(block, pos.offset);
+    if (!item || !item->containsOffset(pos.offset)) {
+        ensureBlockRealized(block);
+        item = itemForOffset(block, pos.offset);
     }
-    
-    // 获取真实的 QGraphicsTextItem
-    QGraphicsTextItem *textItem = nullptr;
-    if (pageIndex >= 0 && pageIndex < m_pageTextItems.size() &&
-        pos.blockIndex >= 0 && pos.blockIndex < m_pageTextItems[pageIndex].size()) {
-        textItem = m_pageTextItems[pageIndex][pos.blockIndex];
-    }
-    
-    if (!textItem) {
-      //  QDebug() << "  文本项指针为空！页面索引:" << pageIndex 
-      //           << "页面文本项列表大小:" << m_pageTextItems.size()
-      //           << "块索引:" << pos.blockIndex;
-        if (pageIndex < m_pageTextItems.size()) {
-          //  QDebug() << "  当前页面文本项数量:" << m_pageTextItems[pageIndex].size();
-        }
-        return result;
-    }
-    
-    QTextDocument *doc = textItem->document();
-    if (!doc) {
-      //  QDebug() << "  文档指针为空！";
-        return result;
+    if (!item) {
+        return QRectF();
     }
-    
-    QString text = doc->toPlainText();
-    int charOffset = qMin(pos.offset, text.length());
-    
-  //  QDebug() << "  文本内容:" << text << "字符偏移:" << charOffset;
-    
-    // 使用 QTextCursor 和文档布局来计算光标位置
-    QTextCursor cursor(doc);
-    cursor.setPosition(charOffset);
-    
-    QTextBlock block = cursor.block();
-    QTextLayout *layout = block.layout();
-    
-    if (!layout) {
-      //  QDebug() << "  布局指针为空！";
-        return result;
-    }
-    
-    int positionInBlock = cursor.positionInBlock();
-    
-    qreal x = 0;
-    qreal y = 0;
-    
-    if (layout->lineCount() > 0) {
-        // 找到光标所在的行
-        for (int i = 0; i < layout->lineCount(); ++i) {
-            QTextLine line = layout->lineAt(i);
-            if (positionInBlock >= line.textStart() && positionInBlock <= line.textStart() + line.textLength()) {
-                y = line.y();
-                x = line.cursorToX(positionInBlock);
-                break;
-            }
-        }
-    }
-    
-  //  QDebug() << "  X坐标:" << x << "Y坐标:" << y;
-    
-    // 获取 textItem 在场景中的位置（注意：它是 TextBlockItem 的子项！）
-    QPointF itemScenePos = textItem->scenePos();
-  //  QDebug() << "  文本项场景坐标:" << itemScenePos;
-    
-    result.setX(itemScenePos.x() + x);
-    result.setY(itemScenePos.y() + y);
-    
-  //  QDebug() << "  返回结果坐标:" << result;
-    
-    return result;
+    return item->mapRectToScene(item->cursorRect(pos.offset));
 }
 
 QList<QRectF> DocumentScene::calculateSelectionRects(const SelectionRange &range) const
 {
     QList<QRectF> rects;
     
-    if (!m_document) {
+    if (!m_document || range.isEmpty()) {
         return rects;
     }
     
@@ -539,104 +1086,15 @@ QList<QRectF> DocumentScene::calculateSelectionRects(const SelectionRange &range
     SelectionRange normalizedRange = range;
     normalizedRange.normalize();
     
-  //  QDebug() << "DocumentScene::calculateSelectionRects - 计算选择矩形，范围:"
-             // << "起始块:" << normalizedRange.startBlock
-             // << "起始偏移:" << normalizedRange.startOffset
-             // << "结束块:" << normalizedRange.endBlock
-             // << "结束偏移:" << normalizedRange.endOffset;
-    
-    // 简单假设只有一个section和一个page
-    Section *section = m_document->section(0);
-    if (!section) {
-        return rects;
-    }
-    
-    int pageIndex = 0;
-    
-    // 遍历选择范围内的所有块
-    for (int blockIdx = normalizedRange.startBlock; blockIdx <= normalizedRange.endBlock; ++blockIdx) {
-        // 检查是否超出范围
-        if (blockIdx < 0 || blockIdx >= section->blockCount()) {
-            continue;
-        }
-        
-        // 获取对应的QGraphicsTextItem
-        if (pageIndex >= 0 && pageIndex < m_pageTextItems.size() &&
-            blockIdx >= 0 && blockIdx < m_pageTextItems[pageIndex].size()) {
-            
-            QGraphicsTextItem *textItem = m_pageTextItems[pageIndex][blockIdx];
-            if (!textItem) {
+    // 只遍历已创建图形项的页面，与文档的块数无关
+    QList<int> pages = m_realizedPages.values();
+    std::sort(pages.begin(), pages.end());
+    for (int pageIndex : pages) {
+        for (BaseBlockItem *item : m_pageBlockItems.at(pageIndex)) {
+            if (!item)
                 continue;
-            }
-            
-            QTextDocument *doc = textItem->document();
-            if (!doc) {
-                continue;
-            }
-            
-            QString text = doc->toPlainText();
-          //  QDebug() << "  块" << blockIdx << "文本:" << text;
-            
-            // 确定当前块的选择起始和结束偏移
-            int startOffset = 0;
-            int endOffset = text.length();
-            
-            if (blockIdx == normalizedRange.startBlock) {
-                startOffset = qMin(normalizedRange.startOffset, text.length());
-            }
-            if (blockIdx == normalizedRange.endBlock) {
-                endOffset = qMin(normalizedRange.endOffset, text.length());
-            }
-            
-          //  QDebug() << "    起始偏移:" << startOffset << "结束偏移:" << endOffset;
-            
-            // 如果起始和结束相同，跳过
-            if (startOffset >= endOffset) {
-                continue;
-            }
-            
-            // 使用QTextCursor获取选择的字符范围
-            QTextCursor cursor(doc);
-            cursor.setPosition(startOffset);
-            cursor.setPosition(endOffset, QTextCursor::KeepAnchor);
-            
-            // 获取选择区域
-            QTextBlock block = cursor.block();
-            
-            // 遍历选择范围内的所有行
-            QTextLayout *layout = block.layout();
-            if (!layout) {
-                continue;
-            }
-            
-            for (int i = 0; i < layout->lineCount(); ++i) {
-                QTextLine line = layout->lineAt(i);
-                int lineStart = line.textStart();
-                int lineEnd = line.textStart() + line.textLength();
-                
-                // 确定当前行与选择范围的重叠
-                int selStart = qMax(startOffset, lineStart);
-                int selEnd = qMin(endOffset, lineEnd);
-                
-                if (selStart < selEnd) {
-                    // 计算选择在该行的起始和结束位置
-                    qreal x1 = line.cursorToX(selStart);
-                    qreal x2 = line.cursorToX(selEnd);
-                    
-                    // 获取textItem在场景中的位置
-                    QPointF itemScenePos = textItem->scenePos();
-                    
-                    // 创建选择矩形
-                    QRectF rect(
-                        itemScenePos.x() + qMin(x1, x2),
-                        itemScenePos.y() + line.y(),
-                        qAbs(x2 - x1),
-                        line.height()
-                    );
-                    
-                    rects.append(rect);
-                  //  QDebug() << "    添加矩形:" << rect;
-                }
+            for (const QRectF &rect : itemSelectionRects(item, normalizedRange)) {
+                rects.append(rect);
             }
         }
     }
@@ -644,4 +1102,33 @@ QList<QRectF> DocumentScene::calculateSelectionRects(const SelectionRange &range
     return rects;
 }
 
+QList<BaseBlockItem*> DocumentScene::itemsForBlock(Block *block) const
+{
+    QList<BaseBlockItem*> items;
+    if (BaseBlockItem *item = m_blockItems.value(block))
+        items.append(item);
+    // QMultiHash 按插入的逆序返回同一键的值，后续片段按页面顺序插入
+    QList<BaseBlockItem*> fragments = m_fragmentItems.values(block);
+    std::reverse(fragments.begin(), fragments.end());
+    items.append(fragments);
+    return items;
+}
+
+BaseBlockItem *DocumentScene::itemForOffset(Block *block, int offset) const
+{
+    if (!block)
+        return nullptr;
+    // 逐个检查而不构造列表：光标移动时每次按键都会调用
+    BaseBlockItem *first = m_blockItems.value(block);
+    if (first && first->containsOffset(offset))
+        return first;
+    for (auto it = m_fragmentItems.constFind(block); it != m_fragmentItems.constEnd() && it.key() == block; ++it) {
+        if (!first)
+            first = it.value();
+        if (it.value()->containsOffset(offset))
+            return it.value();
+    }
+    return first;
+}
+
 } // namespace QtWordEditor
@@ -0,0 +1,257 @@
+#include "graphics/scene/PageTileCache.h"
+#include <QPainter>
+#include <QMetaObject>
+#include <QThread>
+#include <QThreadStorage>
+#include <QtMath>
+#include <utility>
+
+namespace QtWordEditor {
+
+namespace {
+
+// 可见图块优先于预取图块栅格化
+constexpr int VisibleTilePriority = 1;
+constexpr int PrefetchTilePriority = 0;
+
+// 占位线条的颜色
+const QColor PlaceholderLineColor(225, 225, 225);
+
+// 每个栅格化线程各自的字体缓存，线程退出时在该线程上释放
+QThreadStorage<GlyphFontCache*> workerFonts;
+
+GlyphFontCache *threadFontCache()
+{
+    if (!workerFonts.hasLocalData())
+        workerFonts.setLocalData(new GlyphFontCache);
+    return workerFonts.localData();
+}
+
+} // namespace
+
+QPointF PageSnapshot::origin(const Fragment &fragment)
+{
+    const qreal firstLineTop = fragment.firstLine < fragment.layout->lineCount()
+                                   ? fragment.layout->lines().at(fragment.firstLine).y
+                                   : 0.0;
+    return QPointF(fragment.rect.left(), fragment.rect.top() - firstLineTop);
+}
+
+QImage PageSnapshot::render(const QRectF &source, qreal scale, int size, GlyphFontCache *fonts) const
+{
+    QImage image(size, size, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+
+    QPainter painter(&image);
+    painter.setRenderHints(QPainter::Antialiasing | QPainter::TextAntialiasing);
+    painter.scale(scale, scale);
+    painter.translate(-source.topLeft());
+    painter.setClipRect(pageRect);
+    painter.fillRect(pageRect, background);
+
+    for (const Fragment &fragment : fragments) {
+        // 字形的抗锯齿边缘可能略超出片段矩形
+        if (!fragment.layout || !fragment.rect.adjusted(-2, -2, 2, 2).intersects(source))
+            continue;
+        const QPointF offset = origin(fragment);
+        painter.save();
+        painter.translate(offset);
+        fragment.layout->draw(&painter, fragment.firstLine, fragment.lastLine, source.translated(-offset), fonts);
+        painter.restore();
+    }
+    return image;
+}
+
+void PageSnapshot::drawPlaceholder(QPainter *painter, const QRectF &rect) const
+{
+    painter->fillRect(rect & pageRect, background);
+    for (const Fragment &fragment : fragments) {
+        if (!fragment.layout || !fragment.rect.intersects(rect))
+            continue;
+        const QPointF offset = origin(fragment);
+        const QVector<LineBox> &lines = fragment.layout->lines();
+        for (int i = fragment.firstLine; i < fragment.lastLine && i < lines.size(); ++i) {
+            const LineBox &line = lines.at(i);
+            if (line.length == 0 || line.caretX.isEmpty())
+                continue;
+            // 用一条灰色横条代替一行文字，横条覆盖字形的范围、位于行的中部
+            const qreal left = qMin(line.caretX.first(), line.caretX.last());
+            const QRectF bar(offset.x() + left, offset.y() + line.y + line.height * 0.3,
+                             line.naturalWidth, line.height * 0.4);
+            if (bar.intersects(rect))
+                painter->fillRect(bar, PlaceholderLineColor);
+        }
+    }
+}
+
+PageTileCache::PageTileCache(qint64 maxBytes, QObject *parent)
+    : QObject(parent)
+    , m_epoch(0)
+    , m_counter(0)
+{
+    m_tiles.setMaxCost(maxBytes);
+    // 至少给界面线程留一个核
+    m_threadPool.setMaxThreadCount(qMax(1, QThread::idealThreadCount() - 1));
+}
+
+PageTileCache::~PageTileCache()
+{
+    // 工作线程完成后会回调到本对象，必须在析构前全部结束
+    m_threadPool.clear();
+    m_threadPool.waitForDone();
+}
+
+void PageTileCache::setSnapshotProvider(const SnapshotProvider &provider)
+{
+    m_snapshotProvider = provider;
+    clear();
+}
+
+void PageTileCache::setMaxBytes(qint64 maxBytes)
+{
+    m_tiles.setMaxCost(maxBytes);
+}
+
+qint64 PageTileCache::maxBytes() const
+{
+    return m_tiles.maxCost();
+}
+
+QImage PageTileCache::tile(int pageIndex, qreal scale, int x, int y)
+{
+    const PageTileKey key{pageIndex, scaleKey(scale), x, y};
+    if (QImage *cached = m_tiles.object(key))
+        return *cached;
+    requestTile(key, VisibleTilePriority);
+    return QImage();
+}
+
+void PageTileCache::prefetch(int pageIndex, const QRectF &rect, qreal scale)
+{
+    const int key = scaleKey(scale);
+    const qreal extent = tileRect(key, 0, 0).width();
+    const int firstX = qMax(0, qFloor(rect.left() / extent));
+    const int lastX = qCeil(rect.right() / extent);
+    const int firstY = qMax(0, qFloor(rect.top() / extent));
+    const int lastY = qCeil(rect.bottom() / extent);
+    for (int y = firstY; y < lastY; ++y) {
+        for (int x = firstX; x < lastX; ++x) {
+            const PageTileKey tileKey{pageIndex, key, x, y};
+            if (!m_tiles.contains(tileKey))
+                requestTile(tileKey, PrefetchTilePriority);
+        }
+    }
+}
+
+void PageTileCache::drawPlaceholder(QPainter *painter, int pageIndex, const QRectF &rect)
+{
+    const PageSnapshotPtr snapshot = m_snapshotProvider ? m_snapshotProvider(pageIndex) : PageSnapshotPtr();
+    if (snapshot)
+        snapshot->drawPlaceholder(painter, rect);
+}
+
+void PageTileCache::requestTile(const PageTileKey &key, int priority)
+{
+    if (m_pending.contains(key) || !m_snapshotProvider)
+        return;
+    const PageSnapshotPtr snapshot = m_snapshotProvider(key.page);
+    if (!snapshot)
+        return;
+
+    m_pending.insert(key);
+    const quint64 requestGeneration = generation(key.page);
+    m_threadPool.start([this, key, snapshot, requestGeneration]() {
+        // 快照与文档无关，只读访问共享的排版结果；字体在本线程取得，不与其他线程共享
+        const QImage image = snapshot->render(tileRect(key.scale, key.x, key.y), key.scale / 1000.0, TileSize,
+                                              threadFontCache());
+        QMetaObject::invokeMethod(this, [this, key, requestGeneration, image]() {
+            finishTile(key, requestGeneration, image);
+        }, Qt::QueuedConnection);
+    }, priority);
+}
+
+void PageTileCache::finishTile(const PageTileKey &key, quint64 requestGeneration, const QImage &image)
+{
+    m_pending.remove(key);
+    // 栅格化期间页面已失效：丢弃结果，重绘时按新的快照重新请求
+    if (requestGeneration == generation(key.page))
+        m_tiles.insert(key, new QImage(image), image.sizeInBytes());
+    emit tileReady(key.page, tileRect(key.scale, key.x, key.y));
+}
+
+quint64 PageTileCache::generation(int pageIndex) const
+{
+    return qMax(m_epoch, m_pageGenerations.value(pageIndex));
+}
+
+void PageTileCache::invalidate(int pageIndex, const QRectF &rect)
+{
+    m_pageGenerations.insert(pageIndex, ++m_counter);
+    const QList<PageTileKey> keys = m_tiles.keys();
+    for (const PageTileKey &key : keys) {
+        if (key.page == pageIndex && tileRect(key.scale, key.x, key.y).intersects(rect))
+            m_tiles.remove(key);
+    }
+}
+
+void PageTileCache::replacePages(int firstPage, int removedCount, int addedCount)
+{
+    const int removedEnd = firstPage + removedCount;
+    const int delta = addedCount - removedCount;
+
+    // 先全部取出再插入，避免平移后的键与尚未移动的键冲突
+    QVector<QPair<PageTileKey, QImage*>> moved;
+    const QList<PageTileKey> keys = m_tiles.keys();
+    for (const PageTileKey &key : keys) {
+        if (key.page < firstPage)
+            continue;
+        if (key.page < removedEnd)
+            m_tiles.remove(key);
+        else if (delta != 0)
+            moved.append(qMakePair(PageTileKey{key.page + delta, key.scale, key.x, key.y}, m_tiles.take(key)));
+    }
+    for (const auto &entry : std::as_const(moved)) {
+        m_tiles.insert(entry.first, entry.second, entry.second->sizeInBytes());
+    }
+
+    QHash<int, quint64> generations;
+    for (auto it = m_pageGenerations.constBegin(); it != m_pageGenerations.constEnd(); ++it) {
+        if (it.key() < firstPage)
+            generations.insert(it.key(), it.value());
+        else if (it.key() >= removedEnd)
+            generations.insert(it.key() + delta, it.value());
+    }
+    m_pageGenerations = generations;
+
+    // 正在栅格化的图块按旧页序号返回，该序号已对应别的页面
+    const QList<PageTileKey> pending = m_pending.values();
+    for (const PageTileKey &key : pending) {
+        if (key.page < firstPage)
+            continue;
+        m_pending.remove(key);
+        m_pageGenerations.insert(key.page, ++m_counter);
+    }
+}
+
+void PageTileCache::clear()
+{
+    m_epoch = ++m_counter;
+    m_pageGenerations.clear();
+    // 尚未开始的请求直接取消，正在执行的结果回来后按代数丢弃
+    m_threadPool.clear();
+    m_pending.clear();
+    m_tiles.clear();
+}
+
+int PageTileCache::scaleKey(qreal scale)
+{
+    return qMax(1, qRound(scale * 1000.0));
+}
+
+QRectF PageTileCache::tileRect(int scaleKey, int x, int y)
+{
+    const qreal extent = TileSize * 1000.0 / scaleKey;
+    return QRectF(x * extent, y * extent, extent, extent);
+}
+
+} // namespace QtWordEditor
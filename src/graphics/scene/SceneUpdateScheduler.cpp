@@ -0,0 +1,149 @@
+#include "graphics/scene/SceneUpdateScheduler.h"
+#include "graphics/scene/DocumentScene.h"
+#include "core/document/Document.h"
+#include "core/document/Block.h"
+#include "core/document/Section.h"
+#include "core/layout/LayoutEngine.h"
+#include "core/utils/Constants.h"
+#include <QVector>
+#include <algorithm>
+#include <utility>
+
+namespace QtWordEditor {
+
+SceneUpdateScheduler::SceneUpdateScheduler(DocumentScene *scene)
+    : QObject(scene)
+    , m_scene(scene)
+    , m_layoutEngine(nullptr)
+    , m_cursorDirty(false)
+    , m_selectionDirty(false)
+{
+    m_timer.setSingleShot(true);
+    connect(&m_timer, &QTimer::timeout, this, &SceneUpdateScheduler::flush);
+}
+
+void SceneUpdateScheduler::setLayoutEngine(LayoutEngine *engine)
+{
+    m_layoutEngine = engine;
+}
+
+void SceneUpdateScheduler::markBlockDirty(Block *block)
+{
+    if (!block)
+        return;
+    m_dirtyBlockIds.insert(block->blockId());
+    scheduleFlush();
+}
+
+void SceneUpdateScheduler::markBlockRangeDirty(int firstIndex, int lastIndex)
+{
+    Document *document = m_scene->document();
+    Block *first = document ? document->block(firstIndex) : nullptr;
+    Block *last = document ? document->block(lastIndex) : nullptr;
+    if (!first || !last)
+        return;
+    m_dirtyRanges.append(qMakePair(first->blockId(), last->blockId()));
+    scheduleFlush();
+}
+
+void SceneUpdateScheduler::markBlocksDirty(const QList<Block*> &blocks)
+{
+    Document *document = m_scene->document();
+    if (!document || blocks.isEmpty())
+        return;
+    for (const QPair<int, int> &range : document->blockIndexRanges(blocks))
+        markBlockRangeDirty(range.first, range.second);
+}
+
+void SceneUpdateScheduler::markCursorDirty()
+{
+    m_cursorDirty = true;
+    scheduleFlush();
+}
+
+void SceneUpdateScheduler::markSelectionDirty()
+{
+    m_selectionDirty = true;
+    scheduleFlush();
+}
+
+bool SceneUpdateScheduler::hasPendingUpdates() const
+{
+    return !m_dirtyBlockIds.isEmpty() || !m_dirtyRanges.isEmpty() || m_cursorDirty || m_selectionDirty;
+}
+
+void SceneUpdateScheduler::scheduleFlush()
+{
+    if (m_timer.isActive())
+        return;
+    // 上一帧已经过去时在下一轮事件循环刷新，否则等到帧边界
+    const qint64 elapsed = m_sinceFlush.isValid() ? m_sinceFlush.elapsed() : Constants::SCENE_UPDATE_FRAME_INTERVAL;
+    m_timer.start(int(qMax<qint64>(0, Constants::SCENE_UPDATE_FRAME_INTERVAL - elapsed)));
+}
+
+void SceneUpdateScheduler::flush()
+{
+    m_timer.stop();
+    m_sinceFlush.restart();
+
+    // 先取出待处理的状态：刷新过程中产生的新标记留到下一帧
+    const QSet<int> blockIds = std::exchange(m_dirtyBlockIds, QSet<int>());
+    const QVector<QPair<int, int>> rangeIds = std::exchange(m_dirtyRanges, QVector<QPair<int, int>>());
+    const bool selectionDirty = std::exchange(m_selectionDirty, false);
+    const bool cursorDirty = std::exchange(m_cursorDirty, false);
+
+    Document *document = m_scene->document();
+    if (document && (!blockIds.isEmpty() || !rangeIds.isEmpty())) {
+        // 转换为全局索引区间，已被删除的块跳过
+        QVector<QPair<int, int>> ranges;
+        ranges.reserve(blockIds.size() + rangeIds.size());
+        for (int blockId : blockIds) {
+            const int index = document->indexOfBlock(document->blockById(blockId));
+            if (index >= 0)
+                ranges.append(qMakePair(index, index));
+        }
+        for (const auto &ids : rangeIds) {
+            const int first = document->indexOfBlock(document->blockById(ids.first));
+            const int last = document->indexOfBlock(document->blockById(ids.second));
+            if (first >= 0 && last >= first)
+                ranges.append(qMakePair(first, last));
+        }
+        std::sort(ranges.begin(), ranges.end());
+
+        // 按文档顺序合并重叠或相邻的区间，再按节切开（增量分页以节为单位）
+        int sectionIdx = 0;
+        int sectionStart = 0;
+        for (int i = 0; i < ranges.size(); ) {
+            int first = ranges.at(i).first;
+            int last = ranges.at(i).second;
+            for (++i; i < ranges.size() && ranges.at(i).first <= last + 1; ++i)
+                last = qMax(last, ranges.at(i).second);
+
+            while (first <= last) {
+                while (sectionIdx < document->sectionCount()
+                       && first >= sectionStart + document->section(sectionIdx)->blockCount()) {
+                    sectionStart += document->section(sectionIdx)->blockCount();
+                    ++sectionIdx;
+                }
+                if (sectionIdx >= document->sectionCount())
+                    break;
+                const int sectionLast = qMin(last, sectionStart + document->section(sectionIdx)->blockCount() - 1);
+                // 从修改的块开始增量分页，分页变化时排版引擎通知场景只替换变化的页面
+                if (m_layoutEngine)
+                    m_layoutEngine->layoutFrom(first, sectionLast);
+                if (first == sectionLast)
+                    m_scene->updateSingleTextItem(document->block(first));
+                else
+                    m_scene->updateBlockRange(first, sectionLast);
+                first = sectionLast + 1;
+            }
+        }
+    }
+
+    if (selectionDirty)
+        emit selectionUpdateRequested();
+    if (cursorDirty)
+        emit cursorUpdateRequested();
+}
+
+} // namespace QtWordEditor
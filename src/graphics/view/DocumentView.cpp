@@ -9,15 +9,27 @@
 #include <QDebug>
 #include <QMenu>
 #include <QContextMenuEvent>
+#include <QStyleOptionGraphicsItem>
 
 namespace QtWordEditor {
 
+namespace {
+
+// 预取滚动方向上多少秒内会到达的内容，最多预取的视口高度倍数
+constexpr qreal PrefetchLookaheadSeconds = 0.4;
+constexpr qreal PrefetchMaxViewports = 3.0;
+// 两次滚动间隔超过该值时视为新的一次滚动，速度重新计算
+constexpr qint64 ScrollIdleMs = 200;
+
+} // namespace
+
 DocumentView::DocumentView(QWidget *parent)
     : QGraphicsView(parent)
     , m_zoom(100.0)
     , m_lastMousePos(-1, -1)
     , m_cursor(nullptr)
     , m_cursorVisualPos(0, 0)
+    , m_scrollVelocity(0.0)
 {
     // 使用默认的软件渲染视口（不使用GPU加速）
     setRenderHints(QPainter::Antialiasing | QPainter::TextAntialiasing);
@@ -40,6 +52,7 @@ DocumentView::~DocumentView()
 void DocumentView::setScene(DocumentScene *scene)
 {
     QGraphicsView::setScene(scene);
+    updateSceneViewport();
 }
 
 qreal DocumentView::zoom() const
@@ -54,6 +67,7 @@ void DocumentView::setZoom(qreal zoom)
     m_zoom = zoom;
     resetTransform();
     scale(m_zoom / 100.0, m_zoom / 100.0);
+    updateSceneViewport();
     emit zoomChanged(m_zoom);
     updateMousePosition();
 }
@@ -116,15 +130,58 @@ void DocumentView::mouseMoveEvent(QMouseEvent *event)
 void DocumentView::scrollContentsBy(int dx, int dy)
 {
     QGraphicsView::scrollContentsBy(dx, dy);
+
+    // 内容向上移动（dy < 0）表示向下滚动；换算为场景单位并做指数平滑
+    qint64 elapsed = -1;
+    if (m_scrollTimer.isValid())
+        elapsed = m_scrollTimer.restart();
+    else
+        m_scrollTimer.start();
+    if (elapsed > 0 && elapsed < ScrollIdleMs) {
+        const qreal lod = QStyleOptionGraphicsItem::levelOfDetailFromTransform(transform());
+        const qreal velocity = -dy / lod / (elapsed / 1000.0);
+        m_scrollVelocity = 0.5 * m_scrollVelocity + 0.5 * velocity;
+    } else {
+        m_scrollVelocity = 0.0;
+    }
+
+    updateSceneViewport();
+    prefetchAhead();
     updateMousePosition();
 }
 
 void DocumentView::resizeEvent(QResizeEvent *event)
 {
     QGraphicsView::resizeEvent(event);
+    updateSceneViewport();
     updateMousePosition();
 }
 
+void DocumentView::prefetchAhead()
+{
+    DocumentScene *documentScene = qobject_cast<DocumentScene*>(scene());
+    if (!documentScene || qFuzzyIsNull(m_scrollVelocity))
+        return;
+
+    const QRectF visible = mapToScene(viewport()->rect()).boundingRect();
+    const qreal distance = qMin(qAbs(m_scrollVelocity) * PrefetchLookaheadSeconds,
+                                visible.height() * PrefetchMaxViewports);
+    const QRectF ahead = m_scrollVelocity > 0
+                             ? QRectF(visible.left(), visible.bottom(), visible.width(), distance)
+                             : QRectF(visible.left(), visible.top() - distance, visible.width(), distance);
+    // 与 PageItem 绘制图块时使用的缩放级别一致
+    const qreal scale = QStyleOptionGraphicsItem::levelOfDetailFromTransform(transform())
+                        * viewport()->devicePixelRatio();
+    documentScene->prefetchTiles(ahead, scale);
+}
+
+void DocumentView::updateSceneViewport()
+{
+    DocumentScene *documentScene = qobject_cast<DocumentScene*>(scene());
+    if (documentScene)
+        documentScene->setViewportRect(mapToScene(viewport()->rect()).boundingRect());
+}
+
 void DocumentView::mouseReleaseEvent(QMouseEvent *event)
 {
     QPointF scenePos = mapToScene(event->pos());
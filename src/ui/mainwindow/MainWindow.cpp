@@ -8,10 +8,12 @@
 #include "core/document/CharacterStyle.h"
 #include "core/document/TableBlock.h"
 #include "core/document/Page.h"
-#include "core/layout/PageBuilder.h"
+#include "core/layout/LayoutEngine.h"
+#include "core/commands/CommandJournal.h"
 #include "core/utils/Constants.h"
 #include "core/utils/Logger.h"
 #include "graphics/scene/DocumentScene.h"
+#include "graphics/scene/SceneUpdateScheduler.h"
 #include "graphics/view/DocumentView.h"
 #include "editcontrol/cursor/Cursor.h"
 #include "editcontrol/selection/Selection.h"
@@ -35,6 +37,8 @@
 #include <QMessageBox>
 #include <QFileDialog>
 #include <QFileInfo>
+#include <QDir>
+#include <QStandardPaths>
 #include <QCloseEvent>
 #include <QVBoxLayout>
 #include <QWidget>
@@ -57,7 +61,9 @@ MainWindow::MainWindow(QWidget *parent)
     , m_editEventHandler(nullptr)
     , m_formatController(nullptr)
     , m_styleManager(nullptr)
+    , m_layoutEngine(nullptr)
     , m_ribbonBar(nullptr)
+    , m_journal(nullptr)
     , m_isModified(false)
     , m_currentZoom(100.0)
 {
@@ -110,9 +116,27 @@ void MainWindow::setupUi()
     setCentralWidget(centralContainer);
 
     m_document = new Document(this);
+    // 每条编辑命令写入本实例的命令日志，异常退出后可在上次保存的文件上重放
+    const QString journalDir = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation);
+    QDir().mkpath(journalDir);
+    m_journal = new CommandJournal(m_document, CommandJournal::sessionFilePath(journalDir), m_document);
+    m_document->setCommandJournal(m_journal);
     m_cursor = new Cursor(m_document, this);
     m_selection = new Selection(m_document, this);
     m_styleManager = new StyleManager(this);
+    m_styleManager->setDocument(m_document);
+    m_layoutEngine = new LayoutEngine(this);
+    m_layoutEngine->setDocument(m_document);
+    m_layoutEngine->setPageSize(Constants::PAGE_WIDTH, Constants::PAGE_HEIGHT, Constants::PAGE_MARGIN);
+    m_layoutEngine->setPriorityPageCount(Constants::BACKGROUND_LAYOUT_PRIORITY_PAGES);
+    // 增量排版替换了一段页面时，场景只替换这段页面，后续页面平移
+    connect(m_layoutEngine, &LayoutEngine::pagesChanged, this, [this](int firstPage, int removedCount, int addedCount) {
+        m_scene->replacePages(firstPage, removedCount, addedCount);
+    });
+    // 后台分页发布的页面直接追加到场景末尾
+    connect(m_layoutEngine, &LayoutEngine::pagesAppended, this, [this](int firstPage, int count) {
+        m_scene->appendPages(firstPage, count);
+    });
     m_formatController = new FormatController(m_document, m_cursor, m_selection, m_styleManager, this);
     m_editEventHandler = new EditEventHandler(m_document, m_cursor, m_selection, m_formatController, this);
 
@@ -123,6 +147,12 @@ void MainWindow::setupUi()
     m_view = new DocumentView(this);
     m_scene = new DocumentScene(this);
     m_view->setScene(m_scene);
+    // 段落直接绘制排版引擎缓存的字形，不为每个段落创建 QTextDocument
+    m_scene->setLayoutEngine(m_layoutEngine);
+    // 只为视口附近的页面创建图形项，长文档的场景项数量保持有界
+    m_scene->setVirtualized(true);
+    // 页面内容栅格化为图块缓存，滚动时直接贴图
+    m_scene->setTileCacheEnabled(true);
     m_scene->setDocument(m_document);
     
     QWidget *viewContainer = new QWidget(this);
@@ -135,10 +165,10 @@ void MainWindow::setupUi()
     mainLayout->addWidget(viewContainer);
 
     connect(m_styleManager, &StyleManager::characterStyleChanged,
-            this, &MainWindow::onStyleChanged);
+            this, &MainWindow::onCharacterStyleChanged);
 
     connect(m_styleManager, &StyleManager::paragraphStyleChanged,
-            this, &MainWindow::onStyleChanged);
+            this, &MainWindow::onParagraphStyleChanged);
 
     connect(m_styleManager, &StyleManager::stylesChanged,
             this, &MainWindow::onStyleChanged);
@@ -253,16 +283,15 @@ void MainWindow::setupUi()
     connect(m_view, &DocumentView::contextMenuParagraphRequested,
             this, &MainWindow::paragraphSettings);
     
-    // 连接选择更新信号
+    // 选区、光标和块的显示更新先标记，由调度器每帧合并刷新一次
+    SceneUpdateScheduler *scheduler = m_scene->updateScheduler();
     connect(m_editEventHandler, &EditEventHandler::selectionNeedsUpdate,
+            scheduler, &SceneUpdateScheduler::markSelectionDirty);
+    connect(scheduler, &SceneUpdateScheduler::selectionUpdateRequested,
             this, [this]() {
                 if (m_selection && m_scene) {
-                    if (m_selection->isEmpty()) {
-                        m_scene->clearSelection();
-                    } else {
-                        QList<QRectF> rects = m_scene->calculateSelectionRects(m_selection->range());
-                        m_scene->updateSelection(rects);
-                    }
+                    // 场景只重新计算选区端点移动经过的块，空选区时清除
+                    m_scene->setSelectionRange(m_selection->range());
                     // 始终显示光标
                     m_scene->setCursorVisible(true);
                 }
@@ -273,15 +302,19 @@ void MainWindow::setupUi()
 
     connect(m_document, &Document::documentChanged,
             this, &MainWindow::updateWindowTitle);
+    // 批量格式修改结束时整段只通知一次，交给调度器合并排版
+    connect(m_document, &Document::blocksChanged,
+            scheduler, &SceneUpdateScheduler::markBlockRangeDirty);
 
     connect(m_cursor, &Cursor::positionChanged,
             m_formatController, &FormatController::onCursorMoved);
     connect(m_cursor, &Cursor::positionChanged,
-            this, &MainWindow::updateCursorPosition);
+            scheduler, &SceneUpdateScheduler::markCursorDirty);
     
-    // 连接光标位置变化信号到样式状态更新（无选区时）
-    connect(m_cursor, &Cursor::positionChanged,
+    // 一帧内光标多次移动只更新一次光标显示、状态栏和样式状态（无选区时）
+    connect(scheduler, &SceneUpdateScheduler::cursorUpdateRequested,
             this, [this]() {
+                updateCursorPosition(m_cursor->position());
                 // 只有在无选区时，光标移动才更新样式
                 if (m_selection && m_selection->isEmpty()) {
                     updateStyleState();
@@ -333,8 +366,27 @@ void MainWindow::setupUi()
     // 创建调试控制台
     setupDebugConsole();
     
+    // 只有锁已失效的日志是异常退出留下的，正在运行的其他实例的日志不动。
+    // 一次只恢复最新的一个，其余的留到下次启动；没有记录的日志直接删除
+    QString recoveredJournal;
+    QString recoveredFile;
+    QByteArray recoveredRecords;
+    const QStringList staleJournals = CommandJournal::staleJournals(QFileInfo(m_journal->filePath()).absolutePath());
+    for (const QString &journal : staleJournals) {
+        if (CommandJournal::readJournal(journal, &recoveredFile, &recoveredRecords) && !recoveredRecords.isEmpty()) {
+            recoveredJournal = journal;
+            break;
+        }
+        CommandJournal::removeJournal(journal);
+    }
+
     // 先创建新文档，这会调用 setDocument()
     newDocument();
+    if (!recoveredJournal.isEmpty()) {
+        recoverUnsavedChanges(recoveredFile, recoveredRecords);
+        // 恢复的记录已写入本实例的日志；放弃恢复时也不再询问
+        CommandJournal::removeJournal(recoveredJournal);
+    }
     
     m_cursor->setPosition(0, 0);
     m_currentCursorPos = m_cursor->position();
@@ -468,6 +520,23 @@ void MainWindow::createActions()
     helpMenu->addAction(aboutAct);
 }
 
+void MainWindow::recoverUnsavedChanges(const QString &baseFile, const QByteArray &records)
+{
+    QMessageBox::StandardButton ret = QMessageBox::question(this, tr("Application"),
+         tr("QtWordEditor did not exit normally.\nDo you want to recover your unsaved changes?"),
+         QMessageBox::Yes | QMessageBox::No, QMessageBox::Yes);
+    if (ret != QMessageBox::Yes)
+        return;
+
+    // 在基准文件上重放；重放的命令同时写入新日志，再次崩溃时仍可恢复
+    m_currentFile = baseFile;
+    m_journal->reset(m_currentFile);
+    const int applied = m_journal->replay(records);
+    m_isModified = applied > 0;
+    updateWindowTitle();
+    statusBar()->showMessage(tr("Recovered %n unsaved change(s)", "", applied));
+}
+
 bool MainWindow::maybeSave()
 {
     if (!m_isModified)
@@ -485,6 +554,8 @@ bool MainWindow::maybeSave()
 void MainWindow::newDocument()
 {
     if (maybeSave()) {
+        // 旧文档的命令引用的块已不存在
+        m_document->undoStack()->clear();
         while (m_document->sectionCount() > 0) {
             m_document->removeSection(0);
         }
@@ -500,39 +571,39 @@ void MainWindow::newDocument()
         para2->setText("这是第二段测试文字。您可以在这里进行各种文字编辑操作，包括字体样式修改、段落对齐等功能。");
         section->addBlock(para2);
         
-        qreal pageWidth = Constants::PAGE_WIDTH;
-        qreal pageHeight = Constants::PAGE_HEIGHT;
-        qreal margin = Constants::PAGE_MARGIN;
-        
         m_scene->clearPages();
         
-        PageBuilder builder(pageWidth, pageHeight, margin);
         for (int i = 0; i < section->blockCount(); ++i) {
             Block *block = section->block(i);
-            block->setHeight(30.0);
-            builder.tryAddBlock(block);
-            
             ParagraphBlock *paraBlock = qobject_cast<ParagraphBlock*>(block);
             if (paraBlock) {
                 // 连接 textChanged 信号，只更新当前修改的块而不是全部
+                // 由调度器在帧边界从该块开始增量分页并更新图形项，连续输入只处理一次
                 connect(paraBlock, &ParagraphBlock::textChanged, this, [this, block]() {
-                    m_scene->updateSingleTextItem(block);
+                    m_scene->updateScheduler()->markBlockDirty(block);
+                });
+                connect(paraBlock, &ParagraphBlock::paragraphStyleNameChanged, this, [this, block]() {
+                    m_scene->updateScheduler()->markBlockDirty(block);
                 });
             }
         }
         
-        Page *page = builder.finishPage();
-        page->setPageNumber(1);
-        section->addPage(page);
-        
-        // 直接调用 rebuildFromDocument，避免重复调用
-        m_scene->rebuildFromDocument();
+        // 由排版引擎计算块高度并分页；大文档在后台分页，页面分批出现在场景中
+        if (m_document->blockCount() > Constants::BACKGROUND_LAYOUT_BLOCK_THRESHOLD) {
+            m_scene->rebuildFromDocument();
+            m_layoutEngine->startBackgroundLayout();
+        } else {
+            m_layoutEngine->layout();
+            // 直接调用 rebuildFromDocument，避免重复调用
+            m_scene->rebuildFromDocument();
+        }
         
         // 重置光标位置到 (0, 0)
         m_cursor->setPosition(0, 0);
         
         m_currentFile.clear();
         m_isModified = false;
+        m_journal->reset(m_currentFile);
     }
 }
 
@@ -548,6 +619,7 @@ void MainWindow::openDocument()
     newDocument();
     m_currentFile = fileName;
     m_isModified = false;
+    m_journal->reset(m_currentFile);
     statusBar()->showMessage(tr("Loaded %1").arg(fileName));
 }
 
@@ -556,6 +628,8 @@ bool MainWindow::saveDocument()
     if (m_currentFile.isEmpty())
         return saveAsDocument();
     m_isModified = false;
+    // 已保存的修改不再需要重放
+    m_journal->reset(m_currentFile);
     statusBar()->showMessage(tr("Saved %1").arg(m_currentFile));
     return true;
 }
@@ -618,6 +692,8 @@ void MainWindow::zoomToFit()
 void MainWindow::closeEvent(QCloseEvent *event)
 {
     if (maybeSave()) {
+        // 正常退出，不需要恢复
+        m_journal->discard();
         event->accept();
     } else {
         event->ignore();
@@ -828,22 +904,10 @@ void MainWindow::retranslateUi()
 void MainWindow::updateCursorPosition(const CursorPosition &pos)
 {
     m_currentCursorPos = pos;
-    QPointF visualPos = calculateCursorVisualPosition(pos);
-    
-    // 根据光标位置的字号计算光标高度
-    qreal cursorHeight = 20.0;  // 默认值
-    if (pos.blockIndex >= 0) {
-        Block *block = m_document->block(pos.blockIndex);
-        ParagraphBlock *paraBlock = qobject_cast<ParagraphBlock*>(block);
-        if (paraBlock) {
-            CharacterStyle style = paraBlock->styleAt(pos.offset);
-            int fontSize = style.fontSize();
-            if (fontSize > 0) {
-                // 字号为磅值，转换为像素高度（约1.2倍字号比较合适）
-                cursorHeight = fontSize * 1.2;
-            }
-        }
-    }
+    // 光标高度取所在行的行高，位置无效时使用默认值
+    const QRectF cursorRect = m_scene ? m_scene->calculateCursorRect(pos) : QRectF();
+    const QPointF visualPos = cursorRect.topLeft();
+    const qreal cursorHeight = cursorRect.height() > 0 ? cursorRect.height() : 20.0;
     
     m_scene->updateCursor(visualPos, cursorHeight);
     m_view->setCursorVisualPosition(visualPos);
@@ -1088,11 +1152,25 @@ void MainWindow::applyFontProperty(
     updateStyleState();
 }
 
-void MainWindow::onStyleChanged()
+void MainWindow::onCharacterStyleChanged(const QString &styleName)
 {
-    if (m_scene) {
-        m_scene->updateAllTextItems();
+    // 只重新排版引用该样式或其后代样式的段落，段落高度变化时由增量分页调整页面
+    if (m_scene && m_document) {
+        QStringList styles = m_styleManager->dependentCharacterStyles(styleName);
+        m_scene->updateScheduler()->markBlocksDirty(m_document->blocksUsingCharacterStyles(styles));
+    }
+}
+
+void MainWindow::onParagraphStyleChanged(const QString &styleName)
+{
+    if (m_scene && m_document) {
+        QStringList styles = m_styleManager->dependentParagraphStyles(styleName);
+        m_scene->updateScheduler()->markBlocksDirty(m_document->blocksUsingParagraphStyles(styles));
     }
+}
+
+void MainWindow::onStyleChanged()
+{
     // 刷新 RibbonBar 的样式列表
     if (m_ribbonBar) {
         m_ribbonBar->refreshStyleLists();